@@ -0,0 +1,213 @@
+BEGIN {
+D["PACKAGE_NAME"]=" \"ltp\""
+D["PACKAGE_TARNAME"]=" \"ltp\""
+D["PACKAGE_VERSION"]=" \"LTP_VERSION\""
+D["PACKAGE_STRING"]=" \"ltp LTP_VERSION\""
+D["PACKAGE_BUGREPORT"]=" \"ltp@lists.linux.it\""
+D["PACKAGE_URL"]=" \"\""
+D["PACKAGE"]=" \"ltp\""
+D["VERSION"]=" \"LTP_VERSION\""
+D["HAVE_DECL_IFLA_NET_NS_PID"]=" 1"
+D["HAVE_DECL_MADV_MERGEABLE"]=" 1"
+D["HAVE_DECL_PR_CAPBSET_DROP"]=" 1"
+D["HAVE_DECL_PR_CAPBSET_READ"]=" 1"
+D["HAVE_DECL_SEM_STAT_ANY"]=" 1"
+D["HAVE_STDIO_H"]=" 1"
+D["HAVE_STDLIB_H"]=" 1"
+D["HAVE_STRING_H"]=" 1"
+D["HAVE_INTTYPES_H"]=" 1"
+D["HAVE_STDINT_H"]=" 1"
+D["HAVE_STRINGS_H"]=" 1"
+D["HAVE_SYS_STAT_H"]=" 1"
+D["HAVE_SYS_TYPES_H"]=" 1"
+D["HAVE_UNISTD_H"]=" 1"
+D["HAVE_ASM_LDT_H"]=" 1"
+D["HAVE_CPUID_H"]=" 1"
+D["HAVE_EMMINTRIN_H"]=" 1"
+D["HAVE_IFADDRS_H"]=" 1"
+D["HAVE_LINUX_CAN_H"]=" 1"
+D["HAVE_LINUX_CGROUPSTATS_H"]=" 1"
+D["HAVE_LINUX_CRYPTOUSER_H"]=" 1"
+D["HAVE_LINUX_CLOSE_RANGE_H"]=" 1"
+D["HAVE_LINUX_DCCP_H"]=" 1"
+D["HAVE_LINUX_FS_H"]=" 1"
+D["HAVE_LINUX_FUTEX_H"]=" 1"
+D["HAVE_LINUX_GENETLINK_H"]=" 1"
+D["HAVE_LINUX_IF_ALG_H"]=" 1"
+D["HAVE_LINUX_IF_ETHER_H"]=" 1"
+D["HAVE_LINUX_IF_PACKET_H"]=" 1"
+D["HAVE_LINUX_IO_URING_H"]=" 1"
+D["HAVE_LINUX_IOPRIO_H"]=" 1"
+D["HAVE_LINUX_KEYCTL_H"]=" 1"
+D["HAVE_LINUX_MEMPOLICY_H"]=" 1"
+D["HAVE_LINUX_MODULE_H"]=" 1"
+D["HAVE_LINUX_MOUNT_H"]=" 1"
+D["HAVE_LINUX_NETLINK_H"]=" 1"
+D["HAVE_LINUX_SECCOMP_H"]=" 1"
+D["HAVE_LINUX_SECUREBITS_H"]=" 1"
+D["HAVE_LINUX_TTY_H"]=" 1"
+D["HAVE_LINUX_TYPES_H"]=" 1"
+D["HAVE_LINUX_USERFAULTFD_H"]=" 1"
+D["HAVE_PTHREAD_H"]=" 1"
+D["HAVE_SYS_EPOLL_H"]=" 1"
+D["HAVE_SYS_FANOTIFY_H"]=" 1"
+D["HAVE_SYS_INOTIFY_H"]=" 1"
+D["HAVE_SYS_PIDFD_H"]=" 1"
+D["HAVE_SYS_PRCTL_H"]=" 1"
+D["HAVE_SYS_SHM_H"]=" 1"
+D["HAVE_SYS_TIMERFD_H"]=" 1"
+D["HAVE_SYS_UTSNAME_H"]=" 1"
+D["HAVE_SYS_XATTR_H"]=" 1"
+D["STDC_HEADERS"]=" 1"
+D["HAVE_FTS_H"]=" 1"
+D["HAVE_LINUX_VM_SOCKETS_H"]=" 1"
+D["HAVE_CLOSE_RANGE"]=" 1"
+D["HAVE_COPY_FILE_RANGE"]=" 1"
+D["HAVE_EPOLL_PWAIT"]=" 1"
+D["HAVE_EPOLL_PWAIT2"]=" 1"
+D["HAVE_EXECVEAT"]=" 1"
+D["HAVE_FALLOCATE"]=" 1"
+D["HAVE_FCHOWNAT"]=" 1"
+D["HAVE_FSCONFIG"]=" 1"
+D["HAVE_FSMOUNT"]=" 1"
+D["HAVE_FSOPEN"]=" 1"
+D["HAVE_FSPICK"]=" 1"
+D["HAVE_FSTATAT"]=" 1"
+D["HAVE_GETAUXVAL"]=" 1"
+D["HAVE_GETCONTEXT"]=" 1"
+D["HAVE_GETCPU"]=" 1"
+D["HAVE_GETDENTS64"]=" 1"
+D["HAVE_MALLINFO"]=" 1"
+D["HAVE_MALLINFO2"]=" 1"
+D["HAVE_MALLOPT"]=" 1"
+D["HAVE_MKDIRAT"]=" 1"
+D["HAVE_MKNODAT"]=" 1"
+D["HAVE_MODIFY_LDT"]=" 1"
+D["HAVE_MOUNT_SETATTR"]=" 1"
+D["HAVE_MOVE_MOUNT"]=" 1"
+D["HAVE_NAME_TO_HANDLE_AT"]=" 1"
+D["HAVE_OPEN_TREE"]=" 1"
+D["HAVE_OPENAT"]=" 1"
+D["HAVE_PIDFD_GETFD"]=" 1"
+D["HAVE_PIDFD_OPEN"]=" 1"
+D["HAVE_PIDFD_SEND_SIGNAL"]=" 1"
+D["HAVE_PKEY_MPROTECT"]=" 1"
+D["HAVE_PREADV"]=" 1"
+D["HAVE_PREADV2"]=" 1"
+D["HAVE_PROFIL"]=" 1"
+D["HAVE_PWRITEV"]=" 1"
+D["HAVE_PWRITEV2"]=" 1"
+D["HAVE_RAND_R"]=" 1"
+D["HAVE_READLINKAT"]=" 1"
+D["HAVE_RECVMMSG"]=" 1"
+D["HAVE_RENAMEAT"]=" 1"
+D["HAVE_RENAMEAT2"]=" 1"
+D["HAVE_SCHED_GETCPU"]=" 1"
+D["HAVE_SENDMMSG"]=" 1"
+D["HAVE_SETHOSTID"]=" 1"
+D["HAVE_SETNS"]=" 1"
+D["HAVE_SIGPENDING"]=" 1"
+D["HAVE_SPLICE"]=" 1"
+D["HAVE_STATX"]=" 1"
+D["HAVE_SYNC_FILE_RANGE"]=" 1"
+D["HAVE_SYNCFS"]=" 1"
+D["HAVE_TEE"]=" 1"
+D["HAVE_TIMERFD_CREATE"]=" 1"
+D["HAVE_TIMERFD_GETTIME"]=" 1"
+D["HAVE_TIMERFD_SETTIME"]=" 1"
+D["HAVE_UNSHARE"]=" 1"
+D["HAVE_VMSPLICE"]=" 1"
+D["HAVE_MKDTEMP"]=" 1"
+D["HAVE_STRUCT_PERF_EVENT_MMAP_PAGE_AUX_HEAD"]=" 1"
+D["HAVE_STRUCT_SIGACTION_SA_SIGACTION"]=" 1"
+D["HAVE_STRUCT_STATX_STX_MNT_ID"]=" 1"
+D["HAVE_STRUCT_STATX_STX_DIO_MEM_ALIGN"]=" 1"
+D["HAVE_STRUCT_UTSNAME_DOMAINNAME"]=" 1"
+D["HAVE_ENUM_KCMP_TYPE"]=" 1"
+D["HAVE_STRUCT_ACCT_V3"]=" 1"
+D["HAVE_STRUCT_AF_ALG_IV"]=" 1"
+D["HAVE_STRUCT_SOCKADDR_ALG"]=" 1"
+D["HAVE_STRUCT_FANOTIFY_EVENT_INFO_FID"]=" 1"
+D["HAVE_STRUCT_FANOTIFY_EVENT_INFO_ERROR"]=" 1"
+D["HAVE_STRUCT_FANOTIFY_EVENT_INFO_HEADER"]=" 1"
+D["HAVE_STRUCT_FANOTIFY_EVENT_INFO_PIDFD"]=" 1"
+D["HAVE_STRUCT_FILE_DEDUPE_RANGE"]=" 1"
+D["HAVE_STRUCT_FILE_HANDLE"]=" 1"
+D["HAVE_STRUCT_IF_NEXTDQBLK"]=" 1"
+D["HAVE_STRUCT_IOVEC"]=" 1"
+D["HAVE_STRUCT_LOOP_CONFIG"]=" 1"
+D["HAVE_STRUCT_MMSGHDR"]=" 1"
+D["HAVE_STRUCT_RLIMIT64"]=" 1"
+D["HAVE_STRUCT_STATX"]=" 1"
+D["HAVE_STRUCT_STATX_TIMESTAMP"]=" 1"
+D["HAVE_STRUCT_TERMIO"]=" 1"
+D["HAVE_STRUCT_TPACKET_REQ3"]=" 1"
+D["HAVE_STRUCT_USER_DESC"]=" 1"
+D["HAVE_STRUCT_XT_ENTRY_MATCH"]=" 1"
+D["HAVE_STRUCT_XT_ENTRY_TARGET"]=" 1"
+D["HAVE_STRUCT_FUTEX_WAITV"]=" 1"
+D["HAVE_STRUCT_MOUNT_ATTR"]=" 1"
+D["HAVE_ATOMIC_MEMORY_MODEL"]=" 1"
+D["HAVE_BUILTIN_CLEAR_CACHE"]=" 1"
+D["HAVE_OPENSSL_SHA_H"]=" 1"
+D["HAVE_LIBCRYPTO"]=" 1"
+D["HAVE_SYS_PTRACE_H"]=" 1"
+D["HAVE_SYS_REG_H"]=" 1"
+D["HAVE_ASM_PTRACE_H"]=" 1"
+D["HAVE_LINUX_PTRACE_H"]=" 1"
+D["HAVE_STRUCT_PT_REGS"]=" 1"
+D["HAVE_DECL_PTRACE_GETSIGINFO"]=" 1"
+D["HAVE_DECL_PTRACE_O_TRACEVFORKDONE"]=" 1"
+D["HAVE_DECL_PTRACE_SETOPTIONS"]=" 1"
+D["HAVE_LINUX_RANDOM_H"]=" 1"
+D["HAVE_FORK"]=" 1"
+D["HAVE_DAEMON"]=" 1"
+D["HAVE_VFORK"]=" 1"
+D["HAVE_SYNC_ADD_AND_FETCH"]=" 1"
+D["HAVE_STRUCT_F_OWNER_EX"]=" 1"
+D["HAVE_LINUX_FSVERITY_H"]=" 1"
+D["HAVE_STRUCT_FSVERITY_ENABLE_ARG"]=" 1"
+D["HAVE_NUMA_H"]=" 1"
+D["HAVE_NUMAIF_H"]=" 1"
+D["HAVE_NUMA_V2"]=" 1"
+D["NUMA_ERROR_MSG"]=" \"test requires libnuma development packages with LIBNUMA_API_VERSION >= 2\""
+D["HAVE_SIGNALFD"]=" 1"
+D["HAVE_SYS_SIGNALFD_H"]=" 1"
+D["HAVE_LINUX_SIGNALFD_H"]=" 1"
+D["HAVE_STRUCT_SIGNALFD_SIGINFO_SSI_SIGNO"]=" 1"
+D["HAVE_UTIMENSAT"]=" 1"
+D["HAVE_LINUX_TASKSTATS_H"]=" 1"
+D["HAVE_STRUCT_TASKSTATS_FREEPAGES_COUNT"]=" 1"
+D["HAVE_STRUCT_TASKSTATS_NVCSW"]=" 1"
+D["HAVE_STRUCT_TASKSTATS_READ_BYTES"]=" 1"
+  for (key in D) D_is_set[key] = 1
+  FS = ""
+}
+/^[\t ]*#[\t ]*(define|undef)[\t ]+[_abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ][_abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789]*([\t (]|$)/ {
+  line = $ 0
+  split(line, arg, " ")
+  if (arg[1] == "#") {
+    defundef = arg[2]
+    mac1 = arg[3]
+  } else {
+    defundef = substr(arg[1], 2)
+    mac1 = arg[2]
+  }
+  split(mac1, mac2, "(") #)
+  macro = mac2[1]
+  prefix = substr(line, 1, index(line, defundef) - 1)
+  if (D_is_set[macro]) {
+    # Preserve the white space surrounding the "#".
+    print prefix "define", macro P[macro] D[macro]
+    next
+  } else {
+    # Replace #undef with comments.  This is necessary, for example,
+    # in the case of _POSIX_SOURCE, which is predefined and required
+    # on some systems where configure will not decide to define it.
+    if (defundef == "undef") {
+      print "/*", prefix defundef, macro, "*/"
+      next
+    }
+  }
+}
+{ print }
@@ -44,6 +44,10 @@
 # define FS_NODUMP_FL	   0x00000040 /* do not dump file */
 #endif
 
+#ifndef FICLONE
+# define FICLONE		_IOW(0x94, 9, int)
+#endif
+
 #ifndef FS_VERITY_FL
 # define FS_VERITY_FL	   0x00100000 /* Verity protected inode */
 #endif
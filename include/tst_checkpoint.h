@@ -19,6 +19,9 @@
 #define TST_CHECKPOINT_WAKE2(id, nr_wake) \
         tst_safe_checkpoint_wake(__FILE__, __LINE__, NULL, id, nr_wake)
 
+#define TST_CHECKPOINT_BARRIER(id, nr_procs) \
+        tst_safe_checkpoint_barrier(__FILE__, __LINE__, NULL, id, nr_procs)
+
 #define TST_CHECKPOINT_WAKE_AND_WAIT(id) do { \
         tst_safe_checkpoint_wake(__FILE__, __LINE__, NULL, id, 1); \
         tst_safe_checkpoint_wait(__FILE__, __LINE__, NULL, id, 0); \
@@ -31,6 +31,26 @@ int tst_checkpoint_wait(unsigned int id, unsigned int msec_timeout);
 int tst_checkpoint_wake(unsigned int id, unsigned int nr_wake,
                         unsigned int msec_timeout);
 
+/*
+ * Blocks until nr_procs processes/threads have called the barrier. The
+ * checkpoint id must not be used for wait/wake at the same time.
+ *
+ * @id: Checkpoint id, positive number
+ * @nr_procs: Number of processes/threads meeting at the barrier
+ * @msec_timeout: Timeout in milliseconds
+ */
+int tst_checkpoint_barrier(unsigned int id, unsigned int nr_procs,
+			   unsigned int msec_timeout);
+
+/*
+ * Returns the number of successful tst_checkpoint_wake() calls done by this
+ * process and the average and maximal time they took, i.e. how long the
+ * waker had to wait for the waiters to arrive.
+ */
+void tst_checkpoint_stats(unsigned long long *count,
+			  unsigned long long *avg_ns,
+			  unsigned long long *max_ns);
+
 void tst_safe_checkpoint_wait(const char *file, const int lineno,
                               void (*cleanup_fn)(void), unsigned int id,
 			      unsigned int msec_timeout);
@@ -39,4 +59,8 @@ void tst_safe_checkpoint_wake(const char *file, const int lineno,
                               void (*cleanup_fn)(void), unsigned int id,
                               unsigned int nr_wake);
 
+void tst_safe_checkpoint_barrier(const char *file, const int lineno,
+				 void (*cleanup_fn)(void), unsigned int id,
+				 unsigned int nr_procs);
+
 #endif /* TST_CHECKPOINT_FN__ */
@@ -8,9 +8,50 @@
 #include <stdint.h>
 #include <stddef.h>
 
+/*
+ * CRC32c implementations, the fastest one supported by the CPU is selected
+ * when the library is loaded.
+ */
+enum tst_crc32c_impl {
+	TST_CRC32C_AUTO,
+	/* table lookup per byte */
+	TST_CRC32C_BYTE,
+	/* table lookup per byte, eight bytes per step */
+	TST_CRC32C_SLICE8,
+	/* SSE4.2 or ARMv8 CRC32 instructions */
+	TST_CRC32C_HW,
+};
+
 /*
  * Generates CRC32c checksum.
  */
 uint32_t tst_crc32c(uint8_t *buf, size_t buf_len);
 
+/*
+ * Incremental interface, the checksum of data passed in several chunks is
+ * tst_crc32c_final(tst_crc32c_update(...tst_crc32c_update(tst_crc32c_init(),
+ * chunk1, len1)..., chunkN, lenN)).
+ */
+uint32_t tst_crc32c_init(void);
+uint32_t tst_crc32c_update(uint32_t crc, const void *buf, size_t buf_len);
+uint32_t tst_crc32c_final(uint32_t crc);
+
+/*
+ * Computes CRC32c checksums of cnt independent buffers into crcs[]. The
+ * buffers are processed interleaved when the hardware implementation is used.
+ */
+void tst_crc32c_multi(unsigned int cnt, const void *const bufs[],
+		      const size_t lens[], uint32_t crcs[]);
+
+/*
+ * Forces an implementation, mostly useful for benchmarking. Returns 0 on
+ * success and -1 if the implementation is not supported on this machine.
+ */
+int tst_crc32c_set_impl(enum tst_crc32c_impl impl);
+
+/*
+ * Returns name of the implementation in use.
+ */
+const char *tst_crc32c_impl_name(void);
+
 #endif
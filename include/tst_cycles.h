@@ -0,0 +1,95 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later
+ * Copyright (c) Linux Test Project, 2026
+ */
+
+/*
+ * Calibrated CPU cycle counter clock.
+ *
+ * Reading the x86 TSC, the aarch64 virtual counter or the powerpc time base
+ * is several times cheaper than clock_gettime(), which matters when timing
+ * race windows which are only a few hundred nanoseconds long. The counter is
+ * calibrated against CLOCK_MONOTONIC_RAW and used only if it runs at a
+ * constant rate, otherwise the callers fall back to clock_gettime().
+ *
+ * The cycle clock is used by fuzzy sync and by tst_timer_start() and friends
+ * for CLOCK_MONOTONIC_RAW when LTP_CLOCK_CYCLES=1 is set.
+ */
+
+#ifndef TST_CYCLES_H__
+#define TST_CYCLES_H__
+
+#include <stdint.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(__aarch64__) || \
+    defined(__powerpc64__)
+# define TST_HAS_CYCLES 1
+#endif
+
+struct tst_cycles_clock {
+	/* counter value and CLOCK_MONOTONIC_RAW time at the calibration */
+	uint64_t base_cycles;
+	long long base_ns;
+	double ns_per_cycle;
+};
+
+extern struct tst_cycles_clock tst_cycles_clk;
+
+static inline uint64_t tst_cycles_read(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	uint32_t low, high;
+
+	/* lfence keeps rdtsc from being executed before the preceding code */
+	__asm__ __volatile__ ("lfence; rdtsc" : "=a" (low), "=d" (high)
+			      :: "memory");
+
+	return (uint64_t)high << 32 | low;
+#elif defined(__aarch64__)
+	uint64_t val;
+
+	__asm__ __volatile__ ("isb; mrs %0, cntvct_el0" : "=r" (val)
+			      :: "memory");
+
+	return val;
+#elif defined(__powerpc64__)
+	uint64_t val;
+
+	__asm__ __volatile__ ("mfspr %0, 268" : "=r" (val) :: "memory");
+
+	return val;
+#else
+	return 0;
+#endif
+}
+
+/*
+ * Calibrates the counter on the first call.
+ *
+ * Returns non-zero if the counter runs at a constant rate and can be used.
+ */
+int tst_cycles_init(void);
+
+/*
+ * Returns non-zero if LTP_CLOCK_CYCLES=1 is set and tst_cycles_init()
+ * succeeded.
+ */
+int tst_cycles_enabled(void);
+
+/*
+ * Converts the counter value to CLOCK_MONOTONIC_RAW based time. Must be called
+ * only after tst_cycles_init() succeeded.
+ */
+static inline void tst_cycles_gettime(struct timespec *ts)
+{
+	/* The counter may lag behind the base when read on another CPU */
+	int64_t cycles = (int64_t)(tst_cycles_read() -
+				   tst_cycles_clk.base_cycles);
+	long long ns = tst_cycles_clk.base_ns +
+		(long long)((double)cycles * tst_cycles_clk.ns_per_cycle);
+
+	ts->tv_sec = ns / 1000000000;
+	ts->tv_nsec = ns % 1000000000;
+}
+
+#endif /* TST_CYCLES_H__ */
@@ -0,0 +1,61 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (c) Linux Test Project, 2026
+ */
+
+/*
+ * Persistent pool of loop devices shared by test processes.
+ *
+ * When LTP_DEV_POOL is set to a directory, the library keeps loop devices
+ * attached to backing files in that directory between the tests instead of
+ * attaching and detaching a fresh device in each test temporary directory.
+ * A slot is owned by a process for as long as it holds a flock() on the slot
+ * lock file, so a crashed test releases its device automatically.
+ *
+ * Freshly formatted filesystem images are cached in the pool directory keyed
+ * by the mkfs command line, the device size and the slot, subsequent
+ * formatting of a pool device with the same parameters is replaced by a
+ * reflink clone (or a sparse copy when reflinks are not supported) of the
+ * cached image.
+ *
+ * These functions are called by the library internally, tests should not use
+ * them directly.
+ */
+
+#ifndef TST_DEV_POOL_H__
+#define TST_DEV_POOL_H__
+
+/*
+ * Returns the pool directory or NULL if the pool is not enabled.
+ */
+const char *tst_dev_pool_dir(void);
+
+/*
+ * Locks a free pool slot and returns path to its loop device with at least
+ * size MB, attaching it first if needed. Returns NULL if no slot is usable.
+ */
+const char *tst_dev_pool_acquire(unsigned int size);
+
+/*
+ * Returns non-zero if dev is the pool device owned by this process.
+ */
+int tst_dev_pool_owns(const char *dev);
+
+/*
+ * Unlocks the slot, the loop device is kept attached for the next test with
+ * the block size, offset and size limit reset.
+ */
+int tst_dev_pool_release(void);
+
+/*
+ * Restores a cached filesystem image identified by fs_key onto the pool
+ * device. Returns zero on success, non-zero if mkfs has to be run.
+ */
+int tst_dev_pool_restore_fs(const char *dev, const char *fs_key);
+
+/*
+ * Stores freshly formatted pool device as a cached image for fs_key.
+ */
+void tst_dev_pool_save_fs(const char *dev, const char *fs_key);
+
+#endif /* TST_DEV_POOL_H__ */
@@ -208,6 +208,34 @@ int tst_fs_in_skiplist(const char *fs_type, const char *const *skiplist);
  */
 void tst_fill_fs(const char *path, int verbose, enum tst_fill_access_pattern pattern);
 
+enum tst_fill_flags {
+	/* Preallocate each file with fallocate() before writing it */
+	TST_FILL_FALLOCATE = 0x01,
+	/* Write with O_DIRECT where the filesystem supports it */
+	TST_FILL_DIRECT = 0x02,
+	/* Submit the writes with io_uring where the kernel supports it */
+	TST_FILL_IO_URING = 0x04,
+};
+
+struct tst_fill_fs_opts {
+	/* Number of worker processes, 0 means number of available CPUs */
+	unsigned int workers;
+	/* Bitwise OR of enum tst_fill_flags */
+	unsigned int flags;
+	int verbose;
+};
+
+/*
+ * Fills the filesystem on given path by several worker processes, each of
+ * them writing into its own fillN subdirectory until write fails with
+ * ENOSPC. Prints the achieved throughput and returns number of bytes written.
+ *
+ * @opts May be NULL for the defaults.
+ */
+unsigned long long tst_fill_fs_parallel(const char *path,
+	enum tst_fill_access_pattern pattern,
+	const struct tst_fill_fs_opts *opts);
+
 /*
  * test if FIBMAP ioctl is supported
  */
@@ -56,6 +56,9 @@
  * For a usage example see testcases/cve/cve-2016-7117.c or just run
  * 'git grep tst_fuzzy_sync.h'
  *
+ * Several independent pairs can be raced in parallel with tst_fzsync_multi,
+ * see tst_fzsync_multi_run().
+ *
  * @sa tst_fzsync_pair
  */
 
@@ -66,6 +69,7 @@
 #include <time.h>
 #include "tst_atomic.h"
 #include "tst_cpu.h"
+#include "tst_cycles.h"
 #include "tst_timer.h"
 #include "tst_safe_pthread.h"
 
@@ -160,6 +164,8 @@ struct tst_fzsync_pair {
 	int b_cntr;
 	/** Internal; Used by tst_fzsync_pair_exit() and fzsync_pair_wait() */
 	int exit;
+	/** Internal; Exit flag shared by the pairs of tst_fzsync_multi or NULL */
+	int *stop;
 	/** Internal; The test time remaining on tst_fzsync_pair_reset() */
 	float exec_time_start;
 	/**
@@ -180,7 +186,11 @@ struct tst_fzsync_pair {
 	 * Thus call sched_yield to give up cpu to decrease the test time.
 	 */
 	bool yield_in_wait;
-
+	/**
+	 * Internal; Take the timestamps from the calibrated CPU cycle counter
+	 * rather than clock_gettime(), enabled with LTP_CLOCK_CYCLES=1.
+	 */
+	bool use_cycles;
 };
 
 #define CHK(param, low, hi, def) do {					      \
@@ -209,6 +219,8 @@ static inline void tst_fzsync_pair_init(struct tst_fzsync_pair *pair)
 
 	if (tst_ncpus_available() <= 1)
 		pair->yield_in_wait = 1;
+
+	pair->use_cycles = tst_cycles_enabled();
 }
 #undef CHK
 
@@ -323,6 +335,16 @@ static inline void tst_fzsync_time(struct timespec *t)
 #endif
 }
 
+/** Takes a timestamp with the clock selected for the pair */
+static inline void tst_fzsync_pair_time(struct tst_fzsync_pair *pair,
+					struct timespec *t)
+{
+	if (pair->use_cycles)
+		tst_cycles_gettime(t);
+	else
+		tst_fzsync_time(t);
+}
+
 /**
  * Exponential moving average
  *
@@ -656,6 +678,9 @@ static inline int tst_fzsync_run_a(struct tst_fzsync_pair *pair)
 		tst_atomic_store(1, &pair->exit);
 	}
 
+	if (pair->stop && tst_atomic_load(pair->stop))
+		tst_atomic_store(1, &pair->exit);
+
 	tst_fzsync_wait_a(pair);
 
 	if (pair->exit) {
@@ -715,7 +740,7 @@ static inline void tst_fzsync_start_race_a(struct tst_fzsync_pair *pair)
 			delay++;
 	}
 
-	tst_fzsync_time(&pair->a_start);
+	tst_fzsync_pair_time(pair, &pair->a_start);
 }
 
 /**
@@ -726,7 +751,7 @@ static inline void tst_fzsync_start_race_a(struct tst_fzsync_pair *pair)
  */
 static inline void tst_fzsync_end_race_a(struct tst_fzsync_pair *pair)
 {
-	tst_fzsync_time(&pair->a_end);
+	tst_fzsync_pair_time(pair, &pair->a_end);
 	tst_fzsync_pair_wait(&pair->a_cntr, &pair->b_cntr,
 			     &pair->spins, &pair->exit, pair->yield_in_wait);
 }
@@ -754,7 +779,7 @@ static inline void tst_fzsync_start_race_b(struct tst_fzsync_pair *pair)
 			delay--;
 	}
 
-	tst_fzsync_time(&pair->b_start);
+	tst_fzsync_pair_time(pair, &pair->b_start);
 }
 
 /**
@@ -765,7 +790,7 @@ static inline void tst_fzsync_start_race_b(struct tst_fzsync_pair *pair)
  */
 static inline void tst_fzsync_end_race_b(struct tst_fzsync_pair *pair)
 {
-	tst_fzsync_time(&pair->b_end);
+	tst_fzsync_pair_time(pair, &pair->b_end);
 	tst_fzsync_pair_wait(&pair->b_cntr, &pair->a_cntr,
 			     &pair->spins, &pair->exit, pair->yield_in_wait);
 }
@@ -800,4 +825,133 @@ static inline void tst_fzsync_pair_add_bias(struct tst_fzsync_pair *pair, int ch
 		pair->delay_bias += change;
 }
 
+/**
+ * Placement of the two threads of a pair on the CPUs
+ *
+ * @relates tst_fzsync_multi
+ */
+enum tst_fzsync_placement {
+	/** Not pinned, used when there are no CPUs left for the others */
+	TST_FZSYNC_UNPINNED,
+	/** SMT siblings of a single core */
+	TST_FZSYNC_SAME_CORE,
+	/** Different cores which share the last level cache */
+	TST_FZSYNC_SAME_LLC,
+	/** Cores in different packages */
+	TST_FZSYNC_CROSS_SOCKET,
+	TST_FZSYNC_PLACEMENTS,
+};
+
+/**
+ * One of the pairs of tst_fzsync_multi
+ *
+ * Thread A and thread B of the pair are started with a pointer to this
+ * structure as their argument and use the pair member with the usual
+ * tst_fzsync_run_a(), tst_fzsync_start_race_a() etc.
+ */
+struct tst_fzsync_multi_pair {
+	struct tst_fzsync_pair pair;
+	/** Test specific data, may be set after tst_fzsync_multi_init() */
+	void *priv;
+	/** Index of the pair */
+	int idx;
+	enum tst_fzsync_placement placement;
+	/** CPUs the threads are pinned to or -1 */
+	int cpu_a;
+	int cpu_b;
+	/** Internal; Number of tst_fzsync_multi_hit() calls */
+	unsigned long hits;
+	/** Internal; Thread A */
+	pthread_t thread_a;
+	/** Internal; The tst_fzsync_multi this pair belongs to */
+	struct tst_fzsync_multi *multi;
+};
+
+/**
+ * The state of several fuzzy sync pairs raced in parallel
+ *
+ * Every pair runs its own thread A and thread B, the threads of each pair
+ * are pinned to two CPUs chosen according to the pair placement. When any of
+ * the pairs calls tst_fzsync_multi_hit() all the pairs exit their loops.
+ *
+ * thread A:
+ *
+ * while (tst_fzsync_run_a(&mp->pair)) {
+ *	tst_fzsync_start_race_a(&mp->pair);
+ *	// Do some dodgy syscall
+ *	tst_fzsync_end_race_a(&mp->pair);
+ *	if (race_was_hit)
+ *		tst_fzsync_multi_hit(mp);
+ * }
+ *
+ * Thread B is the same as with a single pair, only with &mp->pair.
+ */
+struct tst_fzsync_multi {
+	/**
+	 * Number of pairs, defaults to half of the available CPUs.
+	 */
+	int npairs;
+	/**
+	 * Bitmask of (1 << TST_FZSYNC_*) placements which are cycled through
+	 * the pairs, defaults to all of them.
+	 */
+	unsigned int placements;
+	/**
+	 * Template for the pairs, the parameters set here are copied to all
+	 * of them by tst_fzsync_multi_init().
+	 */
+	struct tst_fzsync_pair pair;
+	/** Internal; Array of npairs pairs */
+	struct tst_fzsync_multi_pair *pairs;
+	/** Internal; Set when the race was hit */
+	int stop;
+};
+
+/**
+ * Allocates the pairs and assigns the CPUs
+ *
+ * @relates tst_fzsync_multi
+ *
+ * Call this from the setup function.
+ */
+void tst_fzsync_multi_init(struct tst_fzsync_multi *multi);
+
+/**
+ * Runs all the pairs until one of them hits the race or all of them exit
+ *
+ * @relates tst_fzsync_multi
+ * @param run_a The function defining thread A of each pair.
+ * @param run_b The function defining thread B of each pair.
+ *
+ * Call this from the main test function, the calling thread only waits for
+ * the pairs. Prints the hit rate for each placement when done.
+ *
+ * @return The number of tst_fzsync_multi_hit() calls.
+ */
+unsigned long tst_fzsync_multi_run(struct tst_fzsync_multi *multi,
+				   void *(*run_a)(void *),
+				   void *(*run_b)(void *));
+
+/**
+ * Stops all the threads and frees the pairs
+ *
+ * @relates tst_fzsync_multi
+ *
+ * Call this from the cleanup function.
+ */
+void tst_fzsync_multi_cleanup(struct tst_fzsync_multi *multi);
+
+/**
+ * Reports that the race was hit and makes all the pairs exit
+ *
+ * @relates tst_fzsync_multi_pair
+ *
+ * Call this from thread A of the pair.
+ */
+static inline void tst_fzsync_multi_hit(struct tst_fzsync_multi_pair *mp)
+{
+	mp->hits++;
+	tst_atomic_store(1, &mp->multi->stop);
+}
+
 #endif /* TST_FUZZY_SYNC_H__ */
@@ -0,0 +1,103 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later
+ * Copyright (c) Linux Test Project, 2026
+ */
+
+/*
+ * Log-linear latency histogram in the spirit of HdrHistogram.
+ *
+ * Values in [0, 2^sub_bits) are counted exactly, larger values fall into
+ * buckets whose width doubles with each power of two, so the relative error
+ * of any reported value is below 2^-sub_bits. Recording is O(1) and the
+ * memory does not depend on the number of samples. Histograms with the same
+ * parameters can be recorded per thread and merged afterwards.
+ *
+ * The library does not depend on tst_test.h so that it can be linked into
+ * tools outside of the test library as well.
+ */
+
+#ifndef TST_HISTOGRAM_H__
+#define TST_HISTOGRAM_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+struct tst_histogram {
+	unsigned int sub_bits;
+	unsigned int nbuckets;
+	long long max_value;
+	uint64_t *counts;
+
+	/* exact statistics of the recorded values */
+	uint64_t count;
+	long long min;
+	long long max;
+	long double sum;
+	long double sum_sq;
+};
+
+/*
+ * Allocates buckets for values in [0, max_value] with relative precision
+ * 2^-sub_bits. Negative values are recorded as 0, values over max_value as
+ * max_value, the exact min, max and mean are kept regardless.
+ *
+ * Returns 0 on success, -1 and sets errno on failure.
+ */
+int tst_histogram_init(struct tst_histogram *h, long long max_value,
+		       unsigned int sub_bits);
+
+void tst_histogram_free(struct tst_histogram *h);
+
+/*
+ * Clears the recorded values and keeps the buckets.
+ */
+void tst_histogram_reset(struct tst_histogram *h);
+
+void tst_histogram_record(struct tst_histogram *h, long long value);
+
+/*
+ * Adds all values from src into dst. Returns -1 and sets errno to EINVAL if
+ * the histograms were initialized with different parameters.
+ */
+int tst_histogram_merge(struct tst_histogram *dst,
+			const struct tst_histogram *src);
+
+/*
+ * Returns the value at percentile p in [0, 100], i.e. a value that is not
+ * exceeded by p % of the recorded values, or 0 for empty histogram.
+ */
+long long tst_histogram_percentile(const struct tst_histogram *h, double p);
+
+double tst_histogram_mean(const struct tst_histogram *h);
+
+/*
+ * Population variance of the recorded values, the library does not link
+ * libm so the caller takes the square root for standard deviation.
+ */
+double tst_histogram_variance(const struct tst_histogram *h);
+
+/*
+ * Bucket access for iterating over the histogram, bucket idx counts values
+ * in [tst_histogram_bucket_lo(), tst_histogram_bucket_hi()].
+ */
+long long tst_histogram_bucket_lo(const struct tst_histogram *h,
+				  unsigned int idx);
+long long tst_histogram_bucket_hi(const struct tst_histogram *h,
+				  unsigned int idx);
+
+/*
+ * Returns value representing bucket idx, i.e. the middle of the bucket
+ * clamped to the recorded minimum and maximum.
+ */
+long long tst_histogram_bucket_value(const struct tst_histogram *h,
+				     unsigned int idx);
+
+/*
+ * Writes "value,count,percentile" lines for all non-empty buckets, where
+ * value is the upper bound of the bucket and percentile is the cumulative
+ * percentage of values up to that bucket.
+ *
+ * Returns 0 on success, -1 on write error.
+ */
+int tst_histogram_write_csv(const struct tst_histogram *h, FILE *f);
+
+#endif /* TST_HISTOGRAM_H__ */
@@ -10,6 +10,13 @@
  */
 int tst_kernel_bits(void);
 
+/*
+ * The driver checks below look the name up in an index of modules.dep,
+ * modules.builtin and modules.alias from /lib/modules/$(uname -r) which is
+ * built on the first call. Dashes and underscores in the name are
+ * equivalent.
+ */
+
 /*
  * Checks if the kernel module is built-in.
  *
@@ -0,0 +1,64 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later
+ * Copyright (c) Linux Test Project, 2026
+ */
+
+/*
+ * Fast fill and verify of large memory regions with a byte value.
+ *
+ * The verification compares the memory against the value with wide vector
+ * loads and does not allocate a shadow buffer, the mismatches are summarized
+ * as ranges. Both functions can split the region between several threads.
+ */
+
+#ifndef TST_MEM_PATTERN_H__
+#define TST_MEM_PATTERN_H__
+
+#include <stddef.h>
+
+/* Maximal number of mismatching ranges stored in struct tst_mem_verify_res */
+#define TST_MEM_RANGES_MAX 16
+
+struct tst_mem_range {
+	/* offset of the first byte from the start of the region */
+	size_t off;
+	size_t len;
+	/* value of the first byte in the range */
+	unsigned char found;
+};
+
+struct tst_mem_verify_res {
+	/* number of bytes that differ from the expected value */
+	size_t bad_bytes;
+	/* number of all mismatching ranges found */
+	size_t nranges;
+	/* the first min(nranges, TST_MEM_RANGES_MAX) ranges */
+	struct tst_mem_range ranges[TST_MEM_RANGES_MAX];
+};
+
+/*
+ * Threads argument of the functions below, 0 picks the number of threads
+ * based on the region size and the number of available CPUs.
+ */
+#define TST_MEM_THREADS_AUTO 0
+
+/*
+ * Fills size bytes at addr with value c.
+ */
+void tst_mem_fill(void *addr, size_t size, int c, unsigned int threads);
+
+/*
+ * Checks that all size bytes at addr are equal to c and fills res, which may
+ * be NULL if only the number of mismatching bytes is needed.
+ *
+ * Returns the number of mismatching bytes.
+ */
+size_t tst_mem_verify(const void *addr, size_t size, int c,
+		      unsigned int threads, struct tst_mem_verify_res *res);
+
+/*
+ * Prints the mismatching ranges as TFAIL messages prefixed with desc.
+ */
+void tst_mem_verify_report(const struct tst_mem_verify_res *res, int c,
+			   const char *desc);
+
+#endif /* TST_MEM_PATTERN_H__ */
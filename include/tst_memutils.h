@@ -16,9 +16,23 @@
  * The function keeps a safety margin to avoid invoking OOM killer and
  * respects the limitations of available address space. (Less than 3GB can be
  * polluted on a 32bit system regardless of available physical RAM.)
+ *
+ * The memory is filled in parallel by one worker process per available CPU,
+ * each pinned to its CPU so that every NUMA node gets polluted. The amount of
+ * polluted memory and the throughput are reported as TINFO.
  */
 void tst_pollute_memory(size_t maxsize, int fillchar);
 
+/* Back the polluted memory with transparent huge pages where possible */
+#define TST_POLLUTE_THP		0x01
+/* Fill up to maxsize of the free hugetlb pool pages as well */
+#define TST_POLLUTE_HUGETLB	0x02
+
+/*
+ * Same as tst_pollute_memory() with TST_POLLUTE_* flags.
+ */
+void tst_pollute_memory_flags(size_t maxsize, int fillchar, int flags);
+
 /*
  * Read the value of MemAvailable from /proc/meminfo, if no support on
  * older kernels, return 'MemFree + Cached' for instead.
@@ -6,6 +6,10 @@
 /*
  * These functions helps you wait till a process with given pid changes state.
  * This is for example useful when you need to wait in parent until child blocks.
+ *
+ * The state is re-read from an open /proc/<pid>/stat file, a few times with
+ * sched_yield() in between and then with sleeps growing up to 1ms. The exit
+ * is waited for on a pidfd where pidfd_open() is supported.
  */
 
 #ifndef TST_PROCESS_STATE__
@@ -31,7 +35,8 @@
 			(pid), (state), (msec_timeout))
 
 /*
- * Check that a given pid is present on the system
+ * Waits until a given pid is no longer present on the system, returns 1 on
+ * success and 0 on timeout.
  */
 #define TST_PROCESS_EXIT_WAIT(pid, msec_timeout) \
 	tst_process_exit_wait((pid), (msec_timeout))
@@ -75,4 +80,35 @@ int tst_process_state_wait(const char *file, const int lineno,
 			   const char state, unsigned int msec_timeout);
 int tst_process_exit_wait(pid_t pid, unsigned int msec_timeout);
 
+/*
+ * Waits until each of the npids processes has been seen in the state, the
+ * processes are checked in order and each one only until it reaches the
+ * state. The /proc/<pid>/stat files are kept open for the whole wait.
+ *
+ * Returns zero on success, -1 with errno set to ETIMEDOUT on timeout or to
+ * ESRCH if one of the processes does not exist.
+ */
+int tst_process_state_wait_many(const pid_t *pids, unsigned int npids,
+				const char state, unsigned int msec_timeout);
+
+/*
+ * Statistics of the waits done by the current process with the functions
+ * above, except for tst_thread_state_wait().
+ */
+struct tst_process_wait_stats {
+	/* finished waits, including the timed out ones */
+	unsigned long waits;
+	unsigned long timeouts;
+	/* /proc/<pid>/stat reads */
+	unsigned long long polls;
+	/* sleeps after the initial spinning */
+	unsigned long long sleeps;
+	/* time spent in the waits */
+	unsigned long long total_us;
+	unsigned long long max_us;
+};
+
+void tst_process_wait_stats_get(struct tst_process_wait_stats *stats);
+void tst_process_wait_stats_reset(void);
+
 #endif /* TST_PROCESS_STATE__ */
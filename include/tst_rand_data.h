@@ -6,10 +6,30 @@
 #define TST_RAND_DATA_H__
 
 #include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
 
 /* Includes null byte */
 extern const size_t tst_rand_data_len;
 /* statically defined random data */
 extern const char *const tst_rand_data;
 
+/*
+ * Fills buf with len bytes of the pseudo random stream identified by seed,
+ * starting at byte offset off of the stream. The stream does not repeat
+ * within a file, so the data does not compress or deduplicate, and any part
+ * of it can be regenerated later for verification without storing it.
+ *
+ * The stream is the same on all architectures for a given seed.
+ */
+void tst_rand_data_fill(uint64_t seed, uint64_t off, void *buf, size_t len);
+
+/*
+ * Checks that buf contains len bytes of the stream identified by seed
+ * starting at offset off. Returns -1 if the data matches, index of the first
+ * mismatching byte in buf otherwise.
+ */
+ssize_t tst_rand_data_verify(uint64_t seed, uint64_t off, const void *buf,
+			     size_t len);
+
 #endif
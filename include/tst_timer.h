@@ -99,6 +99,12 @@ static inline long long tst_timeval_diff_ms(struct timeval t1,
 
 typedef __kernel_long_t	__kernel_old_time_t;
 
+/*
+ * <linux/time_types.h> (pulled in by <linux/io_uring.h> among others)
+ * defines these even when configure did not detect them.
+ */
+#ifndef _LINUX_TIME_TYPES_H
+
 #ifndef HAVE_STRUCT___KERNEL_OLD_TIMEVAL
 struct __kernel_old_timeval {
 	__kernel_old_time_t	tv_sec;		/* seconds */
@@ -122,19 +128,21 @@ struct __kernel_timespec {
 };
 #endif
 
-#ifndef HAVE_STRUCT___KERNEL_OLD_ITIMERSPEC
-struct __kernel_old_itimerspec {
-	struct __kernel_old_timespec it_interval;    /* timer period */
-	struct __kernel_old_timespec it_value;       /* timer expiration */
-};
-#endif
-
 #ifndef HAVE_STRUCT___KERNEL_ITIMERSPEC
 struct __kernel_itimerspec {
 	struct __kernel_timespec it_interval;    /* timer period */
 	struct __kernel_timespec it_value;       /* timer expiration */
 };
 #endif
+
+#endif /* _LINUX_TIME_TYPES_H */
+
+#ifndef HAVE_STRUCT___KERNEL_OLD_ITIMERSPEC
+struct __kernel_old_itimerspec {
+	struct __kernel_old_timespec it_interval;    /* timer period */
+	struct __kernel_old_timespec it_value;       /* timer expiration */
+};
+#endif
 #endif
 
 enum tst_ts_type {
@@ -4,11 +4,11 @@
 LTP_C_API_TESTS="${LTP_C_API_TESTS:-test05 test07 test09 test15 test_runtime01
 tst_needs_cmds01 tst_needs_cmds02 tst_needs_cmds03 tst_needs_cmds06
 tst_needs_cmds07 tst_bool_expr test_exec test_timer tst_res_hexd tst_strstatus
-tst_fuzzy_sync03 test_zero_hugepage.sh test_kconfig.sh
+tst_fuzzy_sync03 tst_fuzzy_sync04 tst_crc32c tst_rand_data tst_histogram tst_checkpoint_rounds tst_mem_pattern tst_pollute_memory tst_process_state_wait test_zero_hugepage.sh test_kconfig.sh
 test_children_cleanup.sh}"
 
 LTP_SHELL_API_TESTS="${LTP_SHELL_API_TESTS:-shell/tst_check_driver.sh
-shell/tst_check_kconfig0[1-5].sh shell/tst_errexit.sh shell/net/*.sh}"
+shell/tst_check_kconfig0[1-5].sh shell/tst_errexit.sh shell/tst_shd01.sh shell/net/*.sh}"
 
 cd $(dirname $0)
 PATH="$PWD/../../testcases/lib/:$PATH"
@@ -0,0 +1,59 @@
+#!/bin/sh
+# SPDX-License-Identifier: GPL-2.0-or-later
+# Copyright (c) Linux Test Project, 2026
+
+# Checks the tst_shd helper process, passes with LTP_SHD=0 as well
+
+TST_TESTFUNC=test
+TST_CNT=3
+
+# Reports only from a subshell, TBROK if the result is not counted
+test1()
+{
+	if [ "$LTP_SHD" = 0 ]; then
+		tst_res TCONF "Subshell results are counted only by tst_shd"
+		return
+	fi
+
+	echo "subshell" | while read -r line; do
+		tst_res TPASS "result from $line counted"
+	done
+}
+
+test2()
+{
+	local desc="LTP_SHD=${LTP_SHD:-1}"
+	local page_size=$(command tst_getconf PAGESIZE)
+	local val
+
+	val=$(tst_getconf PAGESIZE)
+	[ "$val" = "$page_size" ] || \
+		tst_res TFAIL "$desc: tst_getconf PAGESIZE '$val' expected '$page_size'"
+
+	val=$(tst_random 5 7)
+	[ "$val" -ge 5 -a "$val" -le 7 ] 2>/dev/null || \
+		tst_res TFAIL "$desc: tst_random 5 7 returned '$val'"
+
+	val=$(tst_get_unused_port ipv4 stream)
+	[ "$val" -gt 0 ] 2>/dev/null || \
+		tst_res TFAIL "$desc: tst_get_unused_port returned '$val'"
+
+	tst_res TPASS "$desc: helpers work"
+}
+
+# tst_shd answers only some getconf variables, the binary does the rest
+test3()
+{
+	local val=$(tst_getconf _NPROCESSORS_CONF)
+	local exp=$(command tst_getconf _NPROCESSORS_CONF)
+
+	if [ -z "$val" -o "$val" != "$exp" ]; then
+		tst_res TFAIL "tst_getconf _NPROCESSORS_CONF '$val' expected '$exp'"
+		return
+	fi
+
+	tst_res TPASS "tst_getconf falls back to the binary"
+}
+
+. tst_test.sh
+tst_run
@@ -0,0 +1,105 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (c) Linux Test Project, 2026
+ */
+
+/*
+ * Does many checkpoint wake/wait rounds between parent and child, where the
+ * waiter is usually late, then synchronizes several children on a barrier
+ * and prints the handshake latency of the waker.
+ */
+
+#include <stdlib.h>
+#include "tst_test.h"
+
+#define ROUNDS 10000
+#define BARRIER_PROCS 8
+#define BARRIER_ROUNDS 1000
+
+static int *counter;
+
+static void ping_pong(void)
+{
+	unsigned long long cnt, avg_ns, max_ns;
+	int i;
+
+	if (!SAFE_FORK()) {
+		for (i = 0; i < ROUNDS; i++)
+			TST_CHECKPOINT_WAKE_AND_WAIT(0);
+
+		TST_CHECKPOINT_WAKE(0);
+		exit(0);
+	}
+
+	for (i = 0; i < ROUNDS; i++) {
+		TST_CHECKPOINT_WAIT(0);
+		TST_CHECKPOINT_WAKE(0);
+	}
+
+	TST_CHECKPOINT_WAIT(0);
+	tst_reap_children();
+
+	tst_checkpoint_stats(&cnt, &avg_ns, &max_ns);
+	tst_res(TPASS, "%i rounds done, wake handshake avg %llins max %llins",
+		ROUNDS, avg_ns, max_ns);
+}
+
+static void barrier(void)
+{
+	int i, j;
+
+	*counter = 0;
+
+	for (i = 0; i < BARRIER_PROCS; i++) {
+		if (!SAFE_FORK()) {
+			for (j = 0; j < BARRIER_ROUNDS; j++) {
+				tst_atomic_add_return(1, counter);
+				TST_CHECKPOINT_BARRIER(1, BARRIER_PROCS);
+
+				/* All processes have incremented before anyone passed */
+				if (tst_atomic_load(counter) < (j + 1) * BARRIER_PROCS)
+					tst_brk(TBROK, "Passed barrier too early");
+
+				TST_CHECKPOINT_BARRIER(1, BARRIER_PROCS);
+			}
+			exit(0);
+		}
+	}
+
+	tst_reap_children();
+
+	if (*counter != BARRIER_PROCS * BARRIER_ROUNDS) {
+		tst_res(TFAIL, "Counter %i, expected %i", *counter,
+			BARRIER_PROCS * BARRIER_ROUNDS);
+		return;
+	}
+
+	tst_res(TPASS, "%i processes passed %i barriers", BARRIER_PROCS,
+		BARRIER_ROUNDS * 2);
+}
+
+static void run(void)
+{
+	ping_pong();
+	barrier();
+}
+
+static void setup(void)
+{
+	counter = SAFE_MMAP(NULL, sizeof(*counter), PROT_READ | PROT_WRITE,
+			    MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+}
+
+static void cleanup(void)
+{
+	if (counter)
+		SAFE_MUNMAP(counter, sizeof(*counter));
+}
+
+static struct tst_test test = {
+	.setup = setup,
+	.cleanup = cleanup,
+	.test_all = run,
+	.forks_child = 1,
+	.needs_checkpoints = 1,
+};
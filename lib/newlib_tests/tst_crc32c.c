@@ -0,0 +1,154 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (c) Linux Test Project, 2026
+ */
+
+/*
+ * Checks that all tst_crc32c() implementations supported by the machine
+ * produce the same checksums, including the incremental and multi-buffer
+ * interfaces, and prints their throughput compared to the byte-at-a-time
+ * table lookup.
+ */
+
+#include <stdlib.h>
+#include "tst_test.h"
+#include "tst_safe_clocks.h"
+#include "tst_timer.h"
+#include "tst_checksum.h"
+
+#define BUF_SIZE (16 * 1024 * 1024)
+#define BENCH_LOOPS 4
+#define MULTI_CNT 7
+
+static uint8_t *buf;
+static uint32_t ref_crc;
+
+static struct impl {
+	enum tst_crc32c_impl impl;
+	const char *name;
+} impls[] = {
+	{TST_CRC32C_BYTE, "byte"},
+	{TST_CRC32C_SLICE8, "slice-by-8"},
+	{TST_CRC32C_HW, "hardware"},
+};
+
+static void setup(void)
+{
+	size_t i;
+
+	buf = SAFE_MALLOC(BUF_SIZE);
+
+	srand(42);
+	for (i = 0; i < BUF_SIZE; i++)
+		buf[i] = rand();
+
+	tst_crc32c_set_impl(TST_CRC32C_BYTE);
+	ref_crc = tst_crc32c(buf, BUF_SIZE);
+}
+
+static void check_vector(void)
+{
+	uint8_t check[] = "123456789";
+	uint32_t crc = tst_crc32c(check, 9);
+
+	if (crc == 0xe3069283)
+		tst_res(TPASS, "crc32c(\"123456789\") = 0x%08x", crc);
+	else
+		tst_res(TFAIL, "crc32c(\"123456789\") = 0x%08x, expected 0xe3069283", crc);
+}
+
+static void check_update(void)
+{
+	uint32_t crc = tst_crc32c_init();
+	size_t off = 0, len;
+
+	/* Odd chunk sizes exercise the unaligned heads and tails */
+	for (len = 1; off < BUF_SIZE; len = len * 3 + 1) {
+		len = MIN(len, BUF_SIZE - off);
+		crc = tst_crc32c_update(crc, buf + off, len);
+		off += len;
+	}
+
+	crc = tst_crc32c_final(crc);
+
+	if (crc == ref_crc)
+		tst_res(TPASS, "Incremental checksum matches");
+	else
+		tst_res(TFAIL, "Incremental checksum 0x%08x, expected 0x%08x", crc, ref_crc);
+}
+
+static void check_multi(void)
+{
+	const void *bufs[MULTI_CNT];
+	size_t lens[MULTI_CNT];
+	uint32_t crcs[MULTI_CNT];
+	int i, fails = 0;
+
+	for (i = 0; i < MULTI_CNT; i++) {
+		bufs[i] = buf + i * 4099;
+		lens[i] = 65536 - i * 513;
+	}
+
+	tst_crc32c_multi(MULTI_CNT, bufs, lens, crcs);
+
+	for (i = 0; i < MULTI_CNT; i++) {
+		if (crcs[i] != tst_crc32c((uint8_t *)bufs[i], lens[i])) {
+			tst_res(TFAIL, "Multi-buffer checksum %i mismatch", i);
+			fails++;
+		}
+	}
+
+	if (!fails)
+		tst_res(TPASS, "Multi-buffer checksums match");
+}
+
+static void run(unsigned int n)
+{
+	static double byte_rate;
+	struct timespec start, end;
+	uint32_t crc = 0;
+	long long us;
+	double rate;
+	int i;
+
+	if (tst_crc32c_set_impl(impls[n].impl)) {
+		tst_res(TCONF, "%s implementation not supported", impls[n].name);
+		return;
+	}
+
+	tst_res(TINFO, "Testing %s implementation", tst_crc32c_impl_name());
+
+	check_vector();
+	check_update();
+	check_multi();
+
+	SAFE_CLOCK_GETTIME(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < BENCH_LOOPS; i++)
+		crc = tst_crc32c(buf, BUF_SIZE);
+	SAFE_CLOCK_GETTIME(CLOCK_MONOTONIC, &end);
+
+	if (crc != ref_crc)
+		tst_res(TFAIL, "Checksum 0x%08x, expected 0x%08x", crc, ref_crc);
+
+	us = MAX(tst_timespec_diff_us(end, start), 1LL);
+	rate = (double)BUF_SIZE * BENCH_LOOPS / us;
+
+	if (impls[n].impl == TST_CRC32C_BYTE)
+		byte_rate = rate;
+
+	tst_res(TINFO, "%s: %.0f MB/s (%.1fx byte)", tst_crc32c_impl_name(),
+		rate, byte_rate ? rate / byte_rate : 0);
+}
+
+static void cleanup(void)
+{
+	free(buf);
+	tst_crc32c_set_impl(TST_CRC32C_AUTO);
+}
+
+static struct tst_test test = {
+	.setup = setup,
+	.cleanup = cleanup,
+	.test = run,
+	.tcnt = ARRAY_SIZE(impls),
+};
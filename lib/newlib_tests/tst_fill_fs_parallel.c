@@ -0,0 +1,62 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (c) Linux Test Project, 2026
+ */
+
+/*
+ * Fills the device with tst_fill_fs_parallel() using all the supported
+ * backends and checks that the filesystem ends up full.
+ */
+
+#include <sys/statvfs.h>
+#include "tst_test.h"
+
+#define MNTPOINT "mntpoint"
+
+static struct tcase {
+	enum tst_fill_access_pattern pattern;
+	unsigned int flags;
+	const char *desc;
+} tcases[] = {
+	{TST_FILL_RANDOM, 0, "pwrite()"},
+	{TST_FILL_BLOCKS, TST_FILL_FALLOCATE, "fallocate() + pwrite()"},
+	{TST_FILL_RANDOM, TST_FILL_DIRECT, "O_DIRECT"},
+	{TST_FILL_RANDOM, TST_FILL_IO_URING, "io_uring"},
+	{TST_FILL_BLOCKS, TST_FILL_IO_URING | TST_FILL_DIRECT, "io_uring + O_DIRECT"},
+};
+
+static void run(unsigned int n)
+{
+	struct tcase *tc = &tcases[n];
+	struct tst_fill_fs_opts opts = {
+		.workers = 4,
+		.flags = tc->flags,
+	};
+	struct statvfs fi;
+	unsigned long long written;
+
+	tst_res(TINFO, "Filling %s with %s", MNTPOINT, tc->desc);
+
+	written = tst_fill_fs_parallel(MNTPOINT, tc->pattern, &opts);
+
+	if (statvfs(MNTPOINT, &fi))
+		tst_brk(TBROK | TERRNO, "statvfs()");
+
+	if (!written)
+		tst_res(TFAIL, "Nothing was written");
+	else if (fi.f_bavail * fi.f_bsize >= TST_MB)
+		tst_res(TFAIL, "%lu blocks still available", (unsigned long)fi.f_bavail);
+	else
+		tst_res(TPASS, "Filesystem is full");
+
+	tst_purge_dir(MNTPOINT);
+}
+
+static struct tst_test test = {
+	.needs_root = 1,
+	.mount_device = 1,
+	.mntpoint = MNTPOINT,
+	.dev_min_size = 64,
+	.test = run,
+	.tcnt = ARRAY_SIZE(tcases),
+};
@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (c) Linux Test Project, 2026
+ */
+
+/*
+ * Basic functionality test for tst_fzsync_multi. Runs several pairs to the
+ * end of their loops, then again until one of the pairs reports a hit which
+ * must stop all the others.
+ */
+
+#include "tst_test.h"
+#include "tst_safe_pthread.h"
+#include "tst_fuzzy_sync.h"
+
+#define NPAIRS 4
+#define LOOPS 2000
+#define HIT_LOOP 500
+
+static struct tst_fzsync_multi multi;
+static volatile int hit_pair = -1;
+
+static void *run_b(void *arg)
+{
+	struct tst_fzsync_multi_pair *mp = arg;
+	volatile int *last = mp->priv;
+
+	while (tst_fzsync_run_b(&mp->pair)) {
+		tst_fzsync_start_race_b(&mp->pair);
+		*last = 'B';
+		tst_fzsync_end_race_b(&mp->pair);
+	}
+
+	return NULL;
+}
+
+static void *run_a(void *arg)
+{
+	struct tst_fzsync_multi_pair *mp = arg;
+	volatile int *last = mp->priv;
+
+	while (tst_fzsync_run_a(&mp->pair)) {
+		tst_fzsync_start_race_a(&mp->pair);
+		*last = 'A';
+		tst_fzsync_end_race_a(&mp->pair);
+
+		if (mp->idx == hit_pair && mp->pair.exec_loop == HIT_LOOP)
+			tst_fzsync_multi_hit(mp);
+	}
+
+	return NULL;
+}
+
+static void check_loops(int hit)
+{
+	struct tst_fzsync_multi_pair *mp;
+	int i, fail = 0;
+
+	for (i = 0; i < multi.npairs; i++) {
+		mp = &multi.pairs[i];
+
+		/* exec_loop is incremented once more by the exiting call */
+		if (!hit && mp->pair.exec_loop != LOOPS + 1) {
+			tst_res(TFAIL, "Pair %i did %i loops", i,
+				mp->pair.exec_loop);
+			fail = 1;
+		}
+
+		if (hit && mp->pair.exec_loop > LOOPS) {
+			tst_res(TFAIL, "Pair %i was not stopped", i);
+			fail = 1;
+		}
+	}
+
+	if (!fail)
+		tst_res(TPASS, "All pairs %s", hit ? "stopped" : "finished");
+}
+
+static void run(void)
+{
+	unsigned long hits;
+
+	hit_pair = -1;
+	hits = tst_fzsync_multi_run(&multi, run_a, run_b);
+	TST_EXP_EQ_LU(hits, 0);
+	check_loops(0);
+
+	hit_pair = multi.npairs - 1;
+	hits = tst_fzsync_multi_run(&multi, run_a, run_b);
+	TST_EXP_EQ_LU(hits, 1);
+	check_loops(1);
+}
+
+static void setup(void)
+{
+	static int last[NPAIRS];
+	int i;
+
+	multi.npairs = NPAIRS;
+	multi.pair.exec_loops = LOOPS;
+	multi.pair.min_samples = 100;
+	tst_fzsync_multi_init(&multi);
+
+	for (i = 0; i < NPAIRS; i++)
+		multi.pairs[i].priv = &last[i];
+}
+
+static void cleanup(void)
+{
+	tst_fzsync_multi_cleanup(&multi);
+}
+
+static struct tst_test test = {
+	.setup = setup,
+	.cleanup = cleanup,
+	.test_all = run,
+	.max_runtime = 150,
+};
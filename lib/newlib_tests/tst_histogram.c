@@ -0,0 +1,90 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (c) Linux Test Project, 2026
+ */
+
+/*
+ * Checks tst_histogram percentiles against exactly known distributions,
+ * merging of per-thread histograms and the bucket precision.
+ */
+
+#include "tst_test.h"
+#include "tst_histogram.h"
+
+#define SUB_BITS 7
+#define MAX_VAL (1LL << 40)
+#define NVALS 1000000
+
+static struct tst_histogram h1, h2;
+
+static void check_percentile(struct tst_histogram *h, double p, long long exp)
+{
+	long long val = tst_histogram_percentile(h, p);
+	long long diff = val > exp ? val - exp : exp - val;
+
+	if (diff > (exp >> SUB_BITS))
+		tst_res(TFAIL, "p%g = %lli, expected %lli", p, val, exp);
+	else
+		tst_res(TPASS, "p%g = %lli (exact %lli)", p, val, exp);
+}
+
+static void run(void)
+{
+	long long i;
+
+	tst_histogram_reset(&h1);
+	tst_histogram_reset(&h2);
+
+	/* Values 1..NVALS split between two histograms */
+	for (i = 1; i <= NVALS; i++)
+		tst_histogram_record(i % 2 ? &h1 : &h2, i * 1000);
+
+	if (tst_histogram_merge(&h1, &h2))
+		tst_brk(TBROK | TERRNO, "tst_histogram_merge()");
+
+	if (h1.count != NVALS || h1.min != 1000 || h1.max != NVALS * 1000LL)
+		tst_res(TFAIL, "count %llu min %lli max %lli",
+			(unsigned long long)h1.count, h1.min, h1.max);
+	else
+		tst_res(TPASS, "Merged count, min and max are exact");
+
+	if (tst_histogram_mean(&h1) != (NVALS + 1) * 500.0)
+		tst_res(TFAIL, "mean %f", tst_histogram_mean(&h1));
+	else
+		tst_res(TPASS, "Mean is exact");
+
+	check_percentile(&h1, 50, NVALS / 2 * 1000LL);
+	check_percentile(&h1, 99, NVALS / 100 * 99 * 1000LL);
+	check_percentile(&h1, 99.99, NVALS / 10000 * 9999 * 1000LL);
+	check_percentile(&h1, 100, NVALS * 1000LL);
+
+	/* Small values are counted exactly */
+	tst_histogram_reset(&h1);
+	for (i = 0; i < 100; i++)
+		tst_histogram_record(&h1, i);
+
+	check_percentile(&h1, 10, 9);
+	check_percentile(&h1, 90, 89);
+}
+
+static void setup(void)
+{
+	if (tst_histogram_init(&h1, MAX_VAL, SUB_BITS) ||
+	    tst_histogram_init(&h2, MAX_VAL, SUB_BITS))
+		tst_brk(TBROK | TERRNO, "tst_histogram_init()");
+
+	tst_res(TINFO, "%u buckets, %zu bytes", h1.nbuckets,
+		h1.nbuckets * sizeof(*h1.counts));
+}
+
+static void cleanup(void)
+{
+	tst_histogram_free(&h1);
+	tst_histogram_free(&h2);
+}
+
+static struct tst_test test = {
+	.setup = setup,
+	.cleanup = cleanup,
+	.test_all = run,
+};
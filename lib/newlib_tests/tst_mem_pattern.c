@@ -0,0 +1,129 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (c) Linux Test Project, 2026
+ */
+
+/*
+ * Checks that tst_mem_verify() finds and summarizes corrupted ranges at
+ * unaligned offsets and across the thread slice boundaries, and compares the
+ * speed of single and multithreaded fill and verify.
+ */
+
+#include "tst_test.h"
+#include "tst_clocks.h"
+#include "tst_timer.h"
+#include "tst_mem_pattern.h"
+
+#define SIZE (256 * 1024 * 1024)
+#define THREADS 4
+
+static unsigned char *buf;
+
+static void check_res(struct tst_mem_verify_res *res, size_t bad_bytes,
+		      size_t nranges, const char *desc)
+{
+	if (res->bad_bytes != bad_bytes || res->nranges != nranges) {
+		tst_res(TFAIL, "%s: %zu bad bytes in %zu ranges, expected %zu in %zu",
+			desc, res->bad_bytes, res->nranges, bad_bytes, nranges);
+		return;
+	}
+
+	tst_res(TPASS, "%s: %zu bad bytes in %zu ranges", desc, bad_bytes,
+		nranges);
+}
+
+static void check_range(struct tst_mem_verify_res *res, unsigned int i,
+			size_t off, size_t len, unsigned char found)
+{
+	struct tst_mem_range *r = &res->ranges[i];
+
+	if (r->off != off || r->len != len || r->found != found) {
+		tst_res(TFAIL, "range %u: %zu+%zu 0x%02x, expected %zu+%zu 0x%02x",
+			i, r->off, r->len, r->found, off, len, found);
+		return;
+	}
+
+	tst_res(TPASS, "range %u: %zu+%zu 0x%02x", i, off, len, found);
+}
+
+static void corruption(unsigned int threads)
+{
+	struct tst_mem_verify_res res;
+	size_t slice = SIZE / THREADS;
+	unsigned int i;
+
+	tst_res(TINFO, "Verifying with %u threads", threads);
+
+	tst_mem_fill(buf, SIZE, 0x5a, threads);
+	tst_mem_verify(buf, SIZE, 0x5a, threads, &res);
+	check_res(&res, 0, 0, "clean");
+
+	buf[3] = 0;
+	memset(buf + slice - 10, 1, 20);
+	buf[SIZE - 1] = 2;
+
+	tst_mem_verify(buf, SIZE, 0x5a, threads, &res);
+	check_res(&res, 22, 3, "corrupted");
+	check_range(&res, 0, 3, 1, 0);
+	check_range(&res, 1, slice - 10, 20, 1);
+	check_range(&res, 2, SIZE - 1, 1, 2);
+
+	/* More ranges than stored */
+	for (i = 0; i < 2 * TST_MEM_RANGES_MAX; i++)
+		buf[2 * slice + 4096 * i + 1] = 3;
+
+	tst_mem_verify(buf, SIZE, 0x5a, threads, &res);
+	check_res(&res, 22 + 2 * TST_MEM_RANGES_MAX,
+		  3 + 2 * TST_MEM_RANGES_MAX, "many ranges");
+	check_range(&res, TST_MEM_RANGES_MAX - 1,
+		    2 * slice + 4096 * (TST_MEM_RANGES_MAX - 3) + 1, 1, 3);
+}
+
+static void speed(unsigned int threads, const char *desc)
+{
+	struct timespec start, end;
+	long long fill_us, verify_us;
+
+	tst_clock_gettime(CLOCK_MONOTONIC, &start);
+	tst_mem_fill(buf, SIZE, 0xa5, threads);
+	tst_clock_gettime(CLOCK_MONOTONIC, &end);
+	fill_us = tst_timespec_diff_us(end, start);
+
+	start = end;
+	if (tst_mem_verify(buf, SIZE, 0xa5, threads, NULL))
+		tst_res(TFAIL, "Mismatch after fill");
+	tst_clock_gettime(CLOCK_MONOTONIC, &end);
+	verify_us = tst_timespec_diff_us(end, start);
+
+	tst_res(TINFO, "%s: fill %lli MB/s verify %lli MB/s", desc,
+		(long long)SIZE / (fill_us ? fill_us : 1),
+		(long long)SIZE / (verify_us ? verify_us : 1));
+}
+
+static void run(void)
+{
+	corruption(1);
+	corruption(THREADS);
+
+	speed(1, "1 thread");
+	speed(TST_MEM_THREADS_AUTO, "auto threads");
+}
+
+static void setup(void)
+{
+	buf = SAFE_MMAP(NULL, SIZE, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+}
+
+static void cleanup(void)
+{
+	if (buf)
+		SAFE_MUNMAP(buf, SIZE);
+}
+
+static struct tst_test test = {
+	.setup = setup,
+	.cleanup = cleanup,
+	.test_all = run,
+	.min_mem_avail = 512,
+};
@@ -0,0 +1,56 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (c) Linux Test Project, 2026
+ */
+
+/*
+ * Pollutes an amount of memory that is not a multiple of the block size with
+ * the TST_POLLUTE_* flags and checks that the hugetlb pool pages are released
+ * afterwards.
+ */
+
+#include "tst_test.h"
+#include "tst_memutils.h"
+
+#define SIZE (40 * 1024 * 1024 + 123)
+
+static struct tcase {
+	int flags;
+	const char *desc;
+} tcases[] = {
+	{0, "no flags"},
+	{TST_POLLUTE_THP, "TST_POLLUTE_THP"},
+	{TST_POLLUTE_HUGETLB, "TST_POLLUTE_HUGETLB"},
+	{TST_POLLUTE_THP | TST_POLLUTE_HUGETLB, "both flags"},
+};
+
+static long hugepages_free(void)
+{
+	long free_pages = 0;
+
+	FILE_LINES_SCANF("/proc/meminfo", "HugePages_Free: %ld", &free_pages);
+
+	return free_pages;
+}
+
+static void run(unsigned int n)
+{
+	struct tcase *tc = &tcases[n];
+	long free_pages = hugepages_free();
+
+	tst_pollute_memory_flags(SIZE, 0x55, tc->flags);
+
+	if (hugepages_free() != free_pages) {
+		tst_res(TFAIL, "%s: %ld free huge pages, expected %ld",
+			tc->desc, hugepages_free(), free_pages);
+		return;
+	}
+
+	tst_res(TPASS, "%s: memory polluted", tc->desc);
+}
+
+static struct tst_test test = {
+	.test = run,
+	.tcnt = ARRAY_SIZE(tcases),
+	.hugepages = {2, TST_REQUEST},
+};
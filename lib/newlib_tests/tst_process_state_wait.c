@@ -0,0 +1,104 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (c) Linux Test Project, 2026
+ */
+
+/*
+ * Checks tst_process_state_wait_many() and TST_PROCESS_EXIT_WAIT() together
+ * with the wait statistics.
+ */
+
+#include <stdlib.h>
+#include "tst_test.h"
+#include "tst_timer.h"
+
+#define NCHILDREN 8
+
+static pid_t pids[NCHILDREN];
+
+static void child(unsigned int i)
+{
+	struct timespec start, now;
+
+	/* Stay runnable for a while so that the parent has to wait */
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	do {
+		clock_gettime(CLOCK_MONOTONIC, &now);
+	} while (tst_timespec_diff_ms(now, start) < i);
+
+	pause();
+	exit(0);
+}
+
+static void print_stats(const char *desc)
+{
+	struct tst_process_wait_stats stats;
+
+	tst_process_wait_stats_get(&stats);
+	tst_res(TINFO, "%s: %lu waits %lu timeouts %llu polls %llu sleeps "
+		"%lluus max %lluus", desc, stats.waits, stats.timeouts,
+		stats.polls, stats.sleeps, stats.total_us, stats.max_us);
+}
+
+static void run(void)
+{
+	struct tst_process_wait_stats stats;
+	unsigned int i;
+
+	tst_process_wait_stats_reset();
+
+	for (i = 0; i < NCHILDREN; i++) {
+		pids[i] = SAFE_FORK();
+		if (!pids[i])
+			child(i);
+	}
+
+	if (tst_process_state_wait_many(pids, NCHILDREN, 'S', 10000))
+		tst_res(TFAIL | TERRNO, "tst_process_state_wait_many()");
+	else
+		tst_res(TPASS, "All children are sleeping");
+
+	if (!tst_process_state_wait_many(pids, 1, 'T', 50) || errno != ETIMEDOUT)
+		tst_res(TFAIL | TERRNO, "Wait for 'T' did not time out");
+	else
+		tst_res(TPASS | TERRNO, "Wait for 'T' timed out");
+
+	print_stats("state waits");
+
+	tst_process_wait_stats_get(&stats);
+	if (stats.waits != 2 || stats.timeouts != 1)
+		tst_res(TFAIL, "Expected 2 waits and 1 timeout");
+
+	tst_process_wait_stats_reset();
+	SAFE_SIGNAL(SIGCHLD, SIG_IGN);
+
+	for (i = 0; i < NCHILDREN; i++) {
+		SAFE_KILL(pids[i], SIGKILL);
+
+		if (!TST_PROCESS_EXIT_WAIT(pids[i], 10000))
+			tst_res(TFAIL, "Child %i did not exit", pids[i]);
+	}
+
+	tst_process_wait_stats_get(&stats);
+	if (stats.waits == NCHILDREN && !stats.timeouts) {
+		tst_res(TPASS, "All children exited");
+	} else {
+		tst_res(TFAIL, "Expected %i waits and no timeouts",
+			NCHILDREN);
+	}
+
+	if (!tst_process_state_wait_many(pids, 1, 'S', 0))
+		tst_res(TFAIL, "Wait for exited child succeeded");
+	else if (errno != ESRCH)
+		tst_res(TFAIL | TERRNO, "Wait for exited child failed");
+	else
+		tst_res(TPASS | TERRNO, "Wait for exited child failed");
+
+	print_stats("exit waits");
+	SAFE_SIGNAL(SIGCHLD, SIG_DFL);
+}
+
+static struct tst_test test = {
+	.test_all = run,
+	.forks_child = 1,
+};
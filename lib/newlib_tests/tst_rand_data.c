@@ -0,0 +1,113 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (c) Linux Test Project, 2026
+ */
+
+/*
+ * Checks that tst_rand_data_fill() produces the same stream regardless of
+ * how the requests are split, that different seeds produce different data,
+ * that tst_rand_data_verify() finds corrupted bytes, and prints the
+ * generator throughput.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "tst_test.h"
+#include "tst_safe_clocks.h"
+#include "tst_timer.h"
+#include "tst_rand_data.h"
+
+#define BUF_SIZE (16 * 1024 * 1024)
+#define SEED 42
+
+static unsigned char *buf, *buf2;
+
+static void check_split(void)
+{
+	size_t off = 0, len;
+
+	tst_rand_data_fill(SEED, 0, buf, BUF_SIZE);
+
+	/* Odd chunk sizes exercise the unaligned heads and tails */
+	for (len = 1; off < BUF_SIZE; len = len * 3 + 1) {
+		len = MIN(len, BUF_SIZE - off);
+		tst_rand_data_fill(SEED, off, buf2 + off, len);
+		off += len;
+	}
+
+	if (memcmp(buf, buf2, BUF_SIZE))
+		tst_res(TFAIL, "Stream depends on the request split");
+	else
+		tst_res(TPASS, "Stream does not depend on the request split");
+}
+
+static void check_seed(void)
+{
+	tst_rand_data_fill(SEED + 1, 0, buf2, 4096);
+
+	if (!memcmp(buf, buf2, 4096))
+		tst_res(TFAIL, "Seeds %i and %i produce the same data", SEED, SEED + 1);
+	else
+		tst_res(TPASS, "Different seeds produce different data");
+
+	if (!memcmp(buf, buf + 4096, 4096))
+		tst_res(TFAIL, "Stream repeats after 4096 bytes");
+	else
+		tst_res(TPASS, "Stream does not repeat after 4096 bytes");
+}
+
+static void check_verify(void)
+{
+	const size_t pos = 12345;
+	ssize_t ret;
+
+	ret = tst_rand_data_verify(SEED, 1000, buf + 1000, BUF_SIZE - 1000);
+	if (ret != -1)
+		tst_res(TFAIL, "Verification failed at %zi on intact data", ret);
+	else
+		tst_res(TPASS, "Intact data verified");
+
+	buf[1000 + pos] ^= 1;
+	ret = tst_rand_data_verify(SEED, 1000, buf + 1000, BUF_SIZE - 1000);
+	buf[1000 + pos] ^= 1;
+
+	if (ret != (ssize_t)pos)
+		tst_res(TFAIL, "Corruption reported at %zi, expected %zu", ret, pos);
+	else
+		tst_res(TPASS, "Corruption found at %zi", ret);
+}
+
+static void run(void)
+{
+	struct timespec start, end;
+	long long us;
+
+	check_split();
+	check_seed();
+	check_verify();
+
+	SAFE_CLOCK_GETTIME(CLOCK_MONOTONIC, &start);
+	tst_rand_data_fill(SEED, 0, buf, BUF_SIZE);
+	SAFE_CLOCK_GETTIME(CLOCK_MONOTONIC, &end);
+
+	us = MAX(tst_timespec_diff_us(end, start), 1LL);
+	tst_res(TINFO, "tst_rand_data_fill(): %.0f MB/s", (double)BUF_SIZE / us);
+}
+
+static void setup(void)
+{
+	buf = SAFE_MALLOC(BUF_SIZE);
+	buf2 = SAFE_MALLOC(BUF_SIZE);
+}
+
+static void cleanup(void)
+{
+	free(buf);
+	free(buf2);
+}
+
+static struct tst_test test = {
+	.setup = setup,
+	.cleanup = cleanup,
+	.test_all = run,
+};
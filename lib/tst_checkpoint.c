@@ -24,10 +24,13 @@
 #include <stdint.h>
 #include <limits.h>
 #include <errno.h>
+#include <sched.h>
 #include <sys/syscall.h>
 
 #include "test.h"
 #include "safe_macros.h"
+#include "tst_atomic.h"
+#include "tst_clocks.h"
 #include "lapi/futex.h"
 
 #define DEFAULT_MSEC_TIMEOUT 10000
@@ -35,6 +38,60 @@
 futex_t *tst_futexes;
 unsigned int tst_max_futexes;
 
+/*
+ * The first half of the shared futex array are the checkpoints the waiters
+ * sleep on, the second half counts the waiters that have registered on the
+ * corresponding checkpoint and have not been woken up yet. The waker sleeps
+ * on the counter until enough waiters arrive instead of polling.
+ *
+ * A waiter that has registered but is not sleeping yet is usually there in
+ * a moment, so the waker yields the CPU and retries FUTEX_WAKE. The counter
+ * is only a hint though, a waiter that was killed leaves it raised. Once the
+ * waker has been yielding for SPIN_NS without waking anyone up it falls back
+ * to retrying every 1ms.
+ *
+ * This halves the number of usable checkpoint ids.
+ */
+#define CHECKPOINTS (tst_max_futexes / 2)
+#define WAITERS(id) (tst_futexes[CHECKPOINTS + (id)])
+#define SPIN_NS 10000000LL
+
+static unsigned long long handshakes, handshake_ns, handshake_max_ns;
+
+static int check_id(unsigned int id)
+{
+	if (!tst_max_futexes)
+		tst_brkm(TBROK, NULL, "Set test.needs_checkpoints = 1");
+
+	if (id >= CHECKPOINTS) {
+		errno = EOVERFLOW;
+		return -1;
+	}
+
+	return 0;
+}
+
+static long long elapsed_ns(struct timespec *start)
+{
+	struct timespec now;
+
+	tst_clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec - start->tv_sec) * 1000000000LL +
+	       now.tv_nsec - start->tv_nsec;
+}
+
+static int msec_to_timespec(long long msec, struct timespec *ts)
+{
+	if (msec <= 0)
+		return -1;
+
+	ts->tv_sec = msec / 1000;
+	ts->tv_nsec = (msec % 1000) * 1000000;
+
+	return 0;
+}
+
 void tst_checkpoint_init(const char *file, const int lineno,
                          void (*cleanup_fn)(void))
 {
@@ -85,57 +142,141 @@ int tst_checkpoint_wait(unsigned int id, unsigned int msec_timeout)
 	struct timespec timeout;
 	int ret;
 
-	if (!tst_max_futexes)
-		tst_brkm(TBROK, NULL, "Set test.needs_checkpoints = 1");
-
-	if (id >= tst_max_futexes) {
-		errno = EOVERFLOW;
+	if (check_id(id))
 		return -1;
-	}
 
 	timeout.tv_sec = msec_timeout/1000;
 	timeout.tv_nsec = (msec_timeout%1000) * 1000000;
 
+	tst_atomic_add_return(1, (int *)&WAITERS(id));
+	syscall(SYS_futex, &WAITERS(id), FUTEX_WAKE, 1, NULL);
+
 	do {
 		ret = syscall(SYS_futex, &tst_futexes[id], FUTEX_WAIT,
 			      tst_futexes[id], &timeout);
 	} while (ret == -1 && errno == EINTR);
 
+	/* Woken up waiters are unregistered by the waker */
+	if (ret)
+		tst_atomic_add_return(-1, (int *)&WAITERS(id));
+
 	return ret;
 }
 
 int tst_checkpoint_wake(unsigned int id, unsigned int nr_wake,
                         unsigned int msec_timeout)
 {
-	unsigned int msecs = 0, waked = 0;
-
-	if (!tst_max_futexes)
-		tst_brkm(TBROK, NULL, "Set test.needs_checkpoints = 1");
+	unsigned int waked = 0;
+	struct timespec start, spin_start, timeout;
+	long long ns, spin_ns = -1;
+	int ret, waiters;
 
-	if (id >= tst_max_futexes) {
-		errno = EOVERFLOW;
+	if (check_id(id))
 		return -1;
-	}
+
+	tst_clock_gettime(CLOCK_MONOTONIC, &start);
 
 	for (;;) {
-		waked += syscall(SYS_futex, &tst_futexes[id], FUTEX_WAKE,
-				 INT_MAX, NULL);
+		ret = syscall(SYS_futex, &tst_futexes[id], FUTEX_WAKE,
+			      INT_MAX, NULL);
+
+		if (ret > 0) {
+			tst_atomic_add_return(-ret, (int *)&WAITERS(id));
+			waked += ret;
+			spin_ns = -1;
+		}
 
 		if (waked == nr_wake)
 			break;
 
-		usleep(1000);
-		msecs++;
+		ns = elapsed_ns(&start);
 
-		if (msecs >= msec_timeout) {
+		if (msec_to_timespec(msec_timeout - ns / 1000000, &timeout)) {
 			errno = ETIMEDOUT;
 			return -1;
 		}
+
+		waiters = tst_atomic_load((int *)&WAITERS(id));
+
+		/*
+		 * A waiter has registered but is not sleeping on the
+		 * checkpoint yet or the count is stale.
+		 */
+		if (waiters > 0) {
+			if (spin_ns < 0) {
+				tst_clock_gettime(CLOCK_MONOTONIC, &spin_start);
+				spin_ns = 0;
+			} else {
+				spin_ns = elapsed_ns(&spin_start);
+			}
+
+			if (spin_ns < SPIN_NS)
+				sched_yield();
+			else
+				usleep(1000);
+			continue;
+		}
+
+		spin_ns = -1;
+		syscall(SYS_futex, &WAITERS(id), FUTEX_WAIT, waiters, &timeout);
 	}
 
+	ns = elapsed_ns(&start);
+	handshakes++;
+	handshake_ns += ns;
+	handshake_max_ns = MAX(handshake_max_ns, (unsigned long long)ns);
+
 	return 0;
 }
 
+int tst_checkpoint_barrier(unsigned int id, unsigned int nr_procs,
+			   unsigned int msec_timeout)
+{
+	struct timespec start, timeout;
+	uint32_t gen;
+	int ret;
+
+	if (check_id(id))
+		return -1;
+
+	tst_clock_gettime(CLOCK_MONOTONIC, &start);
+
+	gen = tst_futexes[id];
+
+	if (tst_atomic_add_return(1, (int *)&WAITERS(id)) == (int)nr_procs) {
+		tst_atomic_store(0, (int *)&WAITERS(id));
+		tst_atomic_add_return(1, (int *)&tst_futexes[id]);
+		syscall(SYS_futex, &tst_futexes[id], FUTEX_WAKE, INT_MAX, NULL);
+		return 0;
+	}
+
+	while (tst_atomic_load((int *)&tst_futexes[id]) == (int)gen) {
+		if (msec_to_timespec(msec_timeout - elapsed_ns(&start) / 1000000,
+				     &timeout)) {
+			errno = ETIMEDOUT;
+			return -1;
+		}
+
+		ret = syscall(SYS_futex, &tst_futexes[id], FUTEX_WAIT, gen,
+			      &timeout);
+
+		if (ret == -1 && errno != EINTR && errno != EAGAIN &&
+		    errno != ETIMEDOUT)
+			return -1;
+	}
+
+	return 0;
+}
+
+void tst_checkpoint_stats(unsigned long long *count,
+			  unsigned long long *avg_ns,
+			  unsigned long long *max_ns)
+{
+	*count = handshakes;
+	*avg_ns = handshakes ? handshake_ns / handshakes : 0;
+	*max_ns = handshake_max_ns;
+}
+
 void tst_safe_checkpoint_wait(const char *file, const int lineno,
                               void (*cleanup_fn)(void), unsigned int id,
 			      unsigned int msec_timeout)
@@ -154,6 +295,19 @@ void tst_safe_checkpoint_wait(const char *file, const int lineno,
 	}
 }
 
+void tst_safe_checkpoint_barrier(const char *file, const int lineno,
+				 void (*cleanup_fn)(void), unsigned int id,
+				 unsigned int nr_procs)
+{
+	int ret = tst_checkpoint_barrier(id, nr_procs, DEFAULT_MSEC_TIMEOUT);
+
+	if (ret) {
+		tst_brkm_(file, lineno, TBROK | TERRNO, cleanup_fn,
+			"tst_checkpoint_barrier(%u, %u, %i) failed", id,
+			nr_procs, DEFAULT_MSEC_TIMEOUT);
+	}
+}
+
 void tst_safe_checkpoint_wake(const char *file, const int lineno,
                               void (*cleanup_fn)(void), unsigned int id,
                               unsigned int nr_wake)
@@ -1,6 +1,15 @@
 // SPDX-License-Identifier: GPL-2.0-or-later
 /* Copyright (c) 2018 Oracle and/or its affiliates. All Rights Reserved. */
 
+#include <string.h>
+
+#if defined(__aarch64__)
+# include <sys/auxv.h>
+# ifndef HWCAP_CRC32
+#  define HWCAP_CRC32 (1 << 7)
+# endif
+#endif
+
 #include "tst_checksum.h"
 
 static const uint32_t crc32c_table[] = {
@@ -70,12 +79,246 @@ static const uint32_t crc32c_table[] = {
 	0xbe2da0a5, 0x4c4623a6, 0x5f16d052, 0xad7d5351,
 };
 
-uint32_t tst_crc32c(uint8_t *buf, size_t buf_len)
-{
-	uint32_t crc = 0xffffffff;
+/*
+ * Hardware CRC32c instructions, the functions are compiled for the extension
+ * and called only when the CPU reports it at runtime.
+ */
+#if defined(__x86_64__) && defined(__GNUC__)
+# define HAVE_CRC32C_HW
+# define HW_TARGET __attribute__((target("sse4.2")))
+# define HW_CRC_U8(crc, b) __builtin_ia32_crc32qi(crc, b)
+# define HW_CRC_U64(crc, v) ((uint32_t)__builtin_ia32_crc32di(crc, v))
+#elif defined(__aarch64__) && defined(__clang__)
+# define HAVE_CRC32C_HW
+# define HW_TARGET __attribute__((target("crc")))
+# define HW_CRC_U8(crc, b) __builtin_arm_crc32cb(crc, b)
+# define HW_CRC_U64(crc, v) __builtin_arm_crc32cd(crc, v)
+#elif defined(__aarch64__) && defined(__GNUC__) && __GNUC__ >= 6
+# define HAVE_CRC32C_HW
+# define HW_TARGET __attribute__((target("+crc")))
+# define HW_CRC_U8(crc, b) __builtin_aarch64_crc32cb(crc, b)
+# define HW_CRC_U64(crc, v) __builtin_aarch64_crc32cx(crc, v)
+#endif
+
+static uint32_t crc32c_slice_table[8][256];
 
+static uint32_t crc32c_byte(uint32_t crc, const uint8_t *buf, size_t buf_len)
+{
 	while (buf_len--)
 		crc = crc32c_table[(crc ^ (*buf++)) & 0xff] ^ (crc >> 8);
 
+	return crc;
+}
+
+static inline uint32_t load_le32(const uint8_t *p)
+{
+	return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+/*
+ * Slice-by-8, processes 8 bytes per step with one table lookup per byte.
+ * Table k advances a byte CRC over k following zero bytes.
+ */
+static uint32_t crc32c_slice8(uint32_t crc, const uint8_t *buf, size_t buf_len)
+{
+	const uint32_t (*t)[256] = crc32c_slice_table;
+	uint32_t lo, hi;
+
+	while (buf_len >= 8) {
+		lo = crc ^ load_le32(buf);
+		hi = load_le32(buf + 4);
+
+		crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^
+		      t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^
+		      t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^
+		      t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+
+		buf += 8;
+		buf_len -= 8;
+	}
+
+	return crc32c_byte(crc, buf, buf_len);
+}
+
+#ifdef HAVE_CRC32C_HW
+HW_TARGET
+static uint32_t crc32c_hw(uint32_t crc, const uint8_t *buf, size_t buf_len)
+{
+	uint64_t v;
+
+	while (buf_len >= 8) {
+		memcpy(&v, buf, 8);
+		crc = HW_CRC_U64(crc, v);
+		buf += 8;
+		buf_len -= 8;
+	}
+
+	while (buf_len--)
+		crc = HW_CRC_U8(crc, *buf++);
+
+	return crc;
+}
+
+/*
+ * The crc32 instruction has a latency of several cycles but can be issued
+ * every cycle, interleaving three independent buffers keeps it busy.
+ */
+HW_TARGET
+static void crc32c_hw_x3(const uint8_t *const bufs[3], const size_t lens[3],
+			 uint32_t crcs[3])
+{
+	const uint8_t *b0 = bufs[0], *b1 = bufs[1], *b2 = bufs[2];
+	uint32_t c0 = crcs[0], c1 = crcs[1], c2 = crcs[2];
+	size_t i, len = lens[0];
+	uint64_t v0, v1, v2;
+
+	if (lens[1] < len)
+		len = lens[1];
+	if (lens[2] < len)
+		len = lens[2];
+
+	len &= ~(size_t)7;
+
+	for (i = 0; i < len; i += 8) {
+		memcpy(&v0, b0 + i, 8);
+		memcpy(&v1, b1 + i, 8);
+		memcpy(&v2, b2 + i, 8);
+		c0 = HW_CRC_U64(c0, v0);
+		c1 = HW_CRC_U64(c1, v1);
+		c2 = HW_CRC_U64(c2, v2);
+	}
+
+	crcs[0] = crc32c_hw(c0, b0 + len, lens[0] - len);
+	crcs[1] = crc32c_hw(c1, b1 + len, lens[1] - len);
+	crcs[2] = crc32c_hw(c2, b2 + len, lens[2] - len);
+}
+
+static int crc32c_hw_supported(void)
+{
+# if defined(__x86_64__)
+	/* Called from a constructor, possibly before the one of libgcc */
+	__builtin_cpu_init();
+
+	return __builtin_cpu_supports("sse4.2");
+# else
+	return !!(getauxval(AT_HWCAP) & HWCAP_CRC32);
+# endif
+}
+#else
+static int crc32c_hw_supported(void)
+{
+	return 0;
+}
+#endif
+
+static enum tst_crc32c_impl crc32c_impl;
+static uint32_t (*crc32c_update)(uint32_t crc, const uint8_t *buf,
+				 size_t buf_len) = crc32c_byte;
+
+__attribute__((constructor))
+static void crc32c_init_tables(void)
+{
+	int i, k;
+	uint32_t crc;
+
+	for (i = 0; i < 256; i++) {
+		crc = crc32c_table[i];
+		crc32c_slice_table[0][i] = crc;
+
+		for (k = 1; k < 8; k++) {
+			crc = crc32c_table[crc & 0xff] ^ (crc >> 8);
+			crc32c_slice_table[k][i] = crc;
+		}
+	}
+
+	tst_crc32c_set_impl(TST_CRC32C_AUTO);
+}
+
+int tst_crc32c_set_impl(enum tst_crc32c_impl impl)
+{
+	if (impl == TST_CRC32C_AUTO)
+		impl = crc32c_hw_supported() ? TST_CRC32C_HW : TST_CRC32C_SLICE8;
+
+	switch (impl) {
+	case TST_CRC32C_BYTE:
+		crc32c_update = crc32c_byte;
+		break;
+	case TST_CRC32C_SLICE8:
+		crc32c_update = crc32c_slice8;
+		break;
+	case TST_CRC32C_HW:
+#ifdef HAVE_CRC32C_HW
+		if (crc32c_hw_supported()) {
+			crc32c_update = crc32c_hw;
+			break;
+		}
+#endif
+		return -1;
+	default:
+		return -1;
+	}
+
+	crc32c_impl = impl;
+
+	return 0;
+}
+
+const char *tst_crc32c_impl_name(void)
+{
+	switch (crc32c_impl) {
+	case TST_CRC32C_BYTE:
+		return "byte";
+	case TST_CRC32C_SLICE8:
+		return "slice-by-8";
+	case TST_CRC32C_HW:
+#if defined(__x86_64__)
+		return "sse4.2";
+#else
+		return "armv8-crc";
+#endif
+	default:
+		return "???";
+	}
+}
+
+uint32_t tst_crc32c_init(void)
+{
+	return 0xffffffff;
+}
+
+uint32_t tst_crc32c_update(uint32_t crc, const void *buf, size_t buf_len)
+{
+	return crc32c_update(crc, buf, buf_len);
+}
+
+uint32_t tst_crc32c_final(uint32_t crc)
+{
 	return ~crc;
 }
+
+uint32_t tst_crc32c(uint8_t *buf, size_t buf_len)
+{
+	return ~crc32c_update(0xffffffff, buf, buf_len);
+}
+
+void tst_crc32c_multi(unsigned int cnt, const void *const bufs[],
+		      const size_t lens[], uint32_t crcs[])
+{
+	unsigned int i = 0;
+
+#ifdef HAVE_CRC32C_HW
+	if (crc32c_impl == TST_CRC32C_HW) {
+		for (; i + 3 <= cnt; i += 3) {
+			crcs[i] = crcs[i + 1] = crcs[i + 2] = 0xffffffff;
+			crc32c_hw_x3((const uint8_t *const *)bufs + i, lens + i,
+				     crcs + i);
+			crcs[i] = ~crcs[i];
+			crcs[i + 1] = ~crcs[i + 1];
+			crcs[i + 2] = ~crcs[i + 2];
+		}
+	}
+#endif
+
+	for (; i < cnt; i++)
+		crcs[i] = ~crc32c_update(0xffffffff, bufs[i], lens[i]);
+}
@@ -0,0 +1,135 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (c) Linux Test Project, 2026
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#if defined(__x86_64__) || defined(__i386__)
+# include <cpuid.h>
+#endif
+
+#define TST_NO_DEFAULT_MAIN
+#include "tst_test.h"
+#include "tst_cycles.h"
+
+/* Length of one calibration round and the number of rounds */
+#define CALIB_NS 5000000LL
+#define CALIB_ROUNDS 3
+/* Maximal allowed difference of the rounds */
+#define CALIB_MAX_DEV 0.001
+
+struct tst_cycles_clock tst_cycles_clk;
+
+static long long raw_ns(void)
+{
+	struct timespec ts;
+
+#ifdef CLOCK_MONOTONIC_RAW
+	clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+#else
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int constant_rate(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	unsigned int eax, ebx, ecx, edx;
+
+	/* Invariant TSC, it does not change with P-, C- and T-states */
+	if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx))
+		return 0;
+
+	return !!(edx & (1 << 8));
+#elif defined(TST_HAS_CYCLES)
+	/* The aarch64 generic timer and powerpc time base are fixed rate */
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+static double calibrate_round(uint64_t *cycles, long long *ns)
+{
+	long long start_ns, end_ns;
+	uint64_t start, end;
+
+	start_ns = raw_ns();
+	start = tst_cycles_read();
+
+	do {
+		end_ns = raw_ns();
+		end = tst_cycles_read();
+	} while (end_ns - start_ns < CALIB_NS);
+
+	*cycles = end;
+	*ns = end_ns;
+
+	if (end <= start)
+		return 0;
+
+	return (double)(end_ns - start_ns) / (end - start);
+}
+
+static int calibrate(void)
+{
+	double rate[CALIB_ROUNDS], min, max;
+	uint64_t cycles;
+	long long ns;
+	int i;
+
+	if (!constant_rate()) {
+		tst_res(TINFO, "CPU cycle counter does not run at constant rate");
+		return 0;
+	}
+
+	for (i = 0; i < CALIB_ROUNDS; i++)
+		rate[i] = calibrate_round(&cycles, &ns);
+
+	min = max = rate[0];
+	for (i = 1; i < CALIB_ROUNDS; i++) {
+		min = MIN(min, rate[i]);
+		max = MAX(max, rate[i]);
+	}
+
+	if (min <= 0 || (max - min) / min > CALIB_MAX_DEV) {
+		tst_res(TINFO, "CPU cycle counter calibration is not stable");
+		return 0;
+	}
+
+	tst_cycles_clk.ns_per_cycle = rate[CALIB_ROUNDS - 1];
+	tst_cycles_clk.base_cycles = cycles;
+	tst_cycles_clk.base_ns = ns;
+
+	tst_res(TINFO, "CPU cycle counter runs at %.2f MHz",
+		1000 / tst_cycles_clk.ns_per_cycle);
+
+	return 1;
+}
+
+int tst_cycles_init(void)
+{
+	static int usable = -1;
+
+	if (usable < 0)
+		usable = calibrate();
+
+	return usable;
+}
+
+int tst_cycles_enabled(void)
+{
+	static int enabled = -1;
+	const char *env;
+
+	if (enabled >= 0)
+		return enabled;
+
+	env = getenv("LTP_CLOCK_CYCLES");
+	enabled = env && !strcmp(env, "1") && tst_cycles_init();
+
+	return enabled;
+}
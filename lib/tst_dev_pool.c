@@ -0,0 +1,397 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (c) Linux Test Project, 2026
+ */
+
+#define _GNU_SOURCE
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <sys/file.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/fs.h>
+
+#include "test.h"
+#include "lapi/fs.h"
+#include "lapi/loop.h"
+#include "lapi/seek.h"
+#include "tst_device.h"
+#include "tst_dev_pool.h"
+
+#define POOL_SLOTS 32
+#define COPY_BUF_SIZE (1024 * 1024)
+
+static int slot_fd = -1;
+static int slot_idx;
+static char slot_dev[PATH_MAX];
+static char slot_img[PATH_MAX];
+
+const char *tst_dev_pool_dir(void)
+{
+	const char *dir = getenv("LTP_DEV_POOL");
+
+	if (!dir || !dir[0])
+		return NULL;
+
+	return dir;
+}
+
+static int read_str(const char *path, char *buf, size_t size)
+{
+	ssize_t ret;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return -1;
+
+	ret = read(fd, buf, size - 1);
+	close(fd);
+
+	if (ret < 0)
+		return -1;
+
+	buf[ret] = 0;
+	buf[strcspn(buf, "\n")] = 0;
+
+	return 0;
+}
+
+/*
+ * Checks that the loop device recorded in the slot lock file is still backed
+ * by the slot image, the loop device may have been detached and reused by
+ * someone else since the last test.
+ */
+static int slot_dev_valid(const char *dev, const char *img)
+{
+	char path[PATH_MAX], backing[PATH_MAX], real_img[PATH_MAX];
+	const char *name = strrchr(dev, '/');
+
+	if (!name || !realpath(img, real_img))
+		return 0;
+
+	snprintf(path, sizeof(path), "/sys/block/%s/loop/backing_file", name + 1);
+
+	if (read_str(path, backing, sizeof(backing)))
+		return 0;
+
+	return !strcmp(backing, real_img);
+}
+
+static int slot_setup(const char *dir, int i, int fd, unsigned int size)
+{
+	char dev[PATH_MAX] = "";
+	struct stat st;
+	ssize_t ret;
+	int lock_fd;
+
+	snprintf(slot_img, sizeof(slot_img), "%s/slot%i.img", dir, i);
+
+	ret = pread(fd, dev, sizeof(dev) - 1, 0);
+	if (ret > 0)
+		dev[ret] = 0;
+	else
+		dev[0] = 0;
+
+	if (dev[0] && slot_dev_valid(dev, slot_img)) {
+		if (!stat(slot_img, &st) && st.st_size >= (off_t)size * 1024 * 1024) {
+			strcpy(slot_dev, dev);
+			return 0;
+		}
+
+		tst_resm(TINFO, "Pool device '%s' too small, reattaching", dev);
+
+		if (tst_detach_device(dev))
+			return 1;
+	}
+
+	if (tst_prealloc_file(slot_img, 1024 * 1024, size)) {
+		tst_resm(TWARN | TERRNO, "Failed to create %s", slot_img);
+		return 1;
+	}
+
+	/* Serialize the find & attach race between the pool users */
+	snprintf(dev, sizeof(dev), "%s/attach.lock", dir);
+	lock_fd = open(dev, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+	if (lock_fd < 0 || flock(lock_fd, LOCK_EX)) {
+		tst_resm(TWARN | TERRNO, "Failed to lock %s", dev);
+		if (lock_fd >= 0)
+			close(lock_fd);
+		return 1;
+	}
+
+	ret = tst_find_free_loopdev(slot_dev, sizeof(slot_dev)) == -1 ||
+	      tst_attach_device(slot_dev, slot_img);
+
+	close(lock_fd);
+
+	if (ret)
+		return 1;
+
+	if (ftruncate(fd, 0) ||
+	    pwrite(fd, slot_dev, strlen(slot_dev), 0) != (ssize_t)strlen(slot_dev)) {
+		tst_resm(TWARN | TERRNO, "Failed to record pool device");
+		tst_detach_device(slot_dev);
+		return 1;
+	}
+
+	tst_resm(TINFO, "Attached %s to pool slot %i", slot_dev, i);
+
+	return 0;
+}
+
+/*
+ * Limits the loop device to the first sizelimit bytes of the slot image, zero
+ * means the whole image. Also undoes an offset a test may have set.
+ */
+static void slot_set_limit(uint64_t sizelimit)
+{
+	struct loop_info64 info;
+	int fd;
+
+	fd = open(slot_dev, O_RDONLY);
+	if (fd < 0)
+		return;
+
+	if (ioctl(fd, LOOP_GET_STATUS64, &info)) {
+		close(fd);
+		return;
+	}
+
+	if (info.lo_offset || info.lo_sizelimit != sizelimit) {
+		info.lo_offset = 0;
+		info.lo_sizelimit = sizelimit;
+
+		if (ioctl(fd, LOOP_SET_STATUS64, &info))
+			tst_resm(TINFO | TERRNO, "ioctl(%s, LOOP_SET_STATUS64) failed",
+				 slot_dev);
+	}
+
+	close(fd);
+}
+
+const char *tst_dev_pool_acquire(unsigned int size)
+{
+	const char *dir = tst_dev_pool_dir();
+	char path[PATH_MAX];
+	int i, fd;
+
+	if (!dir)
+		return NULL;
+
+	if (mkdir(dir, 0700) && errno != EEXIST) {
+		tst_resm(TWARN | TERRNO, "mkdir(%s) failed", dir);
+		return NULL;
+	}
+
+	for (i = 0; i < POOL_SLOTS; i++) {
+		snprintf(path, sizeof(path), "%s/slot%i.lock", dir, i);
+
+		fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+		if (fd < 0) {
+			tst_resm(TWARN | TERRNO, "open(%s) failed", path);
+			return NULL;
+		}
+
+		if (flock(fd, LOCK_EX | LOCK_NB)) {
+			close(fd);
+			continue;
+		}
+
+		if (slot_setup(dir, i, fd, size)) {
+			close(fd);
+			return NULL;
+		}
+
+		slot_fd = fd;
+		slot_idx = i;
+
+		/* The slot image may be larger than requested by this test */
+		slot_set_limit((uint64_t)size * 1024 * 1024);
+
+		tst_resm(TINFO, "Using pool device '%s'", slot_dev);
+		return slot_dev;
+	}
+
+	tst_resm(TINFO, "All %i slots in '%s' are busy", POOL_SLOTS, dir);
+
+	return NULL;
+}
+
+int tst_dev_pool_owns(const char *dev)
+{
+	return slot_fd >= 0 && dev && !strcmp(dev, slot_dev);
+}
+
+int tst_dev_pool_release(void)
+{
+	int ret, fd;
+
+	if (slot_fd < 0)
+		return 0;
+
+	/* Undo the loop device tweaks a test may have done */
+	fd = open(slot_dev, O_RDONLY);
+	if (fd >= 0) {
+		ioctl(fd, LOOP_SET_BLOCK_SIZE, 512);
+		close(fd);
+	}
+
+	slot_set_limit(0);
+
+	ret = close(slot_fd);
+	slot_fd = -1;
+
+	return ret;
+}
+
+/*
+ * The images are cached per slot, an image cloned into several slots would
+ * give the attached devices the same filesystem UUID which confuses btrfs and
+ * prevents XFS from mounting them at the same time.
+ */
+static void fs_img_path(const char *dev, const char *fs_key,
+			char *path, size_t path_len)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	uint64_t size = tst_get_device_size(dev);
+	const char *c;
+
+	for (c = fs_key; *c; c++) {
+		hash ^= (unsigned char)*c;
+		hash *= 1099511628211ULL;
+	}
+
+	snprintf(path, path_len, "%s/fs-%016"PRIx64"-%"PRIu64"M-slot%i.img",
+		 tst_dev_pool_dir(), hash, size, slot_idx);
+}
+
+/*
+ * Makes dst a copy of src, sharing the extents if the filesystem supports
+ * reflinks and skipping holes otherwise. The dst inode is preserved since it
+ * may be attached to a loop device.
+ */
+static int clone_file(const char *src, const char *dst)
+{
+	int src_fd, dst_fd, ret = -1;
+	off_t data, hole, size;
+	ssize_t len;
+	char *buf = NULL;
+
+	src_fd = open(src, O_RDONLY);
+	if (src_fd < 0)
+		return -1;
+
+	dst_fd = open(dst, O_WRONLY | O_CREAT, 0600);
+	if (dst_fd < 0)
+		goto exit;
+
+	if (!ioctl(dst_fd, FICLONE, src_fd)) {
+		ret = 0;
+		goto exit;
+	}
+
+	size = lseek(src_fd, 0, SEEK_END);
+	buf = malloc(COPY_BUF_SIZE);
+
+	if (size < 0 || !buf || ftruncate(dst_fd, 0) || ftruncate(dst_fd, size))
+		goto exit;
+
+	for (data = 0; data < size; data = hole) {
+		data = lseek(src_fd, data, SEEK_DATA);
+		if (data < 0) {
+			if (errno == ENXIO)
+				break;
+			goto exit;
+		}
+
+		hole = lseek(src_fd, data, SEEK_HOLE);
+		if (hole < 0)
+			goto exit;
+
+		while (data < hole) {
+			len = MIN(hole - data, COPY_BUF_SIZE);
+			len = pread(src_fd, buf, len, data);
+			if (len <= 0 || pwrite(dst_fd, buf, len, data) != len)
+				goto exit;
+			data += len;
+		}
+	}
+
+	ret = 0;
+exit:
+	free(buf);
+	if (dst_fd >= 0 && close(dst_fd))
+		ret = -1;
+	close(src_fd);
+	return ret;
+}
+
+int tst_dev_pool_restore_fs(const char *dev, const char *fs_key)
+{
+	char path[PATH_MAX];
+	int fd, ret;
+
+	if (!tst_dev_pool_owns(dev))
+		return 1;
+
+	fs_img_path(dev, fs_key, path, sizeof(path));
+
+	if (access(path, R_OK))
+		return 1;
+
+	if (clone_file(path, slot_img)) {
+		tst_resm(TINFO | TERRNO, "Failed to restore %s", path);
+		return 1;
+	}
+
+	/* Drop the device page cache, the backing file changed under it */
+	fd = open(dev, O_RDONLY);
+	if (fd < 0)
+		return 1;
+
+	ret = ioctl(fd, BLKFLSBUF, 0);
+	close(fd);
+
+	if (ret) {
+		tst_resm(TINFO | TERRNO, "ioctl(%s, BLKFLSBUF) failed", dev);
+		return 1;
+	}
+
+	return 0;
+}
+
+void tst_dev_pool_save_fs(const char *dev, const char *fs_key)
+{
+	char path[PATH_MAX], tmp[PATH_MAX + 32];
+	int fd;
+
+	if (!tst_dev_pool_owns(dev))
+		return;
+
+	fd = open(dev, O_RDONLY);
+	if (fd < 0 || fsync(fd)) {
+		tst_resm(TINFO | TERRNO, "Failed to sync %s", dev);
+		if (fd >= 0)
+			close(fd);
+		return;
+	}
+	close(fd);
+
+	fs_img_path(dev, fs_key, path, sizeof(path));
+	snprintf(tmp, sizeof(tmp), "%s.%i", path, getpid());
+
+	/* rename() makes the image visible to other tests only when complete */
+	if (clone_file(slot_img, tmp) || rename(tmp, path)) {
+		tst_resm(TINFO | TERRNO, "Failed to cache filesystem image");
+		unlink(tmp);
+	}
+}
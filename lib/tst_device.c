@@ -21,6 +21,7 @@
 #include "test.h"
 #include "safe_macros.h"
 #include "tst_device.h"
+#include "tst_dev_pool.h"
 
 #ifndef LOOP_CTL_GET_FREE
 # define LOOP_CTL_GET_FREE 0x4C82
@@ -325,6 +326,16 @@ const char *tst_acquire_device__(unsigned int size)
 				ltp_dev_size, acq_dev_size);
 	}
 
+	if (tst_dev_pool_dir()) {
+		dev = tst_dev_pool_acquire(acq_dev_size);
+		if (dev) {
+			device_acquired = 1;
+			return dev;
+		}
+
+		tst_resm(TINFO, "Falling back to a loop device in tmpdir");
+	}
+
 	dev = tst_acquire_loop_device(acq_dev_size, DEV_FILE);
 
 	if (dev)
@@ -365,6 +376,11 @@ int tst_release_device(const char *dev)
 	if (!device_acquired)
 		return 0;
 
+	if (tst_dev_pool_owns(dev)) {
+		device_acquired = 0;
+		return tst_dev_pool_release();
+	}
+
 	/*
 	 * Loop device was created -> we need to detach it.
 	 *
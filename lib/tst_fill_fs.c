@@ -3,11 +3,14 @@
  * Copyright (c) 2017 Cyril Hrubis <chrubis@suse.cz>
  */
 
+#define _GNU_SOURCE
 #include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/mman.h>
 #include <sys/statvfs.h>
 #include <sys/uio.h>
+#include <sys/wait.h>
 
 #define TST_NO_DEFAULT_MAIN
 #include "tst_test.h"
@@ -15,12 +18,28 @@
 #include "tst_fs.h"
 #include "tst_rand_data.h"
 #include "tst_safe_file_at.h"
+#include "tst_safe_clocks.h"
+#include "tst_safe_io_uring.h"
+#include "tst_timer.h"
 
+#define FILL_BUF_SIZE (64 * 1024)
+
+/* Parallel engine write size, queue depth and O_DIRECT alignment */
+#define FILL_CHUNK (1024 * 1024)
+#define FILL_QD 8
+#define FILL_ALIGN 4096
+
+/*
+ * The data is generated by tst_rand_data_fill(), seeded by the file number
+ * and positioned at the file offset, so that it does not compress or
+ * deduplicate.
+ */
 void fill_random(const char *path, int verbose)
 {
 	int i = 0;
 	char file[PATH_MAX];
-	size_t len;
+	char buf[FILL_BUF_SIZE];
+	size_t len, off;
 	ssize_t ret;
 	int fd;
 	struct statvfs fi;
@@ -44,8 +63,11 @@ void fill_random(const char *path, int verbose)
 			return;
 		}
 
+		off = 0;
+
 		while (len) {
-			ret = write(fd, tst_rand_data, MIN(len, tst_rand_data_len));
+			tst_rand_data_fill(i, off, buf, MIN(len, sizeof(buf)));
+			ret = write(fd, buf, MIN(len, sizeof(buf)));
 
 			if (ret < 0) {
 				/* retry on ENOSPC to make sure filesystem is really full */
@@ -65,6 +87,7 @@ void fill_random(const char *path, int verbose)
 			}
 
 			len -= ret;
+			off += ret;
 		}
 
 		SAFE_CLOSE(fd);
@@ -77,6 +100,9 @@ void fill_flat_vec(const char *path, int verbose)
 	struct iovec iov[512];
 	int iovcnt = ARRAY_SIZE(iov);
 	int retries = 3;
+	const size_t block = 4096;
+	char *buf;
+	off_t off = 0;
 
 	dir = open(path, O_PATH | O_DIRECTORY);
 	if (dir == -1) {
@@ -98,15 +124,20 @@ void fill_flat_vec(const char *path, int verbose)
 
 	SAFE_CLOSE(dir);
 
+	buf = SAFE_MALLOC(block * iovcnt);
+
 	for (int i = 0; i < iovcnt; i++) {
 		iov[i] = (struct iovec) {
-			(void *)tst_rand_data,
-			tst_rand_data_len
+			buf + i * block,
+			block
 		};
 	}
 
 	while (retries) {
-		const int ret = writev(fd, iov, iovcnt);
+		int ret;
+
+		tst_rand_data_fill(0, off, buf, block * iovcnt);
+		ret = writev(fd, iov, iovcnt);
 
 		if (!ret)
 			tst_res(TWARN | TERRNO, "writev returned 0; not sure what this means");
@@ -115,6 +146,7 @@ void fill_flat_vec(const char *path, int verbose)
 			if (verbose && retries < 3)
 				tst_res(TINFO, "writev(\"%s/AOF\", iov, %d) = %d", path, iovcnt, ret);
 
+			off += ret;
 			retries = 3;
 			continue;
 		}
@@ -128,7 +160,413 @@ void fill_flat_vec(const char *path, int verbose)
 		retries--;
 	}
 
+	free(buf);
+	SAFE_CLOSE(fd);
+}
+
+struct fill_worker {
+	char dir[PATH_MAX];
+	unsigned int id;
+	enum tst_fill_access_pattern pattern;
+	unsigned int flags;
+	int verbose;
+	unsigned long bsize;
+	char *buf;
+	struct iovec iov[FILL_QD];
+	struct tst_io_uring ring;
+	unsigned long long *written;
+};
+
+static int fill_open(struct fill_worker *w, const char *file, int direct)
+{
+	int flags = O_WRONLY | O_CREAT;
+	int fd;
+
+	if (direct)
+		flags |= O_DIRECT;
+
+	fd = open(file, flags, 0600);
+
+	if (fd == -1 && direct && errno == EINVAL) {
+		if (w->verbose)
+			tst_res(TINFO, "O_DIRECT not supported in %s", w->dir);
+
+		w->flags &= ~TST_FILL_DIRECT;
+		fd = open(file, O_WRONLY | O_CREAT, 0600);
+	}
+
+	if (fd == -1 && errno != ENOSPC)
+		tst_brk(TBROK | TERRNO, "open(%s)", file);
+
+	return fd;
+}
+
+/*
+ * Writes len bytes at *off with pwrite() in FILL_CHUNK sized pieces, stops at
+ * the first error. Returns 0 on success and errno otherwise.
+ */
+static int fill_bulk_sync(struct fill_worker *w, int fd, uint64_t seed,
+			  off_t *off, size_t len)
+{
+	ssize_t ret;
+	size_t n;
+
+	while (len) {
+		n = MIN(len, (size_t)FILL_CHUNK);
+		tst_rand_data_fill(seed, *off, w->buf, n);
+		ret = pwrite(fd, w->buf, n, *off);
+
+		if (ret < 0)
+			return errno;
+
+		*w->written += ret;
+		*off += ret;
+		len -= ret;
+
+		if ((size_t)ret < n)
+			return ENOSPC;
+	}
+
+	return 0;
+}
+
+/*
+ * Same as fill_bulk_sync() but keeps up to FILL_QD writes in flight on the
+ * worker io_uring. Since the data depend only on the file offset, whatever
+ * was written past a failed write is simply overwritten by the caller later,
+ * so only the bytes before the first failure are counted as written.
+ */
+static int fill_bulk_uring(struct fill_worker *w, int fd, uint64_t seed,
+			   off_t *off, size_t len)
+{
+	struct tst_io_uring *ring = &w->ring;
+	off_t slot_off[FILL_QD], fail_off = -1;
+	unsigned int free_slots[FILL_QD], nfree = FILL_QD;
+	unsigned int inflight = 0, to_submit, head, tail, i, slot;
+	off_t pos = *off, start = *off;
+	int err = 0;
+
+	for (i = 0; i < FILL_QD; i++)
+		free_slots[i] = i;
+
+	while (inflight || (len && !err)) {
+		to_submit = 0;
+		tail = *ring->sqr_tail;
+
+		while (nfree && len && !err) {
+			struct io_uring_sqe *sqe;
+			size_t n = MIN(len, (size_t)FILL_CHUNK);
+
+			slot = free_slots[--nfree];
+			w->iov[slot].iov_len = n;
+			tst_rand_data_fill(seed, pos, w->iov[slot].iov_base, n);
+
+			i = tail & *ring->sqr_mask;
+			sqe = &ring->sqr_entries[i];
+			memset(sqe, 0, sizeof(*sqe));
+			sqe->opcode = IORING_OP_WRITEV;
+			sqe->fd = fd;
+			sqe->addr = (uintptr_t)&w->iov[slot];
+			sqe->len = 1;
+			sqe->off = pos;
+			sqe->user_data = slot;
+			ring->sqr_array[i] = i;
+
+			slot_off[slot] = pos;
+			pos += n;
+			len -= n;
+			tail++;
+			to_submit++;
+		}
+
+		__atomic_store_n(ring->sqr_tail, tail, __ATOMIC_RELEASE);
+		inflight += to_submit;
+
+		SAFE_IO_URING_ENTER(1, ring->fd, to_submit, 1,
+				    IORING_ENTER_GETEVENTS, NULL);
+
+		head = *ring->cqr_head;
+
+		while (head != __atomic_load_n(ring->cqr_tail, __ATOMIC_ACQUIRE)) {
+			const struct io_uring_cqe *cqe;
+
+			cqe = &ring->cqr_entries[head & *ring->cqr_mask];
+			slot = cqe->user_data;
+
+			if (cqe->res < 0 || (size_t)cqe->res < w->iov[slot].iov_len) {
+				off_t end = slot_off[slot] + MAX(cqe->res, 0);
+
+				if (fail_off < 0 || end < fail_off)
+					fail_off = end;
+
+				if (!err)
+					err = cqe->res < 0 ? -cqe->res : ENOSPC;
+			}
+
+			free_slots[nfree++] = slot;
+			inflight--;
+			head++;
+		}
+
+		__atomic_store_n(ring->cqr_head, head, __ATOMIC_RELEASE);
+	}
+
+	*off = err ? fail_off : pos;
+	*w->written += *off - start;
+
+	return err;
+}
+
+/*
+ * Writes the rest of the file with buffered pwrite(), halving the length on
+ * ENOSPC until it drops under half of the filesystem block in order to make
+ * sure that the filesystem is really full. Returns 1 on final ENOSPC.
+ */
+static int fill_tail(struct fill_worker *w, int fd, uint64_t seed,
+		     off_t off, size_t len)
+{
+	ssize_t ret;
+	size_t n;
+
+	while (len) {
+		n = MIN(len, (size_t)FILL_CHUNK);
+		tst_rand_data_fill(seed, off, w->buf, n);
+		ret = pwrite(fd, w->buf, n, off);
+
+		if (ret < 0) {
+			if (errno != ENOSPC)
+				tst_brk(TBROK | TERRNO, "pwrite()");
+
+			if (len < w->bsize / 2)
+				return 1;
+
+			SAFE_FSYNC(fd);
+			len /= 2;
+			continue;
+		}
+
+		*w->written += ret;
+		off += ret;
+		len -= ret;
+	}
+
+	return 0;
+}
+
+/*
+ * Writes one file, returns 1 once the filesystem is full.
+ */
+static int fill_file(struct fill_worker *w, const char *file, uint64_t seed,
+		     size_t len)
+{
+	int direct = !!(w->flags & TST_FILL_DIRECT);
+	size_t bulk_len = len, rem;
+	off_t off = 0;
+	int fd, err;
+
+	fd = fill_open(w, file, direct);
+	if (fd == -1) {
+		if (w->verbose)
+			tst_res(TINFO | TERRNO, "open(%s)", file);
+		return 1;
+	}
+
+	direct = !!(w->flags & TST_FILL_DIRECT);
+
+	if (w->flags & TST_FILL_FALLOCATE && len && len != SIZE_MAX) {
+		if (fallocate(fd, 0, 0, len) && errno != ENOSPC) {
+			if (errno != EOPNOTSUPP)
+				tst_brk(TBROK | TERRNO, "fallocate(%s)", file);
+
+			if (w->verbose)
+				tst_res(TINFO, "fallocate() not supported in %s", w->dir);
+
+			w->flags &= ~TST_FILL_FALLOCATE;
+		}
+	}
+
+	if (direct)
+		bulk_len -= len % FILL_ALIGN;
+
+	if (w->flags & TST_FILL_IO_URING)
+		err = fill_bulk_uring(w, fd, seed, &off, bulk_len);
+	else
+		err = fill_bulk_sync(w, fd, seed, &off, bulk_len);
+
+	if (err && err != ENOSPC) {
+		errno = err;
+		tst_brk(TBROK | TERRNO, "write(%s)", file);
+	}
+
+	if (direct) {
+		SAFE_CLOSE(fd);
+		fd = SAFE_OPEN(file, O_WRONLY);
+	}
+
+	rem = len == SIZE_MAX ? 0 : len - off;
+
+	if (err)
+		rem = MAX(MIN(rem, (size_t)FILL_CHUNK), w->bsize);
+
+	err = fill_tail(w, fd, seed, off, rem);
+
+	SAFE_CLOSE(fd);
+
+	return err;
+}
+
+static void fill_worker_run(struct fill_worker *w)
+{
+	char file[PATH_MAX + 16];
+	struct statvfs fi;
+	struct io_uring_params params = {};
+	size_t buf_size = FILL_CHUNK;
+	unsigned int i;
+	uint64_t seed;
+	size_t len;
+
+	if (statvfs(w->dir, &fi))
+		tst_brk(TBROK | TERRNO, "statvfs(%s)", w->dir);
+
+	w->bsize = fi.f_bsize;
+
+	if (w->flags & TST_FILL_IO_URING) {
+		SAFE_IO_URING_INIT(FILL_QD, &params, &w->ring);
+		buf_size *= FILL_QD;
+	}
+
+	w->buf = SAFE_MMAP(NULL, buf_size, PROT_READ | PROT_WRITE,
+			   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	for (i = 0; i < FILL_QD; i++)
+		w->iov[i].iov_base = w->buf + (i * FILL_CHUNK) % buf_size;
+
+	srandom(w->id + 1);
+
+	for (i = 0; ; i++) {
+		seed = ((uint64_t)w->id << 32) | i;
+
+		if (w->pattern == TST_FILL_BLOCKS) {
+			snprintf(file, sizeof(file), "%s/AOF", w->dir);
+			len = SIZE_MAX;
+		} else {
+			snprintf(file, sizeof(file), "%s/file%u", w->dir, i);
+			len = random() % (1024 * 102400);
+		}
+
+		if (w->verbose)
+			tst_res(TINFO, "Creating file %s", file);
+
+		if (fill_file(w, file, seed, len) || w->pattern == TST_FILL_BLOCKS)
+			break;
+	}
+
+	if (w->flags & TST_FILL_IO_URING)
+		SAFE_IO_URING_CLOSE(&w->ring);
+
+	SAFE_MUNMAP(w->buf, buf_size);
+}
+
+static int fill_uring_supported(void)
+{
+	struct io_uring_params params = {};
+	long fd;
+
+	fd = syscall(__NR_io_uring_setup, FILL_QD, &params);
+	if (fd == -1)
+		return 0;
+
 	SAFE_CLOSE(fd);
+	return 1;
+}
+
+unsigned long long tst_fill_fs_parallel(const char *path,
+	enum tst_fill_access_pattern pattern,
+	const struct tst_fill_fs_opts *opts)
+{
+	struct tst_fill_fs_opts def = {};
+	unsigned int i, nworkers, started = 0;
+	unsigned long long *written, total = 0;
+	struct timespec start, end;
+	struct fill_worker w;
+	long long us;
+	int status;
+	pid_t *pids;
+
+	if (!opts)
+		opts = &def;
+
+	nworkers = opts->workers ? opts->workers : tst_ncpus_available();
+
+	memset(&w, 0, sizeof(w));
+	w.pattern = pattern;
+	w.flags = opts->flags;
+	w.verbose = opts->verbose;
+
+	if (w.flags & TST_FILL_IO_URING && !fill_uring_supported()) {
+		tst_res(TINFO | TERRNO, "io_uring not available, using pwrite()");
+		w.flags &= ~TST_FILL_IO_URING;
+	}
+
+	written = SAFE_MMAP(NULL, sizeof(*written) * nworkers,
+			    PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS,
+			    -1, 0);
+	pids = SAFE_MALLOC(sizeof(*pids) * nworkers);
+
+	SAFE_CLOCK_GETTIME(CLOCK_MONOTONIC, &start);
+
+	for (i = 0; i < nworkers; i++) {
+		snprintf(w.dir, sizeof(w.dir), "%s/fill%u", path, i);
+
+		if (mkdir(w.dir, 0700) && errno != EEXIST) {
+			if (errno != ENOSPC)
+				tst_brk(TBROK | TERRNO, "mkdir(%s)", w.dir);
+
+			tst_res(TINFO | TERRNO, "mkdir(%s)", w.dir);
+			break;
+		}
+
+		w.id = i;
+		w.written = &written[i];
+		written[i] = 0;
+
+		fflush(stdout);
+		pids[i] = fork();
+
+		if (pids[i] < 0)
+			tst_brk(TBROK | TERRNO, "fork()");
+
+		if (!pids[i]) {
+			fill_worker_run(&w);
+			exit(0);
+		}
+
+		started++;
+	}
+
+	for (i = 0; i < started; i++) {
+		SAFE_WAITPID(pids[i], &status, 0);
+
+		if (!WIFEXITED(status) || WEXITSTATUS(status)) {
+			tst_brk(TBROK, "Fill worker %u %s", i,
+				tst_strstatus(status));
+		}
+
+		total += written[i];
+	}
+
+	SAFE_CLOCK_GETTIME(CLOCK_MONOTONIC, &end);
+
+	us = MAX(tst_timespec_diff_us(end, start), 1LL);
+
+	tst_res(TINFO, "Filled %s with %llu MB by %u workers in %.1fs (%.1f MB/s)",
+		path, total / TST_MB, started, us / 1000000.0,
+		(double)total / us);
+
+	free(pids);
+	SAFE_MUNMAP(written, sizeof(*written) * nworkers);
+
+	return total;
 }
 
 void tst_fill_fs(const char *path, int verbose, enum tst_fill_access_pattern pattern)
@@ -0,0 +1,295 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (c) Linux Test Project, 2026
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TST_NO_DEFAULT_MAIN
+#include "tst_test.h"
+#include "tst_safe_pthread.h"
+#include "tst_fuzzy_sync.h"
+
+#define CPU_PATH "/sys/devices/system/cpu/cpu%i/"
+
+struct cpu_topo {
+	int cpu;
+	/* first CPU of the core, the last level cache and the package id */
+	int core;
+	int llc;
+	int package;
+	int used;
+};
+
+static const char *const placement_names[] = {
+	[TST_FZSYNC_UNPINNED] = "unpinned",
+	[TST_FZSYNC_SAME_CORE] = "same core",
+	[TST_FZSYNC_SAME_LLC] = "same LLC",
+	[TST_FZSYNC_CROSS_SOCKET] = "cross socket",
+};
+
+/* Reads the first number from a sysfs file, e.g. a CPU list, or returns -1 */
+static int read_first_int(const char *fmt, int cpu, const char *file)
+{
+	char path[256];
+	FILE *f;
+	int ret;
+
+	snprintf(path, sizeof(path), fmt, cpu);
+	strncat(path, file, sizeof(path) - strlen(path) - 1);
+
+	f = fopen(path, "r");
+	if (!f)
+		return -1;
+
+	if (fscanf(f, "%i", &ret) != 1)
+		ret = -1;
+
+	fclose(f);
+
+	return ret;
+}
+
+static void read_topo(struct cpu_topo *t, int cpu)
+{
+	char file[64];
+	int i, llc;
+
+	t->cpu = cpu;
+	t->core = read_first_int(CPU_PATH, cpu, "topology/thread_siblings_list");
+	t->package = read_first_int(CPU_PATH, cpu, "topology/physical_package_id");
+	t->used = 0;
+
+	/* The highest cache index is the last level cache */
+	t->llc = -1;
+	for (i = 0; ; i++) {
+		snprintf(file, sizeof(file), "cache/index%i/shared_cpu_list", i);
+		llc = read_first_int(CPU_PATH, cpu, file);
+		if (llc < 0)
+			break;
+		t->llc = llc;
+	}
+}
+
+static struct cpu_topo *get_topo(unsigned int *ncpus)
+{
+	long cpu, max = tst_ncpus_max();
+	size_t size = CPU_ALLOC_SIZE(max);
+	cpu_set_t *set = CPU_ALLOC(max);
+	struct cpu_topo *topo;
+
+	if (!set)
+		tst_brk(TBROK | TERRNO, "CPU_ALLOC(%ld)", max);
+
+	*ncpus = 0;
+
+	if (sched_getaffinity(0, size, set)) {
+		CPU_FREE(set);
+		return NULL;
+	}
+
+	topo = SAFE_MALLOC(CPU_COUNT_S(size, set) * sizeof(*topo));
+
+	for (cpu = 0; cpu < max; cpu++) {
+		if (CPU_ISSET_S(cpu, size, set))
+			read_topo(&topo[(*ncpus)++], cpu);
+	}
+
+	CPU_FREE(set);
+
+	return topo;
+}
+
+static int placement_match(enum tst_fzsync_placement placement,
+			   const struct cpu_topo *a, const struct cpu_topo *b)
+{
+	switch (placement) {
+	case TST_FZSYNC_SAME_CORE:
+		return a->core >= 0 && a->core == b->core;
+	case TST_FZSYNC_SAME_LLC:
+		return a->llc >= 0 && a->llc == b->llc && a->core != b->core;
+	case TST_FZSYNC_CROSS_SOCKET:
+		return a->package >= 0 && b->package >= 0 &&
+		       a->package != b->package;
+	default:
+		return 0;
+	}
+}
+
+static int assign_cpus(struct tst_fzsync_multi_pair *mp,
+		       enum tst_fzsync_placement placement,
+		       struct cpu_topo *topo, unsigned int ncpus)
+{
+	unsigned int i, j;
+
+	for (i = 0; i < ncpus; i++) {
+		if (topo[i].used)
+			continue;
+
+		for (j = 0; j < ncpus; j++) {
+			if (i == j || topo[j].used ||
+			    !placement_match(placement, &topo[i], &topo[j]))
+				continue;
+
+			topo[i].used = topo[j].used = 1;
+			mp->placement = placement;
+			mp->cpu_a = topo[i].cpu;
+			mp->cpu_b = topo[j].cpu;
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+void tst_fzsync_multi_init(struct tst_fzsync_multi *multi)
+{
+	unsigned int ncpus, placement = 0, i, j;
+	struct tst_fzsync_multi_pair *mp;
+	struct cpu_topo *topo;
+
+	topo = get_topo(&ncpus);
+
+	if (!multi->npairs)
+		multi->npairs = MAX(ncpus / 2, 1U);
+
+	if (!multi->placements)
+		multi->placements = ~0U;
+
+	tst_fzsync_pair_init(&multi->pair);
+
+	multi->stop = 0;
+	multi->pairs = SAFE_MALLOC(multi->npairs * sizeof(*multi->pairs));
+	memset(multi->pairs, 0, multi->npairs * sizeof(*multi->pairs));
+
+	for (i = 0; i < (unsigned int)multi->npairs; i++) {
+		mp = &multi->pairs[i];
+		mp->pair = multi->pair;
+		mp->pair.stop = &multi->stop;
+		mp->idx = i;
+		mp->multi = multi;
+		mp->placement = TST_FZSYNC_UNPINNED;
+		mp->cpu_a = mp->cpu_b = -1;
+
+		/* Try the placements in turns, skip the unavailable ones */
+		for (j = 0; j < TST_FZSYNC_PLACEMENTS - 1; j++) {
+			placement = placement % (TST_FZSYNC_PLACEMENTS - 1) + 1;
+
+			if (!(multi->placements & (1U << placement)))
+				continue;
+
+			if (assign_cpus(mp, placement, topo, ncpus))
+				break;
+		}
+
+		tst_res(TINFO, "Pair %i: %s, CPUs %i and %i", i,
+			placement_names[mp->placement], mp->cpu_a, mp->cpu_b);
+	}
+
+	free(topo);
+}
+
+static void create_pinned(pthread_t *thread, int cpu, void *(*fn)(void *),
+			  void *arg)
+{
+	pthread_attr_t attr;
+	cpu_set_t set;
+
+	pthread_attr_init(&attr);
+
+	if (cpu >= 0 && cpu < CPU_SETSIZE) {
+		CPU_ZERO(&set);
+		CPU_SET(cpu, &set);
+		pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+	}
+
+	SAFE_PTHREAD_CREATE(thread, &attr, fn, arg);
+	pthread_attr_destroy(&attr);
+}
+
+static void print_hit_rates(struct tst_fzsync_multi *multi)
+{
+	unsigned long long loops[TST_FZSYNC_PLACEMENTS] = {};
+	unsigned long hits[TST_FZSYNC_PLACEMENTS] = {};
+	int pairs[TST_FZSYNC_PLACEMENTS] = {};
+	struct tst_fzsync_multi_pair *mp;
+	int i;
+
+	for (i = 0; i < multi->npairs; i++) {
+		mp = &multi->pairs[i];
+		pairs[mp->placement]++;
+		loops[mp->placement] += mp->pair.exec_loop;
+		hits[mp->placement] += mp->hits;
+	}
+
+	for (i = 0; i < TST_FZSYNC_PLACEMENTS; i++) {
+		if (!pairs[i])
+			continue;
+
+		tst_res(TINFO, "%-12s: %i pairs, %llu loops, %lu hits (%.3g per loop)",
+			placement_names[i], pairs[i], loops[i], hits[i],
+			loops[i] ? (double)hits[i] / loops[i] : 0.0);
+	}
+}
+
+unsigned long tst_fzsync_multi_run(struct tst_fzsync_multi *multi,
+				   void *(*run_a)(void *),
+				   void *(*run_b)(void *))
+{
+	struct tst_fzsync_multi_pair *mp;
+	unsigned long hits = 0;
+	int i;
+
+	tst_atomic_store(0, &multi->stop);
+
+	for (i = 0; i < multi->npairs; i++) {
+		mp = &multi->pairs[i];
+		mp->hits = 0;
+		tst_fzsync_pair_reset(&mp->pair, NULL);
+		create_pinned(&mp->pair.thread_b, mp->cpu_b, run_b, mp);
+		create_pinned(&mp->thread_a, mp->cpu_a, run_a, mp);
+	}
+
+	/* Thread A joins thread B when tst_fzsync_run_a() returns 0 */
+	for (i = 0; i < multi->npairs; i++) {
+		mp = &multi->pairs[i];
+		SAFE_PTHREAD_JOIN(mp->thread_a, NULL);
+		mp->thread_a = 0;
+		hits += mp->hits;
+	}
+
+	print_hit_rates(multi);
+
+	return hits;
+}
+
+void tst_fzsync_multi_cleanup(struct tst_fzsync_multi *multi)
+{
+	struct tst_fzsync_multi_pair *mp;
+	int i;
+
+	if (!multi->pairs)
+		return;
+
+	tst_atomic_store(1, &multi->stop);
+
+	for (i = 0; i < multi->npairs; i++) {
+		mp = &multi->pairs[i];
+
+		if (mp->thread_a) {
+			tst_atomic_store(1, &mp->pair.exit);
+			SAFE_PTHREAD_JOIN(mp->thread_a, NULL);
+			mp->thread_a = 0;
+		}
+
+		tst_fzsync_pair_cleanup(&mp->pair);
+	}
+
+	free(multi->pairs);
+	multi->pairs = NULL;
+}
@@ -0,0 +1,217 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (c) Linux Test Project, 2026
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tst_minmax.h"
+#include "tst_histogram.h"
+
+#define MAX_SUB_BITS 20
+
+static unsigned int bucket_idx(const struct tst_histogram *h, long long v)
+{
+	unsigned int msb, grp;
+
+	if (v < (1LL << h->sub_bits))
+		return v;
+
+	msb = 63 - __builtin_clzll(v);
+	grp = msb - h->sub_bits + 1;
+
+	return (grp << h->sub_bits) + (v >> (grp - 1)) - (1LL << h->sub_bits);
+}
+
+long long tst_histogram_bucket_lo(const struct tst_histogram *h,
+				  unsigned int idx)
+{
+	unsigned int grp = idx >> h->sub_bits;
+	long long sub = idx & ((1U << h->sub_bits) - 1);
+
+	if (!grp)
+		return sub;
+
+	return ((1LL << h->sub_bits) + sub) << (grp - 1);
+}
+
+long long tst_histogram_bucket_hi(const struct tst_histogram *h,
+				  unsigned int idx)
+{
+	unsigned int grp = idx >> h->sub_bits;
+
+	if (!grp)
+		return idx;
+
+	return tst_histogram_bucket_lo(h, idx) + (1LL << (grp - 1)) - 1;
+}
+
+long long tst_histogram_bucket_value(const struct tst_histogram *h,
+				     unsigned int idx)
+{
+	long long lo = tst_histogram_bucket_lo(h, idx);
+	long long v = lo + (tst_histogram_bucket_hi(h, idx) - lo) / 2;
+
+	return MIN(MAX(v, h->min), h->max);
+}
+
+int tst_histogram_init(struct tst_histogram *h, long long max_value,
+		       unsigned int sub_bits)
+{
+	memset(h, 0, sizeof(*h));
+
+	if (max_value < 1 || !sub_bits || sub_bits > MAX_SUB_BITS) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	h->sub_bits = sub_bits;
+	h->max_value = max_value;
+	h->nbuckets = bucket_idx(h, max_value) + 1;
+	h->counts = calloc(h->nbuckets, sizeof(*h->counts));
+
+	if (!h->counts)
+		return -1;
+
+	tst_histogram_reset(h);
+
+	return 0;
+}
+
+void tst_histogram_free(struct tst_histogram *h)
+{
+	free(h->counts);
+	h->counts = NULL;
+}
+
+void tst_histogram_reset(struct tst_histogram *h)
+{
+	memset(h->counts, 0, h->nbuckets * sizeof(*h->counts));
+	h->count = 0;
+	h->min = 0;
+	h->max = 0;
+	h->sum = 0;
+	h->sum_sq = 0;
+}
+
+void tst_histogram_record(struct tst_histogram *h, long long value)
+{
+	if (!h->count || value < h->min)
+		h->min = value;
+
+	if (!h->count || value > h->max)
+		h->max = value;
+
+	h->count++;
+	h->sum += value;
+	h->sum_sq += (long double)value * value;
+
+	h->counts[bucket_idx(h, MIN(MAX(value, 0LL), h->max_value))]++;
+}
+
+int tst_histogram_merge(struct tst_histogram *dst,
+			const struct tst_histogram *src)
+{
+	unsigned int i;
+
+	if (dst->sub_bits != src->sub_bits || dst->nbuckets != src->nbuckets) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (!src->count)
+		return 0;
+
+	if (!dst->count || src->min < dst->min)
+		dst->min = src->min;
+
+	if (!dst->count || src->max > dst->max)
+		dst->max = src->max;
+
+	dst->count += src->count;
+	dst->sum += src->sum;
+	dst->sum_sq += src->sum_sq;
+
+	for (i = 0; i < dst->nbuckets; i++)
+		dst->counts[i] += src->counts[i];
+
+	return 0;
+}
+
+long long tst_histogram_percentile(const struct tst_histogram *h, double p)
+{
+	uint64_t target, seen = 0;
+	double exact;
+	unsigned int i;
+
+	if (!h->count)
+		return 0;
+
+	if (p <= 0)
+		return h->min;
+
+	if (p >= 100)
+		return h->max;
+
+	exact = p / 100 * h->count;
+	target = exact;
+
+	if (target < exact || !target)
+		target++;
+
+	for (i = 0; i < h->nbuckets; i++) {
+		seen += h->counts[i];
+
+		if (seen >= target)
+			break;
+	}
+
+	return MIN(MAX(tst_histogram_bucket_hi(h, i), h->min), h->max);
+}
+
+double tst_histogram_mean(const struct tst_histogram *h)
+{
+	if (!h->count)
+		return 0;
+
+	return h->sum / h->count;
+}
+
+double tst_histogram_variance(const struct tst_histogram *h)
+{
+	long double mean, var;
+
+	if (!h->count)
+		return 0;
+
+	mean = h->sum / h->count;
+	var = h->sum_sq / h->count - mean * mean;
+
+	return var > 0 ? var : 0;
+}
+
+int tst_histogram_write_csv(const struct tst_histogram *h, FILE *f)
+{
+	uint64_t seen = 0;
+	unsigned int i;
+
+	if (fprintf(f, "value,count,percentile\n") < 0)
+		return -1;
+
+	for (i = 0; i < h->nbuckets; i++) {
+		if (!h->counts[i])
+			continue;
+
+		seen += h->counts[i];
+
+		if (fprintf(f, "%lli,%llu,%.6f\n",
+			    MIN(tst_histogram_bucket_hi(h, i), h->max),
+			    (unsigned long long)h->counts[i],
+			    100.0 * seen / h->count) < 0)
+			return -1;
+	}
+
+	return 0;
+}
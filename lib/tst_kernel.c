@@ -90,63 +90,215 @@ int tst_kernel_bits(void)
 	return kernel_bits;
 }
 
-static int tst_search_driver_(const char *driver, const char *file)
+#define MOD_DEP		0x01
+#define MOD_BUILTIN	0x02
+
+struct mod_entry {
+	char *name;
+	/* MOD_* flags, zero for aliases */
+	int flags;
+	/* module name for entries from modules.alias */
+	char *alias_of;
+};
+
+/*
+ * Hash index of module names from modules.dep, modules.builtin and the plain
+ * (not wildcard) aliases from modules.alias, built on the first lookup.
+ */
+static struct mod_index {
+	struct mod_entry *entries;
+	size_t size;
+	size_t used;
+	/* MOD_* flags of the files that could be read */
+	int loaded;
+	int built;
+} mod_index;
+
+/* Module names do not distinguish dashes and underscores */
+static void normalize_name(char *name)
 {
-	struct stat st;
-	char buf[PATH_MAX];
-	char *path = NULL, *search = NULL, *sep = NULL;
-	FILE *f;
-	int ret = -1;
+	while ((name = strchr(name, '-')))
+		*name++ = '_';
+}
 
-	struct utsname uts;
+static size_t hash_name(const char *name)
+{
+	size_t h = 2166136261u;
 
-	if (uname(&uts)) {
-		tst_brkm(TBROK | TERRNO, NULL, "uname() failed");
-		return -1;
+	while (*name) {
+		h ^= (unsigned char)*name++;
+		h *= 16777619u;
 	}
-	SAFE_ASPRINTF(NULL, &path, "/lib/modules/%s/%s", uts.release, file);
 
-	if (stat(path, &st) || !(S_ISREG(st.st_mode) || S_ISLNK(st.st_mode))) {
-		tst_resm(TWARN, "expected file %s does not exist or not a file", path);
-		return -1;
+	return h;
+}
+
+static struct mod_entry *index_slot(struct mod_entry *entries, size_t size,
+				    const char *name)
+{
+	size_t i = hash_name(name) & (size - 1);
+
+	while (entries[i].name && strcmp(entries[i].name, name))
+		i = (i + 1) & (size - 1);
+
+	return &entries[i];
+}
+
+static void index_grow(void)
+{
+	struct mod_index *idx = &mod_index;
+	size_t i, size = idx->size ? 2 * idx->size : 4096;
+	struct mod_entry *entries = calloc(size, sizeof(*entries));
+
+	if (!entries)
+		tst_brkm(TBROK | TERRNO, NULL, "calloc() failed");
+
+	for (i = 0; i < idx->size; i++) {
+		if (idx->entries[i].name)
+			*index_slot(entries, size, idx->entries[i].name) = idx->entries[i];
 	}
 
-	if (access(path, R_OK)) {
-		tst_resm(TWARN, "file %s cannot be read", path);
-		return -1;
+	free(idx->entries);
+	idx->entries = entries;
+	idx->size = size;
+}
+
+static void index_add(const char *name, int flags, const char *alias_of)
+{
+	struct mod_index *idx = &mod_index;
+	struct mod_entry *e;
+	char *key = strdup(name);
+
+	if (!key)
+		tst_brkm(TBROK | TERRNO, NULL, "strdup() failed");
+
+	normalize_name(key);
+
+	if (2 * (idx->used + 1) > idx->size)
+		index_grow();
+
+	e = index_slot(idx->entries, idx->size, key);
+
+	if (e->name) {
+		free(key);
+		e->flags |= flags;
+		return;
 	}
 
-	/* always search for x86_64 */
-	char *fix = strstr(driver, "x86-64");
+	e->name = key;
+	e->flags = flags;
+	e->alias_of = NULL;
+	idx->used++;
 
-	if (fix)
-		fix[3] = '_';
+	if (alias_of) {
+		e->alias_of = strdup(alias_of);
+		if (!e->alias_of)
+			tst_brkm(TBROK | TERRNO, NULL, "strdup() failed");
+		normalize_name(e->alias_of);
+	}
+}
+
+static FILE *open_modules_file(const char *release, const char *file,
+			       int warn)
+{
+	struct stat st;
+	char *path;
+	FILE *f = NULL;
+
+	SAFE_ASPRINTF(NULL, &path, "/lib/modules/%s/%s", release, file);
 
-	SAFE_ASPRINTF(NULL, &search, "/%s.ko", driver);
+	if (stat(path, &st) || !(S_ISREG(st.st_mode) || S_ISLNK(st.st_mode))) {
+		if (warn)
+			tst_resm(TWARN, "expected file %s does not exist or not a file", path);
+	} else if (access(path, R_OK)) {
+		if (warn)
+			tst_resm(TWARN, "file %s cannot be read", path);
+	} else {
+		f = SAFE_FOPEN(NULL, path, "r");
+	}
 
-	f = SAFE_FOPEN(NULL, path, "r");
+	free(path);
+
+	return f;
+}
+
+/* Adds "kernel/path/name.ko[.xz]: deps" and "kernel/path/name.ko" lines */
+static void index_modules(const char *release, const char *file, int flags)
+{
+	char buf[PATH_MAX], *name, *sep;
+	FILE *f = open_modules_file(release, file, 1);
+
+	if (!f)
+		return;
 
 	while (fgets(buf, sizeof(buf), f)) {
-		/* cut dependencies after : */
 		if ((sep = strchr(buf, ':')))
 			*sep = 0;
 
-		/* driver found */
-		if (strstr(buf, search) != NULL) {
-			ret = 0;
-			break;
-		}
+		name = strrchr(buf, '/');
+		name = name ? name + 1 : buf;
+
+		sep = strstr(name, ".ko");
+		if (!sep)
+			continue;
+
+		*sep = 0;
+		index_add(name, flags, NULL);
 	}
 
 	SAFE_FCLOSE(NULL, f);
-	free(search);
-	free(path);
+	mod_index.loaded |= flags;
+}
+
+/* Adds "alias <name> <module>" lines unless the name is a pattern */
+static void index_aliases(const char *release)
+{
+	char buf[PATH_MAX], alias[256], module[256];
+	FILE *f = open_modules_file(release, "modules.alias", 0);
+
+	if (!f)
+		return;
+
+	while (fgets(buf, sizeof(buf), f)) {
+		if (sscanf(buf, "alias %255s %255s", alias, module) != 2)
+			continue;
+
+		if (strpbrk(alias, "*?["))
+			continue;
+
+		index_add(alias, 0, module);
+	}
+
+	SAFE_FCLOSE(NULL, f);
+}
+
+static void build_mod_index(void)
+{
+	struct utsname uts;
+
+	if (mod_index.built)
+		return;
+
+	if (uname(&uts)) {
+		tst_brkm(TBROK | TERRNO, NULL, "uname() failed");
+		return;
+	}
 
-	return ret;
+	index_modules(uts.release, "modules.dep", MOD_DEP);
+	index_modules(uts.release, "modules.builtin", MOD_BUILTIN);
+
+	/* Aliases refer to modules from the files above */
+	if (mod_index.loaded)
+		index_aliases(uts.release);
+
+	mod_index.built = 1;
 }
 
-static int tst_search_driver(const char *driver, const char *file)
+static int tst_search_driver(const char *driver, int flags)
 {
+	struct mod_entry *e;
+	char *name;
+
 #ifdef __ANDROID__
 	/*
 	 * Android may not have properly installed modules.* files. We could
@@ -157,44 +309,34 @@ static int tst_search_driver(const char *driver, const char *file)
 	return 0;
 #endif
 
-	if (!tst_search_driver_(driver, file))
-		return 0;
+	build_mod_index();
 
-	int ret = -1;
+	if (!(mod_index.loaded & flags) || !mod_index.used)
+		return -1;
 
-	if (strrchr(driver, '-') || strrchr(driver, '_')) {
-		char *driver2 = strdup(driver);
-		char *ix = driver2;
-		char find = '-', replace = '_';
+	name = strdup(driver);
+	if (!name)
+		tst_brkm(TBROK | TERRNO, NULL, "strdup() failed");
 
-		if (strrchr(driver, '_')) {
-			find = '_';
-			replace = '-';
-		}
+	normalize_name(name);
+	e = index_slot(mod_index.entries, mod_index.size, name);
+	free(name);
 
-		while ((ix = strchr(ix, find)))
-			*ix++ = replace;
+	if (e->name && e->alias_of)
+		e = index_slot(mod_index.entries, mod_index.size, e->alias_of);
 
-		ret = tst_search_driver_(driver2, file);
-		free(driver2);
-	}
+	if (e->name && (e->flags & flags))
+		return 0;
 
-	return ret;
+	return -1;
 }
 
 int tst_check_builtin_driver(const char *driver)
 {
-	if (!tst_search_driver(driver, "modules.builtin"))
-		return 0;
-
-	return -1;
+	return tst_search_driver(driver, MOD_BUILTIN);
 }
 
 int tst_check_driver(const char *driver)
 {
-	if (!tst_search_driver(driver, "modules.dep") ||
-		!tst_search_driver(driver, "modules.builtin"))
-		return 0;
-
-	return -1;
+	return tst_search_driver(driver, MOD_DEP | MOD_BUILTIN);
 }
@@ -0,0 +1,244 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (c) Linux Test Project, 2026
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TST_NO_DEFAULT_MAIN
+#include "tst_test.h"
+#include "tst_cpu.h"
+#include "tst_minmax.h"
+#include "tst_safe_pthread.h"
+#include "tst_mem_pattern.h"
+
+/* Blocks without mismatch are skipped after a single vector compare */
+#define BLOCK_SIZE 256
+/* Do not start a thread for less than this */
+#define MIN_THREAD_SIZE (64 * 1024 * 1024)
+
+typedef uint64_t vec_t __attribute__((vector_size(32), may_alias));
+
+struct verify_ctx {
+	struct tst_mem_verify_res res;
+	/* end of the last mismatching range, stored or not */
+	size_t last_end;
+};
+
+struct mem_work {
+	unsigned char *addr;
+	size_t off;
+	size_t size;
+	unsigned char c;
+	int verify;
+	struct verify_ctx ctx;
+};
+
+static void add_bad_byte(struct verify_ctx *ctx, size_t off, unsigned char found)
+{
+	struct tst_mem_verify_res *res = &ctx->res;
+
+	res->bad_bytes++;
+
+	if (res->nranges && ctx->last_end == off) {
+		if (res->nranges <= TST_MEM_RANGES_MAX)
+			res->ranges[res->nranges - 1].len++;
+	} else {
+		if (res->nranges < TST_MEM_RANGES_MAX) {
+			res->ranges[res->nranges].off = off;
+			res->ranges[res->nranges].len = 1;
+			res->ranges[res->nranges].found = found;
+		}
+		res->nranges++;
+	}
+
+	ctx->last_end = off + 1;
+}
+
+static void scan_bytes(struct verify_ctx *ctx, const unsigned char *addr,
+		       size_t off, size_t size, unsigned char c)
+{
+	size_t i;
+
+	for (i = off; i < off + size; i++) {
+		if (addr[i] != c)
+			add_bad_byte(ctx, i, addr[i]);
+	}
+}
+
+static void verify_range(struct verify_ctx *ctx, const unsigned char *addr,
+			 size_t off, size_t size, unsigned char c)
+{
+	size_t head, i, end = off + size;
+	vec_t pat, acc;
+	const vec_t *v;
+	unsigned int k;
+
+	memset(&pat, c, sizeof(pat));
+
+	head = -(uintptr_t)(addr + off) & (sizeof(vec_t) - 1);
+	head = MIN(head, size);
+	scan_bytes(ctx, addr, off, head, c);
+
+	for (i = off + head; end - i >= BLOCK_SIZE; i += BLOCK_SIZE) {
+		v = (const vec_t *)(addr + i);
+		acc = v[0] ^ pat;
+
+		for (k = 1; k < BLOCK_SIZE / sizeof(vec_t); k++)
+			acc |= v[k] ^ pat;
+
+		if (acc[0] | acc[1] | acc[2] | acc[3])
+			scan_bytes(ctx, addr, i, BLOCK_SIZE, c);
+	}
+
+	scan_bytes(ctx, addr, i, end - i, c);
+}
+
+static void *mem_worker(void *arg)
+{
+	struct mem_work *w = arg;
+
+	if (w->verify)
+		verify_range(&w->ctx, w->addr, w->off, w->size, w->c);
+	else
+		memset(w->addr + w->off, w->c, w->size);
+
+	return arg;
+}
+
+static unsigned int thread_count(size_t size, unsigned int threads)
+{
+	if (threads == TST_MEM_THREADS_AUTO) {
+		threads = MAX(tst_ncpus_available(), 1L);
+		threads = MIN((size_t)threads, size / MIN_THREAD_SIZE);
+	}
+
+	threads = MIN((size_t)threads, size / BLOCK_SIZE);
+
+	return MAX(threads, 1U);
+}
+
+static struct mem_work *run_workers(void *addr, size_t size, int c,
+				    int verify, unsigned int threads)
+{
+	size_t slice = size / threads / BLOCK_SIZE * BLOCK_SIZE;
+	struct mem_work *w = SAFE_MALLOC(threads * sizeof(*w));
+	pthread_t *tids = NULL;
+	unsigned int i;
+
+	memset(w, 0, threads * sizeof(*w));
+
+	for (i = 0; i < threads; i++) {
+		w[i].addr = addr;
+		w[i].off = i * slice;
+		w[i].size = i == threads - 1 ? size - w[i].off : slice;
+		w[i].c = c;
+		w[i].verify = verify;
+	}
+
+	if (threads > 1) {
+		tids = SAFE_MALLOC(threads * sizeof(*tids));
+
+		for (i = 1; i < threads; i++)
+			SAFE_PTHREAD_CREATE(&tids[i], NULL, mem_worker, &w[i]);
+	}
+
+	mem_worker(&w[0]);
+
+	for (i = 1; i < threads; i++)
+		SAFE_PTHREAD_JOIN(tids[i], NULL);
+
+	free(tids);
+
+	return w;
+}
+
+void tst_mem_fill(void *addr, size_t size, int c, unsigned int threads)
+{
+	threads = thread_count(size, threads);
+
+	if (threads == 1) {
+		memset(addr, c, size);
+		return;
+	}
+
+	free(run_workers(addr, size, c, 0, threads));
+}
+
+/* Appends ranges found by a thread, joins ranges across the slice boundary */
+static void merge_ctx(struct verify_ctx *dst, const struct verify_ctx *src)
+{
+	const struct tst_mem_verify_res *sres = &src->res;
+	struct tst_mem_verify_res *dres = &dst->res;
+	size_t i = 0;
+
+	if (!sres->nranges)
+		return;
+
+	dres->bad_bytes += sres->bad_bytes;
+
+	if (dres->nranges && dst->last_end == sres->ranges[0].off) {
+		if (dres->nranges <= TST_MEM_RANGES_MAX)
+			dres->ranges[dres->nranges - 1].len += sres->ranges[0].len;
+		i = 1;
+	}
+
+	for (; i < sres->nranges; i++) {
+		if (dres->nranges < TST_MEM_RANGES_MAX)
+			dres->ranges[dres->nranges] = sres->ranges[i];
+		dres->nranges++;
+	}
+
+	dst->last_end = src->last_end;
+}
+
+size_t tst_mem_verify(const void *addr, size_t size, int c,
+		      unsigned int threads, struct tst_mem_verify_res *res)
+{
+	struct verify_ctx ctx;
+	struct mem_work *w;
+	unsigned int i;
+
+	memset(&ctx, 0, sizeof(ctx));
+	threads = thread_count(size, threads);
+
+	if (threads == 1) {
+		verify_range(&ctx, addr, 0, size, c);
+	} else {
+		w = run_workers((void *)addr, size, c, 1, threads);
+
+		for (i = 0; i < threads; i++)
+			merge_ctx(&ctx, &w[i].ctx);
+
+		free(w);
+	}
+
+	if (res)
+		*res = ctx.res;
+
+	return ctx.res.bad_bytes;
+}
+
+void tst_mem_verify_report(const struct tst_mem_verify_res *res, int c,
+			   const char *desc)
+{
+	size_t i;
+
+	tst_res(TFAIL, "%s: %zu bytes in %zu ranges differ from 0x%02x",
+		desc, res->bad_bytes, res->nranges, c & 0xff);
+
+	for (i = 0; i < MIN(res->nranges, (size_t)TST_MEM_RANGES_MAX); i++) {
+		tst_res(TINFO, "%s: 0x%02x at offset %zu-%zu (%zu bytes)",
+			desc, res->ranges[i].found, res->ranges[i].off,
+			res->ranges[i].off + res->ranges[i].len - 1,
+			res->ranges[i].len);
+	}
+
+	if (res->nranges > TST_MEM_RANGES_MAX) {
+		tst_res(TINFO, "%s: %zu more ranges not shown", desc,
+			res->nranges - TST_MEM_RANGES_MAX);
+	}
+}
@@ -3,26 +3,222 @@
  * Copyright (c) 2020 SUSE LLC <mdoucha@suse.cz>
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <unistd.h>
 #include <limits.h>
+#include <sched.h>
 #include <sys/sysinfo.h>
+#include <sys/wait.h>
 #include <stdlib.h>
 
 #define TST_NO_DEFAULT_MAIN
 #include "tst_test.h"
 #include "tst_capability.h"
+#include "tst_memutils.h"
+#include "tst_timer.h"
+#include "lapi/mmap.h"
 #include "lapi/syscalls.h"
 
 #define BLOCKSIZE (16 * 1024 * 1024)
 
-void tst_pollute_memory(size_t maxsize, int fillchar)
+/*
+ * Maps and fills blocks until size bytes are done or the allocation fails,
+ * the last block may be partial. The memory is kept mapped. Returns the
+ * number of filled bytes.
+ */
+static size_t pollute_blocks(size_t size, int fillchar, int flags)
+{
+	static int populate = 1;
+	size_t done = 0, len;
+	void *p;
+
+	while (done < size) {
+		len = MIN(size - done, (size_t)BLOCKSIZE);
+
+		p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+			 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+		if (p == MAP_FAILED)
+			break;
+
+		if (flags & TST_POLLUTE_THP)
+			madvise(p, len, MADV_HUGEPAGE);
+
+		/*
+		 * Allocate the whole block in one call rather than taking a
+		 * page fault per page in memset(), EINVAL before v5.14.
+		 */
+		if (populate && madvise(p, len, MADV_POPULATE_WRITE)) {
+			if (errno != EINVAL) {
+				munmap(p, len);
+				break;
+			}
+			populate = 0;
+		}
+
+		memset(p, fillchar, len);
+		done += len;
+	}
+
+	return done;
+}
+
+/* Fills up to size bytes of the free hugetlb pool, the pages stay mapped */
+static size_t pollute_hugetlb(size_t size, int fillchar, void **map,
+			      size_t *map_size)
+{
+	long free_pages = 0, page_kb = 0;
+
+	*map = NULL;
+
+	FILE_LINES_SCANF("/proc/meminfo", "HugePages_Free: %ld", &free_pages);
+	FILE_LINES_SCANF("/proc/meminfo", "Hugepagesize: %ld", &page_kb);
+
+	if (free_pages <= 0 || page_kb <= 0)
+		return 0;
+
+	/* Whole huge pages only */
+	*map_size = MIN((size_t)free_pages, size / (page_kb * 1024)) *
+		    page_kb * 1024;
+	if (!*map_size)
+		return 0;
+
+	*map = mmap(NULL, *map_size, PROT_READ | PROT_WRITE,
+		    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+	if (*map == MAP_FAILED) {
+		tst_res(TINFO | TERRNO, "Cannot map %zu MB of huge pages",
+			*map_size / (1024 * 1024));
+		*map = NULL;
+		return 0;
+	}
+
+	memset(*map, fillchar, *map_size);
+
+	return *map_size;
+}
+
+/*
+ * Each worker runs in a child process pinned to one of the allowed CPUs, so
+ * the memory is allocated on the NUMA node of that CPU. The workers report
+ * the number of polluted bytes and hold the memory until all of them are
+ * done, so that the pollution covers all the requested memory at once.
+ */
+static size_t pollute_workers(size_t size, int fillchar, int flags,
+			      unsigned int *nworkers, size_t *hugetlb)
 {
-	size_t i, map_count = 0, safety = 0, blocksize = BLOCKSIZE;
+	int done_pipe[2], release_pipe[2];
+	unsigned int workers, i, cpu = 0;
+	size_t nblocks, share, assigned = 0, polluted = 0;
+	cpu_set_t allowed, set;
+	pid_t *pids;
+	char c;
+
+	if (sched_getaffinity(0, sizeof(allowed), &allowed))
+		CPU_ZERO(&allowed);
+
+	nblocks = (size + BLOCKSIZE - 1) / BLOCKSIZE;
+	workers = MAX(CPU_COUNT(&allowed), 1);
+	workers = MIN((size_t)workers, nblocks);
+	pids = SAFE_MALLOC(workers * sizeof(*pids));
+
+	SAFE_PIPE(done_pipe);
+	SAFE_PIPE(release_pipe);
+	fflush(NULL);
+
+	for (i = 0; i < workers; i++) {
+		/* Whole blocks, the remainder goes to the last worker */
+		if (i == workers - 1) {
+			share = size - assigned;
+		} else {
+			share = (nblocks / workers + (i < nblocks % workers)) *
+				(size_t)BLOCKSIZE;
+		}
+
+		assigned += share;
+
+		while (cpu < CPU_SETSIZE && CPU_COUNT(&allowed) &&
+		       !CPU_ISSET(cpu, &allowed))
+			cpu++;
+
+		pids[i] = fork();
+
+		if (pids[i] < 0)
+			tst_brk(TBROK | TERRNO, "fork()");
+
+		if (!pids[i]) {
+			close(done_pipe[0]);
+			close(release_pipe[1]);
+
+			if (cpu < CPU_SETSIZE && CPU_COUNT(&allowed)) {
+				CPU_ZERO(&set);
+				CPU_SET(cpu, &set);
+				sched_setaffinity(0, sizeof(set), &set);
+			}
+
+			share = pollute_blocks(share, fillchar, flags);
+
+			if (write(done_pipe[1], &share, sizeof(share)) !=
+			    sizeof(share))
+				_exit(1);
+
+			close(done_pipe[1]);
+
+			/* Wait until the parent closes the pipe */
+			while (read(release_pipe[0], &c, 1) < 0 && errno == EINTR)
+				;
+
+			_exit(0);
+		}
+
+		cpu++;
+	}
+
+	SAFE_CLOSE(done_pipe[1]);
+	SAFE_CLOSE(release_pipe[0]);
+
+	/* A worker killed before reporting closes its end of the pipe */
+	while (SAFE_READ(0, done_pipe[0], &share, sizeof(share)) ==
+	       sizeof(share))
+		polluted += share;
+
+	SAFE_CLOSE(done_pipe[0]);
+
+	*hugetlb = 0;
+
+	/* Keep the memory polluted while the hugetlb pages are filled */
+	if (flags & TST_POLLUTE_HUGETLB) {
+		void *map;
+		size_t map_size;
+
+		*hugetlb = pollute_hugetlb(size, fillchar, &map, &map_size);
+
+		if (map)
+			SAFE_MUNMAP(map, map_size);
+	}
+
+	SAFE_CLOSE(release_pipe[1]);
+
+	for (i = 0; i < workers; i++)
+		SAFE_WAITPID(pids[i], NULL, 0);
+
+	free(pids);
+
+	*nworkers = workers;
+
+	return polluted;
+}
+
+void tst_pollute_memory_flags(size_t maxsize, int fillchar, int flags)
+{
+	size_t safety = 0, polluted, hugetlb;
 	unsigned long long freeram;
 	size_t min_free;
-	void **map_blocks;
 	struct sysinfo info;
+	struct timespec start, end;
+	unsigned int workers;
+	long long us;
 
 	SAFE_FILE_SCANF("/proc/sys/vm/min_free_kbytes", "%zi", &min_free);
 	min_free *= 1024;
@@ -56,30 +252,28 @@ void tst_pollute_memory(size_t maxsize, int fillchar)
 	if (freeram - safety < maxsize / info.mem_unit)
 		maxsize = (freeram - safety) * info.mem_unit;
 
-	blocksize = MIN(maxsize, blocksize);
-	map_count = maxsize / blocksize;
-	map_blocks = SAFE_MALLOC(map_count * sizeof(void *));
-
 	/*
-	 * Keep allocating until the first failure. The address space may be
-	 * too fragmented or just smaller than maxsize.
+	 * The address space may be too fragmented or just smaller than
+	 * maxsize, the workers keep allocating until the first failure.
 	 */
-	for (i = 0; i < map_count; i++) {
-		map_blocks[i] = mmap(NULL, blocksize, PROT_READ | PROT_WRITE,
-			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	polluted = pollute_workers(maxsize, fillchar, flags, &workers, &hugetlb);
+	clock_gettime(CLOCK_MONOTONIC, &end);
 
-		if (map_blocks[i] == MAP_FAILED) {
-			map_count = i;
-			break;
-		}
+	us = MAX(tst_timespec_diff_us(end, start), 1LL);
 
-		memset(map_blocks[i], fillchar, blocksize);
-	}
+	tst_res(TINFO, "Polluted %zu MB with %u workers in %lli ms (%.2f GB/s)",
+		polluted / (1024 * 1024), workers, us / 1000,
+		(double)(polluted + hugetlb) / us / 1000);
 
-	for (i = 0; i < map_count; i++)
-		SAFE_MUNMAP(map_blocks[i], blocksize);
+	if (flags & TST_POLLUTE_HUGETLB)
+		tst_res(TINFO, "Polluted %zu MB of hugetlb pages",
+			hugetlb / (1024 * 1024));
+}
 
-	free(map_blocks);
+void tst_pollute_memory(size_t maxsize, int fillchar)
+{
+	tst_pollute_memory_flags(maxsize, fillchar, 0);
 }
 
 long long tst_available_mem(void)
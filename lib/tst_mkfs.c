@@ -19,6 +19,7 @@
 #include "ltp_priv.h"
 #include "tst_mkfs.h"
 #include "tst_device.h"
+#include "tst_dev_pool.h"
 
 #define OPTS_MAX 32
 
@@ -31,6 +32,7 @@ void tst_mkfs_(const char *file, const int lineno, void (cleanup_fn)(void),
 	const char *argv[OPTS_MAX] = {mkfs};
 	char fs_opts_str[1024] = "";
 	char extra_opts_str[1024] = "";
+	char fs_key[2200];
 
 	if (!dev) {
 		tst_brkm_(file, lineno, TBROK, cleanup_fn,
@@ -88,6 +90,15 @@ void tst_mkfs_(const char *file, const int lineno, void (cleanup_fn)(void),
 
 	argv[pos] = NULL;
 
+	snprintf(fs_key, sizeof(fs_key), "%s opts='%s' extra opts='%s'",
+		 fs_type, fs_opts_str, extra_opts_str);
+
+	if (!tst_dev_pool_restore_fs(dev, fs_key)) {
+		tst_resm_(file, lineno, TINFO,
+			"Restored %s with %s from pool image", dev, fs_key);
+		return;
+	}
+
 	if (tst_clear_device(dev)) {
 		tst_brkm_(file, lineno, TBROK, cleanup_fn,
 			"tst_clear_device() failed");
@@ -101,6 +112,7 @@ void tst_mkfs_(const char *file, const int lineno, void (cleanup_fn)(void),
 
 	switch (ret) {
 	case 0:
+		tst_dev_pool_save_fs(dev, fs_key);
 	break;
 	case 255:
 		tst_brkm_(file, lineno, TCONF, cleanup_fn,
@@ -5,86 +5,301 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sched.h>
+#include <signal.h>
+#include <time.h>
 
 #include "test.h"
+#include "lapi/syscalls.h"
 #include "tst_process_state.h"
 
-int tst_process_state_wait(const char *file, const int lineno,
-			   void (*cleanup_fn)(void), pid_t pid,
-			   const char state, unsigned int msec_timeout)
+/* Number of re-reads with sched_yield() in between before starting to sleep */
+#define SPIN_POLLS 64
+#define MIN_SLEEP_US 10
+#define MAX_SLEEP_US 1000
+
+struct backoff {
+	struct timespec start;
+	unsigned int polls;
+	unsigned int sleep_us;
+};
+
+static struct tst_process_wait_stats stats;
+
+static long long elapsed_us(const struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec - start->tv_sec) * 1000000LL +
+	       (now.tv_nsec - start->tv_nsec) / 1000;
+}
+
+static void backoff_init(struct backoff *b)
+{
+	clock_gettime(CLOCK_MONOTONIC, &b->start);
+	b->polls = 0;
+	b->sleep_us = MIN_SLEEP_US;
+}
+
+/*
+ * Spins for a while since the state usually changes shortly after the child
+ * has been started, then sleeps with exponentially increasing period.
+ *
+ * Returns non-zero if msec_timeout has expired.
+ */
+static int backoff_wait(struct backoff *b, unsigned int msec_timeout)
+{
+	if (msec_timeout && elapsed_us(&b->start) >= msec_timeout * 1000LL)
+		return 1;
+
+	if (b->polls++ < SPIN_POLLS) {
+		sched_yield();
+		return 0;
+	}
+
+	usleep(b->sleep_us);
+	stats.sleeps++;
+
+	b->sleep_us *= 2;
+	if (b->sleep_us > MAX_SLEEP_US)
+		b->sleep_us = MAX_SLEEP_US;
+
+	return 0;
+}
+
+static void backoff_done(struct backoff *b, int timeout)
 {
-	char proc_path[128], cur_state;
-	unsigned int msecs = 0;
+	unsigned long long us = elapsed_us(&b->start);
+
+	stats.waits++;
+	stats.timeouts += !!timeout;
+	stats.total_us += us;
+	if (us > stats.max_us)
+		stats.max_us = us;
+}
+
+static int stat_open(pid_t pid)
+{
+	char proc_path[128];
 
 	snprintf(proc_path, sizeof(proc_path), "/proc/%i/stat", pid);
 
+	return open(proc_path, O_RDONLY | O_CLOEXEC);
+}
+
+/*
+ * Re-reads the stat file opened by stat_open(). The comm may contain spaces
+ * and parentheses, the state follows the last ')'.
+ *
+ * Returns the state or -1 with errno set, ESRCH once the process is reaped.
+ */
+static int stat_state(int fd)
+{
+	char buf[512], *p;
+	ssize_t ret;
+
+	stats.polls++;
+
+	ret = pread(fd, buf, sizeof(buf) - 1, 0);
+	if (ret < 0)
+		return -1;
+
+	buf[ret] = 0;
+	p = strrchr(buf, ')');
+
+	if (!p || p[1] != ' ' || !p[2]) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	return p[2];
+}
+
+static int state_wait(pid_t *pids, int *fds, unsigned int npids,
+		      const char state, unsigned int msec_timeout)
+{
+	unsigned int i, done = 0;
+	struct backoff b;
+	int cur_state;
+
+	for (i = 0; i < npids; i++) {
+		fds[i] = stat_open(pids[i]);
+		if (fds[i] < 0) {
+			if (errno == ENOENT)
+				errno = ESRCH;
+			goto err;
+		}
+	}
+
+	backoff_init(&b);
+
 	for (;;) {
-		safe_file_scanf(file, lineno, cleanup_fn, proc_path,
-				"%*i %*s %c", &cur_state);
+		/* pids which have already reached the state are not re-read */
+		for (; done < npids; done++) {
+			cur_state = stat_state(fds[done]);
 
-		if (state == cur_state)
-			break;
+			if (cur_state < 0)
+				goto err;
 
-		usleep(1000);
-		msecs += 1;
+			if (cur_state != state)
+				break;
+		}
 
-		if (msec_timeout && msecs >= msec_timeout) {
+		if (done == npids)
+			break;
+
+		if (backoff_wait(&b, msec_timeout)) {
+			backoff_done(&b, 1);
 			errno = ETIMEDOUT;
-			return -1;
+			goto err;
 		}
 	}
 
+	backoff_done(&b, 0);
+
+	for (i = 0; i < npids; i++)
+		close(fds[i]);
+
 	return 0;
+err:
+	/* close() may clobber errno */
+	cur_state = errno;
+
+	for (i = 0; i < npids && fds[i] >= 0; i++)
+		close(fds[i]);
+
+	errno = cur_state;
+
+	return -1;
+}
+
+int tst_process_state_wait_many(const pid_t *pids, unsigned int npids,
+				const char state, unsigned int msec_timeout)
+{
+	pid_t *p;
+	int *fds, ret;
+
+	p = malloc(npids * (sizeof(*p) + sizeof(*fds)));
+	if (!p)
+		return -1;
+
+	fds = (int *)(p + npids);
+	memcpy(p, pids, npids * sizeof(*p));
+	memset(fds, -1, npids * sizeof(*fds));
+
+	ret = state_wait(p, fds, npids, state, msec_timeout);
+
+	free(p);
+
+	return ret;
+}
+
+int tst_process_state_wait(const char *file, const int lineno,
+			   void (*cleanup_fn)(void), pid_t pid,
+			   const char state, unsigned int msec_timeout)
+{
+	int fd = -1;
+
+	if (!state_wait(&pid, &fd, 1, state, msec_timeout))
+		return 0;
+
+	if (errno != ETIMEDOUT) {
+		tst_brkm_(file, lineno, TBROK | TERRNO, cleanup_fn,
+			  "Failed to read /proc/%i/stat", pid);
+	}
+
+	return -1;
 }
 
 int tst_process_state_wait2(pid_t pid, const char state)
 {
-	char proc_path[128], cur_state;
+	int fd = -1;
 
-	snprintf(proc_path, sizeof(proc_path), "/proc/%i/stat", pid);
+	if (!state_wait(&pid, &fd, 1, state, 0))
+		return 0;
 
-	for (;;) {
-		FILE *f = fopen(proc_path, "r");
+	fprintf(stderr, "Failed to read '/proc/%i/stat': %s\n",
+		pid, strerror(errno));
 
-		if (!f) {
-			fprintf(stderr, "Failed to open '%s': %s\n",
-				proc_path, strerror(errno));
-			return 1;
-		}
+	return 1;
+}
+
+/*
+ * The pidfd becomes readable once the process exits, which is a good moment
+ * to start polling for the pid to disappear. Returns the pidfd or -1 if
+ * pidfd_open() is not supported or the process does not exist.
+ */
+static int pidfd_wait(pid_t pid, struct backoff *b, unsigned int msec_timeout)
+{
+	struct pollfd pfd;
+	long long left;
+	int ret;
 
-		if (fscanf(f, "%*i %*s %c", &cur_state) != 1) {
-			fclose(f);
-			fprintf(stderr, "Failed to read '%s': %s\n",
-				proc_path, strerror(errno));
-			return 1;
+	pfd.fd = syscall(__NR_pidfd_open, pid, 0);
+	if (pfd.fd < 0)
+		return -1;
+
+	pfd.events = POLLIN;
+
+	do {
+		left = -1;
+		if (msec_timeout) {
+			left = msec_timeout - elapsed_us(&b->start) / 1000;
+			if (left < 0)
+				left = 0;
 		}
-		fclose(f);
 
-		if (state == cur_state)
-			return 0;
+		ret = poll(&pfd, 1, left);
+	} while (ret < 0 && errno == EINTR);
 
-		usleep(10000);
-	}
+	return pfd.fd;
 }
 
 int tst_process_exit_wait(pid_t pid, unsigned int msec_timeout)
 {
-	unsigned int msecs = 0;
+	struct backoff b;
+	int pidfd;
+
+	backoff_init(&b);
+
+	pidfd = pidfd_wait(pid, &b, msec_timeout);
 
 	for (;;) {
 		if (kill(pid, 0) && errno == ESRCH)
 			break;
 
-		usleep(1000);
-		msecs += 1;
+		if (backoff_wait(&b, msec_timeout)) {
+			backoff_done(&b, 1);
+
+			if (pidfd >= 0)
+				close(pidfd);
 
-		if (msec_timeout && msecs >= msec_timeout) {
 			errno = ETIMEDOUT;
 			return 0;
 		}
 	}
 
+	backoff_done(&b, 0);
+
+	if (pidfd >= 0)
+		close(pidfd);
+
 	return 1;
 }
+
+void tst_process_wait_stats_get(struct tst_process_wait_stats *s)
+{
+	*s = stats;
+}
+
+void tst_process_wait_stats_reset(void)
+{
+	memset(&stats, 0, sizeof(stats));
+}
@@ -1,5 +1,8 @@
 // SPDX-License-Identifier: GPL-2.0-or-later
 
+#include <string.h>
+
+#include "tst_minmax.h"
 #include "tst_rand_data.h"
 
 const size_t tst_rand_data_len = 4096;
@@ -209,3 +212,77 @@ const char *const tst_rand_data =
 "\x8f\x8e\xe5\xa7\xc3\x26\x50\xf2\x76\xcd\xbc\x7d\x15\x42\x1f\x7a\x4c\x22\xce\x49"
 "\x5b\xb9\xc4\xe1\xb0\xfa\xfa\x9f\x4c\xd7\x99\x19\x6b\xc9\xde\x32\x05\x27\x19\x33"
 "\xf9\x47\x49\x2a\xf0\x29\x7d\x98\xb1\xf7\x81\x78\x36\x9a\x9b";
+
+/*
+ * SplitMix64 finalizer applied to a counter. Every 64-bit word of the stream
+ * is computed independently from its index, so any part of the stream can be
+ * generated without generating the preceding data and the loops below
+ * vectorize.
+ */
+static inline uint64_t mix64(uint64_t z)
+{
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+
+	return z ^ (z >> 31);
+}
+
+static inline uint64_t stream_word(uint64_t key, uint64_t idx)
+{
+	return mix64(key + idx * 0x9e3779b97f4a7c15ULL);
+}
+
+static inline void store_le64(unsigned char *p, uint64_t v)
+{
+	int i;
+
+	for (i = 0; i < 8; i++)
+		p[i] = v >> (8 * i);
+}
+
+void tst_rand_data_fill(uint64_t seed, uint64_t off, void *buf, size_t len)
+{
+	const uint64_t key = mix64(seed ^ 0x6a09e667f3bcc908ULL);
+	unsigned char *p = buf, tmp[8];
+	uint64_t idx = off / 8;
+	size_t skip = off % 8, n;
+
+	if (skip && len) {
+		store_le64(tmp, stream_word(key, idx++));
+		n = MIN(8 - skip, len);
+		memcpy(p, tmp + skip, n);
+		p += n;
+		len -= n;
+	}
+
+	for (; len >= 8; len -= 8, p += 8)
+		store_le64(p, stream_word(key, idx++));
+
+	if (len) {
+		store_le64(tmp, stream_word(key, idx));
+		memcpy(p, tmp, len);
+	}
+}
+
+ssize_t tst_rand_data_verify(uint64_t seed, uint64_t off, const void *buf,
+			     size_t len)
+{
+	const unsigned char *p = buf;
+	unsigned char exp[4096];
+	size_t pos = 0, n, i;
+
+	while (pos < len) {
+		n = MIN(len - pos, sizeof(exp));
+		tst_rand_data_fill(seed, off + pos, exp, n);
+
+		if (memcmp(exp, p + pos, n)) {
+			for (i = 0; exp[i] == p[pos + i]; i++)
+				;
+			return pos + i;
+		}
+
+		pos += n;
+	}
+
+	return -1;
+}
@@ -54,6 +54,8 @@ static const char *tid;
 static int iterations = 1;
 static float duration = -1;
 static float timeout_mul = -1;
+static int fork_server;
+static int fork_server_child;
 static pid_t main_pid, lib_pid;
 static int mntpoint_mounted;
 static int ovl_mounted;
@@ -149,6 +151,111 @@ static void cleanup_ipc(void)
 	}
 }
 
+/*
+ * Optional JSON lines result stream, see LTP_RESULTS_JSON in
+ * doc/user-guide.txt. Records are written with a single write() to an
+ * O_APPEND file so that records from different test processes do not mix.
+ */
+static int json_fd = -1;
+static int cur_tcase = -1;
+static unsigned int cur_iteration;
+
+static void json_open(void)
+{
+	const char *path = getenv("LTP_RESULTS_JSON");
+
+	if (!path || !path[0] || json_fd >= 0)
+		return;
+
+	json_fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+	if (json_fd < 0)
+		tst_brk(TBROK | TERRNO, "open(%s)", path);
+}
+
+static size_t json_escape(char *dst, size_t size, const char *src, size_t len)
+{
+	size_t i, pos = 0;
+
+	for (i = 0; i < len && pos + 7 < size; i++) {
+		unsigned char c = src[i];
+
+		switch (c) {
+		case '"':
+		case '\\':
+			dst[pos++] = '\\';
+			dst[pos++] = c;
+		break;
+		case '\n':
+			dst[pos++] = '\\';
+			dst[pos++] = 'n';
+		break;
+		case '\t':
+			dst[pos++] = '\\';
+			dst[pos++] = 't';
+		break;
+		default:
+			if (c < 0x20)
+				pos += sprintf(dst + pos, "\\u%04x", c);
+			else
+				dst[pos++] = c;
+		}
+	}
+
+	dst[pos] = 0;
+
+	return pos;
+}
+
+/* Called from print_result() which may run in a signal handler */
+static void json_record(const char *fmt, ...)
+{
+	char buf[2048];
+	struct timespec ts = {};
+	const char *fs = tst_device ? tst_device->fs_type : NULL;
+	va_list va;
+	int len, ret;
+
+	if (json_fd < 0)
+		return;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	len = snprintf(buf, sizeof(buf),
+		"{\"ts_us\":%lld,\"pid\":%i,\"variant\":%u,\"tcase\":%i,\"iteration\":%u,\"fs\":\"%s\",",
+		tst_timespec_to_us(ts), getpid(), tst_variant, cur_tcase,
+		cur_iteration, fs ? fs : "");
+
+	va_start(va, fmt);
+	ret = vsnprintf(buf + len, sizeof(buf) - len - 2, fmt, va);
+	va_end(va);
+
+	len += MIN(ret, (int)sizeof(buf) - len - 3);
+	buf[len++] = '}';
+	buf[len++] = '\n';
+
+	if (write(json_fd, buf, len) != len) {
+		/* Nothing sane to do here, stderr output is still complete */
+	}
+}
+
+static void json_result(const char *file, const int lineno, const char *res,
+			const char *msg, size_t msg_len)
+{
+	char esc[1536];
+
+	if (json_fd < 0)
+		return;
+
+	json_escape(esc, sizeof(esc), msg, msg_len);
+	json_record("\"file\":\"%s\",\"line\":%i,\"type\":\"%s\",\"msg\":\"%s\"",
+		    file, lineno, res, esc);
+}
+
+static void json_duration(const char *event, unsigned long long us)
+{
+	json_record("\"event\":\"%s\",\"duration_us\":%llu", event, us);
+}
+
 void tst_reinit(void)
 {
 	const char *path = getenv(IPC_ENV_VAR);
@@ -168,6 +275,8 @@ void tst_reinit(void)
 	tst_max_futexes = (size - sizeof(struct results))/sizeof(futex_t);
 
 	SAFE_CLOSE(fd);
+
+	json_open();
 }
 
 static void update_results(int ttype)
@@ -198,7 +307,7 @@ static void print_result(const char *file, const int lineno, int ttype,
 			 const char *fmt, va_list va)
 {
 	char buf[1024];
-	char *str = buf;
+	char *str = buf, *msg;
 	int ret, size = sizeof(buf), ssize, int_errno, buflen;
 	const char *str_errno = NULL;
 	const char *res;
@@ -253,6 +362,7 @@ static void print_result(const char *file, const int lineno, int ttype,
 		ret = snprintf(str, size, "%s: ", res);
 	str += ret;
 	size -= ret;
+	msg = str;
 
 	ssize = size - 2;
 	ret = vsnprintf(str, size, fmt, va);
@@ -271,6 +381,8 @@ static void print_result(const char *file, const int lineno, int ttype,
 				"Next message is too long and truncated:");
 	}
 
+	json_result(file, lineno, res, msg, str - msg);
+
 	snprintf(str, size, "\n");
 
 	/* we might be called from signal handler, so use write() */
@@ -336,7 +448,7 @@ void tst_vbrk_(const char *file, const int lineno, int ttype, const char *fmt,
 	 * specified but CLONE_THREAD is not. Use direct syscall to avoid
 	 * cleanup running in the child.
 	 */
-	if (tst_getpid() == main_pid)
+	if (tst_getpid() == main_pid && !fork_server_child)
 		do_test_cleanup();
 
 	if (getpid() == lib_pid)
@@ -523,9 +635,13 @@ static void print_help(void)
 	fprintf(stderr, "KCONFIG_PATH         Specify kernel config file\n");
 	fprintf(stderr, "KCONFIG_SKIP_CHECK   Skip kernel config check if variable set (not set by default)\n");
 	fprintf(stderr, "LTPROOT              Prefix for installed LTP (default: /opt/ltp)\n");
+	fprintf(stderr, "LTP_CLOCK_CYCLES     Use calibrated CPU cycle counter for fuzzy sync and timer measurements if set to 1\n");
 	fprintf(stderr, "LTP_COLORIZE_OUTPUT  Force colorized output behaviour (y/1 always, n/0: never)\n");
 	fprintf(stderr, "LTP_DEV              Path to the block device to be used (for .needs_device)\n");
 	fprintf(stderr, "LTP_DEV_FS_TYPE      Filesystem used for testing (default: %s)\n", DEFAULT_FS_TYPE);
+	fprintf(stderr, "LTP_DEV_POOL         Directory with persistent loop devices and cached filesystem images\n");
+	fprintf(stderr, "LTP_FORK_SERVER      Run each iteration in a child forked after setup() if set to 1\n");
+	fprintf(stderr, "LTP_RESULTS_JSON     Append JSON lines with results and test case/iteration durations to a file\n");
 	fprintf(stderr, "LTP_SINGLE_FS_TYPE   Testing only - specifies filesystem instead all supported (for .all_filesystems)\n");
 	fprintf(stderr, "LTP_TIMEOUT_MUL      Timeout multiplier (must be a number >=1)\n");
 	fprintf(stderr, "LTP_RUNTIME_MUL      Runtime multiplier (must be a number >=1)\n");
@@ -1145,6 +1261,11 @@ static void do_setup(int argc, char *argv[])
 
 	parse_opts(argc, argv);
 
+	json_open();
+
+	fork_server = getenv("LTP_FORK_SERVER") &&
+		      !strcmp(getenv("LTP_FORK_SERVER"), "1");
+
 	if (tst_test->needs_kconfigs && tst_kconfig_check(tst_test->needs_kconfigs))
 		tst_brk(TCONF, "Aborting due to unsuitable kernel config, see above!");
 
@@ -1372,16 +1493,24 @@ static void heartbeat(void)
 		exit(TBROK);
 	}
 
-	kill(getppid(), SIGUSR1);
+	/* The parent is the forkserver process in LTP_FORK_SERVER mode */
+	kill(fork_server ? lib_pid : getppid(), SIGUSR1);
 }
 
+static unsigned long long get_time_us(void);
+
 static void run_tests(void)
 {
 	unsigned int i;
+	unsigned long long tcase_start_us = 0;
 	struct results saved_results;
 
 	if (!tst_test->test) {
 		saved_results = *results;
+		/* test_all() is recorded as the only test case */
+		cur_tcase = 0;
+		if (json_fd >= 0)
+			tcase_start_us = get_time_us();
 		heartbeat();
 		tst_test->test_all();
 
@@ -1390,6 +1519,11 @@ static void run_tests(void)
 
 		tst_reap_children();
 
+		if (json_fd >= 0)
+			json_duration("tcase", get_time_us() - tcase_start_us);
+
+		cur_tcase = -1;
+
 		if (results_equal(&saved_results, results))
 			tst_brk(TBROK, "Test haven't reported results!");
 		return;
@@ -1397,6 +1531,9 @@ static void run_tests(void)
 
 	for (i = 0; i < tst_test->tcnt; i++) {
 		saved_results = *results;
+		cur_tcase = i;
+		if (json_fd >= 0)
+			tcase_start_us = get_time_us();
 		heartbeat();
 		tst_test->test(i);
 
@@ -1405,9 +1542,14 @@ static void run_tests(void)
 
 		tst_reap_children();
 
+		if (json_fd >= 0)
+			json_duration("tcase", get_time_us() - tcase_start_us);
+
 		if (results_equal(&saved_results, results))
 			tst_brk(TBROK, "Test %i haven't reported results!", i);
 	}
+
+	cur_tcase = -1;
 }
 
 static unsigned long long get_time_ms(void)
@@ -1420,6 +1562,90 @@ static unsigned long long get_time_ms(void)
 	return tst_timespec_to_ms(ts);
 }
 
+static unsigned long long get_time_us(void)
+{
+	struct timespec ts;
+
+	if (tst_clock_gettime(CLOCK_MONOTONIC, &ts))
+		tst_brk(TBROK | TERRNO, "tst_clock_gettime()");
+
+	return tst_timespec_to_us(ts);
+}
+
+struct phase_stats {
+	unsigned long long setup_us;
+	unsigned long long cleanup_us;
+	unsigned long long test_min_us;
+	unsigned long long test_max_us;
+	unsigned long long test_sum_us;
+	unsigned long long iterations;
+};
+
+static void phase_stats_add(struct phase_stats *stats, unsigned long long us)
+{
+	if (!stats->iterations || us < stats->test_min_us)
+		stats->test_min_us = us;
+
+	if (us > stats->test_max_us)
+		stats->test_max_us = us;
+
+	stats->test_sum_us += us;
+	stats->iterations++;
+}
+
+static void phase_stats_print(struct phase_stats *stats)
+{
+	unsigned long long avg = 0, rate = 0;
+
+	if (stats->iterations)
+		avg = stats->test_sum_us / stats->iterations;
+
+	if (stats->test_sum_us)
+		rate = stats->iterations * 1000000 / stats->test_sum_us;
+
+	tst_res(TINFO, "Forkserver phases: setup %lluus, cleanup %lluus",
+		stats->setup_us, stats->cleanup_us);
+	tst_res(TINFO, "Forkserver %llu iterations: min %lluus avg %lluus max %lluus (%llu/s)",
+		stats->iterations, stats->test_min_us, avg,
+		stats->test_max_us, rate);
+}
+
+/*
+ * Runs one iteration in a child forked from the already set up test process,
+ * which keeps the pristine post setup() state for the next iteration.
+ */
+static void run_tests_forked(void)
+{
+	pid_t pid;
+	int status;
+
+	tst_flush();
+
+	pid = fork();
+	if (pid < 0)
+		tst_brk(TBROK | TERRNO, "fork()");
+
+	if (!pid) {
+		/* cleanup() is left to the forkserver */
+		fork_server_child = 1;
+		main_pid = getpid();
+		run_tests();
+		exit(0);
+	}
+
+	SAFE_WAITPID(pid, &status, 0);
+
+	if (WIFSIGNALED(status)) {
+		tst_brk(TBROK, "Test iteration killed by %s!",
+			tst_strsig(WTERMSIG(status)));
+	}
+
+	if (WIFEXITED(status) && WEXITSTATUS(status)) {
+		do_test_cleanup();
+		exit(WEXITSTATUS(status));
+	}
+}
+
 static void add_paths(void)
 {
 	char *old_path = getenv("PATH");
@@ -1440,13 +1666,22 @@ static void add_paths(void)
 static void testrun(void)
 {
 	unsigned int i = 0;
-	unsigned long long stop_time = 0;
+	unsigned long long stop_time = 0, start_us = 0, iter_us;
+	struct phase_stats stats = {};
+	int timed = fork_server || json_fd >= 0;
 	int cont = 1;
 
 	heartbeat();
 	add_paths();
+
+	if (fork_server)
+		start_us = get_time_us();
+
 	do_test_setup();
 
+	if (fork_server)
+		stats.setup_us = get_time_us() - start_us;
+
 	if (duration > 0)
 		stop_time = get_time_ms() + (unsigned long long)(duration * 1000);
 
@@ -1464,11 +1699,38 @@ static void testrun(void)
 		if (!cont)
 			break;
 
-		run_tests();
+		if (timed)
+			start_us = get_time_us();
+
+		cur_iteration++;
+
+		if (fork_server)
+			run_tests_forked();
+		else
+			run_tests();
+
+		if (timed) {
+			iter_us = get_time_us() - start_us;
+
+			if (fork_server)
+				phase_stats_add(&stats, iter_us);
+
+			json_duration("iteration", iter_us);
+		}
+
 		heartbeat();
 	}
 
+	if (fork_server)
+		start_us = get_time_us();
+
 	do_test_cleanup();
+
+	if (fork_server) {
+		stats.cleanup_us = get_time_us() - start_us;
+		phase_stats_print(&stats);
+	}
+
 	exit(0);
 }
 
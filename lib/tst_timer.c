@@ -10,11 +10,27 @@
 #include "tst_test.h"
 #include "tst_timer.h"
 #include "tst_clocks.h"
+#include "tst_cycles.h"
 #include "lapi/posix_clocks.h"
 
 static struct timespec start_time, stop_time;
 static clockid_t clock_id;
 
+/*
+ * The cycle counter is calibrated against CLOCK_MONOTONIC_RAW, so it stands in
+ * for that clock only. CLOCK_MONOTONIC is NTP adjusted and tests compare it
+ * with the kernel timers, e.g. to detect early wakeups.
+ */
+static int timer_clock_gettime(struct timespec *ts)
+{
+	if (clock_id == CLOCK_MONOTONIC_RAW && tst_cycles_enabled()) {
+		tst_cycles_gettime(ts);
+		return 0;
+	}
+
+	return tst_clock_gettime(clock_id, ts);
+}
+
 void tst_timer_check(clockid_t clk_id)
 {
 	if (tst_clock_gettime(clk_id, &start_time)) {
@@ -33,7 +49,7 @@ void tst_timer_start(clockid_t clk_id)
 {
 	clock_id = clk_id;
 
-	if (tst_clock_gettime(clock_id, &start_time))
+	if (timer_clock_gettime(&start_time))
 		tst_res(TWARN | TERRNO, "tst_clock_gettime() failed");
 }
 
@@ -41,7 +57,7 @@ int tst_timer_expired_ms(long long ms)
 {
 	struct timespec cur_time;
 
-	if (tst_clock_gettime(clock_id, &cur_time))
+	if (timer_clock_gettime(&cur_time))
 		tst_res(TWARN | TERRNO, "tst_clock_gettime() failed");
 
 	return tst_timespec_diff_ms(cur_time, start_time) >= ms;
@@ -49,7 +65,7 @@ int tst_timer_expired_ms(long long ms)
 
 void tst_timer_stop(void)
 {
-	if (tst_clock_gettime(clock_id, &stop_time))
+	if (timer_clock_gettime(&stop_time))
 		tst_res(TWARN | TERRNO, "tst_clock_gettime() failed");
 }
 
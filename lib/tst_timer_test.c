@@ -12,8 +12,16 @@
 #define TST_NO_DEFAULT_MAIN
 #include "tst_test.h"
 #include "tst_clocks.h"
+#include "tst_histogram.h"
 #include "tst_timer_test.h"
 
+/*
+ * Samples are in us, values up to ~19 hours are bucketed with precision
+ * better than 0.1%, exact min and max are kept for anything larger.
+ */
+#define HIST_MAX_US (1LL << 36)
+#define HIST_SUB_BITS 10
+
 #define MAX_SAMPLES 500
 
 static const char *scall;
@@ -22,6 +30,7 @@ static void (*cleanup)(void);
 static int (*sample)(int clk_id, long long usec);
 static struct tst_test *test;
 
+static struct tst_histogram hist;
 static long long *samples;
 static unsigned int cur_sample;
 static unsigned int monotonic_resolution;
@@ -30,6 +39,7 @@ static int virt_env;
 
 static char *print_frequency_plot;
 static char *file_name;
+static char *hist_file_name;
 static char *str_sleep_time;
 static char *str_sample_cnt;
 static int sleep_time = -1;
@@ -80,8 +90,8 @@ static void frequency_plot(void)
 	unsigned int cols = 80;
 	unsigned int rows = 20;
 	unsigned int i, buckets[rows];
-	long long max_sample = samples[0];
-	long long min_sample = samples[cur_sample-1];
+	long long max_sample = hist.max;
+	long long min_sample = hist.min;
 	unsigned int line_header_len = header_len(max_sample);
 	unsigned int plot_line_len = cols - line_header_len;
 	unsigned int bucket_size;
@@ -95,10 +105,15 @@ static void frequency_plot(void)
 	 */
 	bucket_size = MAX(1u, ceilu(1.00 * (max_sample - min_sample)/(rows-1)));
 
-	for (i = 0; i < cur_sample; i++) {
+	for (i = 0; i < hist.nbuckets; i++) {
 		unsigned int bucket;
-		bucket = flooru(1.00 * (samples[i] - min_sample)/bucket_size);
-		buckets[bucket]++;
+
+		if (!hist.counts[i])
+			continue;
+
+		bucket = flooru(1.00 * (tst_histogram_bucket_value(&hist, i)
+					- min_sample)/bucket_size);
+		buckets[bucket] += hist.counts[i];
 	}
 
 	unsigned int max_bucket = buckets[0];
@@ -153,7 +168,12 @@ static void frequency_plot(void)
 
 void tst_timer_sample(void)
 {
-	samples[cur_sample++] = tst_timer_elapsed_us();
+	long long us = tst_timer_elapsed_us();
+
+	tst_histogram_record(&hist, us);
+
+	if (samples)
+		samples[cur_sample++] = us;
 }
 
 static int cmp(const void *a, const void *b)
@@ -213,6 +233,8 @@ static void write_to_file(void)
 	if (!file_name)
 		return;
 
+	qsort(samples, cur_sample, sizeof(samples[0]), cmp);
+
 	f = fopen(file_name, "w");
 
 	if (!f) {
@@ -230,6 +252,32 @@ static void write_to_file(void)
 	}
 }
 
+static void write_hist_to_file(void)
+{
+	FILE *f;
+
+	if (!hist_file_name)
+		return;
+
+	f = fopen(hist_file_name, "w");
+
+	if (!f) {
+		tst_res(TWARN | TERRNO,
+			"Failed to open '%s'", hist_file_name);
+		return;
+	}
+
+	if (tst_histogram_write_csv(&hist, f)) {
+		tst_res(TWARN | TERRNO,
+			"Failed to write file '%s'", hist_file_name);
+	}
+
+	if (fclose(f)) {
+		tst_res(TWARN | TERRNO,
+			"Failed to close file '%s'", hist_file_name);
+	}
+}
+
 
 /*
  * Timer testing function.
@@ -239,7 +287,7 @@ static void write_to_file(void)
  * * Take nsamples measurements of the timer function, the function
  *   to be sampled is defined in the the actual test.
  *
- * * We sort the array of samples, then:
+ * * The samples are recorded into a histogram, then:
  *
  *   - look for outliners which are samples where the sleep time has exceeded
  *     requested sleep time by an order of magnitude and, at the same time, are
@@ -250,61 +298,84 @@ static void write_to_file(void)
  *
  *   - then we compute truncated mean and compare that with the requested sleep
  *     time increased by a threshold
+ *
+ * The histogram buckets are exact up to 1ms and within 0.1% above that, the
+ * minimum and the sum of the samples are exact.
  */
 void do_timer_test(long long usec, unsigned int nsamples)
 {
-	long long trunc_mean, median;
+	long long trunc_mean, median, removed;
+	long long outliner_limit, outliner_min = 0, early_max = 0;
 	unsigned int discard = compute_discard(nsamples);
 	unsigned int keep_samples = nsamples - discard;
 	long long threshold = compute_threshold(usec, keep_samples);
-	int i;
+	unsigned int i, cnt, left;
 	int failed = 0;
 
 	tst_res(TINFO,
 		"%s sleeping for %llius %u iterations, threshold %.2fus",
 		scall, usec, nsamples, 1.00 * threshold / (keep_samples));
 
+	tst_histogram_reset(&hist);
 	cur_sample = 0;
-	for (i = 0; i < (int)nsamples; i++) {
+	for (i = 0; i < nsamples; i++) {
 		if (sample(CLOCK_MONOTONIC, usec)) {
 			tst_res(TINFO, "sampling function failed, exiting");
 			return;
 		}
 	}
 
-	qsort(samples, nsamples, sizeof(samples[0]), cmp);
-
 	write_to_file();
+	write_hist_to_file();
 
-	for (i = 0; samples[i] > 10 * usec && i < (int)nsamples; i++) {
-		if (samples[i] <= 3 * monotonic_resolution)
+	outliner_limit = MAX(10 * usec, 3LL * monotonic_resolution);
+
+	for (i = hist.nbuckets, cnt = 0; i-- > 0;) {
+		if (tst_histogram_bucket_lo(&hist, i) <= outliner_limit)
 			break;
+
+		if (hist.counts[i]) {
+			cnt += hist.counts[i];
+			outliner_min = tst_histogram_bucket_value(&hist, i);
+		}
 	}
 
-	if (i > 0) {
-		tst_res(TINFO, "Found %i outliners in [%lli,%lli] range",
-			i, samples[0], samples[i-1]);
+	if (cnt) {
+		tst_res(TINFO, "Found %u outliners in [%lli,%lli] range",
+			cnt, hist.max, outliner_min);
 	}
 
-	for (i = nsamples - 1; samples[i] < usec && i > -1; i--);
+	if (hist.min < usec) {
+		for (i = 0, cnt = 0; i < hist.nbuckets &&
+		     tst_histogram_bucket_lo(&hist, i) < usec; i++) {
+			if (hist.counts[i]) {
+				cnt += hist.counts[i];
+				early_max = MIN(tst_histogram_bucket_hi(&hist, i),
+						usec - 1);
+			}
+		}
 
-	if (i < (int)nsamples - 1) {
 		tst_res(TFAIL, "%s woken up early %u times range: [%lli,%lli]",
-			scall, nsamples - 1 - i,
-			samples[i+1], samples[nsamples-1]);
+			scall, cnt, early_max, hist.min);
 		failed = 1;
 	}
 
-	median = samples[nsamples/2];
+	median = tst_histogram_percentile(&hist, 50);
 
-	trunc_mean = 0;
+	removed = 0;
+	left = discard;
 
-	for (i = discard; i < (int)nsamples; i++)
-		trunc_mean += samples[i];
+	for (i = hist.nbuckets; left && i-- > 0;) {
+		cnt = MIN((unsigned int)hist.counts[i], left);
+		removed += cnt * tst_histogram_bucket_value(&hist, i);
+		left -= cnt;
+	}
+
+	trunc_mean = hist.sum - removed;
 
 	tst_res(TINFO,
 		"min %llius, max %llius, median %llius, trunc mean %.2fus (discarded %u)",
-		samples[nsamples-1], samples[0], median,
+		hist.min, hist.max, median,
 		1.00 * trunc_mean / keep_samples, discard);
 
 	if (virt_env) {
@@ -374,13 +445,21 @@ static void timer_setup(void)
 #endif /* PR_GET_TIMERSLACK */
 	parse_timer_opts();
 
-	samples = SAFE_MALLOC(sizeof(long long) * MAX(MAX_SAMPLES, sample_cnt));
+	if (tst_histogram_init(&hist, HIST_MAX_US, HIST_SUB_BITS))
+		tst_brk(TBROK | TERRNO, "tst_histogram_init()");
+
+	if (file_name) {
+		samples = SAFE_MALLOC(sizeof(long long) *
+				      MAX(MAX_SAMPLES, sample_cnt));
+	}
+
 	if (set_latency() < 0)
 		tst_res(TINFO, "Failed to set zero latency constraint: %m");
 }
 
 static void timer_cleanup(void)
 {
+	tst_histogram_free(&hist);
 	free(samples);
 
 	if (cleanup)
@@ -415,6 +494,7 @@ static struct tst_option options[] = {
 	{"s:", &str_sleep_time, "-s us    Sleep time"},
 	{"n:", &str_sample_cnt, "-n uint  Number of samples to take"},
 	{"f:", &file_name, "-f fname Write measured samples into a file"},
+	{"F:", &hist_file_name, "-F fname Write histogram of measured samples into a CSV file"},
 	{NULL, NULL, NULL}
 };
 
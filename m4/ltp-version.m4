@@ -0,0 +1 @@
+20230516])
@@ -28,8 +28,20 @@ struct data_node_array {
 struct data_hash_elem {
 	struct data_node *node;
 	char *id;
+	unsigned int hash;
 };
 
+#define MAX_ELEMS 100
+
+/* Power of two larger than MAX_ELEMS, keeps the open addressing index sparse */
+#define HASH_SLOTS 256
+
+/*
+ * The elements are kept in insertion order for the JSON output, the lookup
+ * goes through an open addressing index allocated right after the elems[]
+ * array. The index holds elems[] positions plus one, zero marks an empty
+ * slot.
+ */
 struct data_node_hash {
 	enum data_type type;
 	unsigned int elems_len;
@@ -37,6 +49,8 @@ struct data_node_hash {
 	struct data_hash_elem elems[];
 };
 
+#define DATA_HASH_INDEX(hash) ((unsigned char *)&(hash)->elems[(hash)->elems_len])
+
 struct data_node_string {
 	enum data_type type;
 	char val[];
@@ -76,7 +90,13 @@ static inline const char* data_type_name(enum data_type type)
 static inline struct data_node *data_node_string(const char *string)
 {
 	size_t size = sizeof(struct data_node_string) + strlen(string) + 1;
-	struct data_node *node = malloc(size);
+	struct data_node *node;
+
+	/* the node is accessed through the union, allocate at least its size */
+	if (size < sizeof(struct data_node))
+		size = sizeof(struct data_node);
+
+	node = malloc(size);
 
 	if (!node)
 		return NULL;
@@ -100,12 +120,50 @@ static inline struct data_node *data_node_int(long i)
 	return node;
 }
 
-#define MAX_ELEMS 100
+static inline unsigned int data_hash_str(const char *str)
+{
+	unsigned int hash = 2166136261u;
+
+	while (*str) {
+		hash ^= (unsigned char)*str++;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static inline void data_hash_index_add(struct data_node_hash *hash, unsigned int i)
+{
+	unsigned char *index = DATA_HASH_INDEX(hash);
+	unsigned int slot = hash->elems[i].hash;
+
+	while (index[slot % HASH_SLOTS])
+		slot++;
+
+	index[slot % HASH_SLOTS] = i + 1;
+}
+
+/* Returns position in elems[] or -1 */
+static inline int data_hash_index_find(struct data_node_hash *hash, const char *id)
+{
+	unsigned char *index = DATA_HASH_INDEX(hash);
+	unsigned int h = data_hash_str(id);
+	unsigned int slot, i;
+
+	for (slot = h; (i = index[slot % HASH_SLOTS]); slot++) {
+		struct data_hash_elem *elem = &hash->elems[i - 1];
+
+		if (elem->hash == h && !strcmp(elem->id, id))
+			return i - 1;
+	}
+
+	return -1;
+}
 
 static inline struct data_node *data_node_hash(void)
 {
 	size_t size = sizeof(struct data_node_hash)
-	              + MAX_ELEMS * sizeof(struct data_hash_elem);
+	              + MAX_ELEMS * sizeof(struct data_hash_elem) + HASH_SLOTS;
 	struct data_node *node = malloc(size);
 
 	if (!node)
@@ -114,6 +172,7 @@ static inline struct data_node *data_node_hash(void)
 	node->type = DATA_HASH;
 	node->hash.elems_len = MAX_ELEMS;
 	node->hash.elems_used = 0;
+	memset(DATA_HASH_INDEX(&node->hash), 0, HASH_SLOTS);
 
 	return node;
 }
@@ -144,10 +203,13 @@ static inline int data_node_hash_add(struct data_node *self, const char *id, str
 	if (hash->elems_used == hash->elems_len)
 		return 1;
 
-	struct data_hash_elem *elem = &hash->elems[hash->elems_used++];
+	struct data_hash_elem *elem = &hash->elems[hash->elems_used];
 
 	elem->node = payload;
 	elem->id = strdup(id);
+	elem->hash = data_hash_str(id);
+
+	data_hash_index_add(hash, hash->elems_used++);
 
 	return 0;
 }
@@ -177,15 +239,11 @@ static inline void data_node_free(struct data_node *self)
 
 static inline int data_node_hash_del(struct data_node *self, const char *id)
 {
-	unsigned int i;
+	unsigned int j;
 	struct data_node_hash *hash = &self->hash;
+	int i = data_hash_index_find(hash, id);
 
-	for (i = 0; i < hash->elems_used; i++) {
-		if (!strcmp(hash->elems[i].id, id))
-			break;
-	}
-
-	if (i >= hash->elems_used)
+	if (i < 0)
 		return 0;
 
 	data_node_free(hash->elems[i].node);
@@ -193,23 +251,23 @@ static inline int data_node_hash_del(struct data_node *self, const char *id)
 
 	hash->elems[i] = hash->elems[--hash->elems_used];
 
+	/* deletions are rare, simply rebuild the index */
+	memset(DATA_HASH_INDEX(hash), 0, HASH_SLOTS);
+
+	for (j = 0; j < hash->elems_used; j++)
+		data_hash_index_add(hash, j);
+
 	return 1;
 }
 
 static struct data_node *data_node_hash_get(struct data_node *self, const char *id)
 {
-	unsigned int i;
-	struct data_node_hash *hash = &self->hash;
-
-	for (i = 0; i < hash->elems_used; i++) {
-		if (!strcmp(hash->elems[i].id, id))
-			break;
-	}
+	int i = data_hash_index_find(&self->hash, id);
 
-	if (i >= hash->elems_used)
+	if (i < 0)
 		return NULL;
 
-	return hash->elems[i].node;
+	return self->hash.elems[i].node;
 }
 
 static inline int data_node_array_add(struct data_node *self, struct data_node *payload)
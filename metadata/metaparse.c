@@ -8,11 +8,16 @@
 
 #include <search.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <string.h>
 #include <libgen.h>
 #include <ctype.h>
 #include <unistd.h>
 #include <errno.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
 
 #include "data_storage.h"
 
@@ -22,9 +27,73 @@ static int verbose;
 static char *cmdline_includepath[INCLUDE_PATH_MAX];
 static unsigned int cmdline_includepaths;
 static char *includepath;
+static char *includepath_buf;
+
+/*
+ * Growable array of strings, used for the files the result depends on and
+ * for the macro names and values that have to be freed between files.
+ */
+struct strvec {
+	unsigned int cnt;
+	unsigned int len;
+	char **strs;
+};
+
+static struct strvec deps;
+static struct strvec macro_strs;
+
+/*
+ * Macros defined in a header are parsed only once per process, further
+ * includes of the same header replay the cached definitions.
+ */
+struct include_cache {
+	struct include_cache *next;
+	char *path;
+	struct strvec macros;
+};
+
+#define INCLUDE_CACHE_SLOTS 256
+static struct include_cache *include_cache[INCLUDE_CACHE_SLOTS];
 
 #define WARN(str) fprintf(stderr, "WARNING: " str "\n")
 
+static void strvec_add(struct strvec *vec, char *str)
+{
+	if (vec->cnt >= vec->len) {
+		vec->len = vec->len ? 2 * vec->len : 64;
+		vec->strs = realloc(vec->strs, vec->len * sizeof(char *));
+
+		if (!vec->strs) {
+			fprintf(stderr, "Failed to allocate memory\n");
+			exit(1);
+		}
+	}
+
+	vec->strs[vec->cnt++] = str;
+}
+
+static void strvec_clear(struct strvec *vec)
+{
+	unsigned int i;
+
+	for (i = 0; i < vec->cnt; i++)
+		free(vec->strs[i]);
+
+	vec->cnt = 0;
+}
+
+static uint64_t hash_str(const char *str)
+{
+	uint64_t hash = 14695981039346656037ULL;
+
+	while (*str) {
+		hash ^= (unsigned char)*str++;
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
 static void oneline_comment(FILE *f)
 {
 	int c;
@@ -219,25 +288,29 @@ static char *next_token(FILE *f, struct data_node *doc)
 	return next_token2(f, buf, sizeof(buf), doc);
 }
 
-static FILE *open_file(const char *dir, const char *fname)
+static char *file_path(const char *dir, const char *fname)
 {
-	FILE *f;
 	char *path;
 
 	if (asprintf(&path, "%s/%s", dir, fname) < 0)
 		return NULL;
 
-	f = fopen(path, "r");
-
-	free(path);
+	if (access(path, R_OK)) {
+		free(path);
+		return NULL;
+	}
 
-	return f;
+	return path;
 }
 
-static FILE *open_include(FILE *f)
+/*
+ * Reads the include file name and returns path to the header in the
+ * directory of the parsed file or in the include paths. The path is
+ * recorded as a dependency of the parsed file.
+ */
+static char *find_include(FILE *f)
 {
-	char buf[256], *fname;
-	FILE *inc;
+	char buf[256], *fname, *path;
 	unsigned int i;
 
 	if (!fscanf(f, "%s\n", buf))
@@ -253,29 +326,34 @@ static FILE *open_include(FILE *f)
 
 	fname[strlen(fname)-1] = 0;
 
-	inc = open_file(includepath, fname);
-	if (inc) {
-		if (verbose)
-			fprintf(stderr, "INCLUDE %s/%s\n", includepath, fname);
+	path = file_path(includepath, fname);
 
-		return inc;
-	}
+	for (i = 0; !path && i < cmdline_includepaths; i++)
+		path = file_path(cmdline_includepath[i], fname);
 
-	for (i = 0; i < cmdline_includepaths; i++) {
-		inc = open_file(cmdline_includepath[i], fname);
+	if (!path)
+		return NULL;
 
-		if (!inc)
-			continue;
+	if (verbose)
+		fprintf(stderr, "INCLUDE %s\n", path);
 
-		if (verbose) {
-			fprintf(stderr, "INCLUDE %s/%s\n",
-				cmdline_includepath[i], fname);
-		}
+	strvec_add(&deps, strdup(path));
 
-		return inc;
-	}
+	return path;
+}
 
-	return NULL;
+static FILE *open_include(FILE *f)
+{
+	char *path = find_include(f);
+	FILE *inc;
+
+	if (!path)
+		return NULL;
+
+	inc = fopen(path, "r");
+	free(path);
+
+	return inc;
 }
 
 static void close_include(FILE *inc)
@@ -283,7 +361,8 @@ static void close_include(FILE *inc)
 	if (verbose)
 		fprintf(stderr, "INCLUDE END\n");
 
-	fclose(inc);
+	if (inc)
+		fclose(inc);
 }
 
 static int parse_array(FILE *f, struct data_node *node)
@@ -611,7 +690,24 @@ static void macro_get_val(FILE *f, char *buf, size_t buf_len)
 	}
 }
 
-static void parse_macro(FILE *f)
+static void macro_add(const char *name, const char *val)
+{
+	ENTRY e = {
+		.key = strdup(name),
+		.data = strdup(val),
+	};
+
+	if (verbose)
+		fprintf(stderr, " MACRO %s=%s\n", e.key, (char*)e.data);
+
+	strvec_add(&macro_strs, e.key);
+	strvec_add(&macro_strs, e.data);
+
+	hsearch(e, ENTER);
+}
+
+/* Parses a macro definition, records name and value into cache if set */
+static void parse_macro(FILE *f, struct include_cache *cache)
 {
 	char name[128];
 	char val[256];
@@ -627,26 +723,75 @@ static void parse_macro(FILE *f)
 	if (name[0] == '_')
 		return;
 
-	ENTRY e = {
-		.key = strdup(name),
-		.data = strdup(val),
-	};
+	macro_add(name, val);
 
-	if (verbose)
-		fprintf(stderr, " MACRO %s=%s\n", e.key, (char*)e.data);
+	if (cache) {
+		strvec_add(&cache->macros, strdup(name));
+		strvec_add(&cache->macros, strdup(val));
+	}
+}
 
-	hsearch(e, ENTER);
+static struct include_cache *include_cache_get(const char *path)
+{
+	unsigned int slot = hash_str(path) % INCLUDE_CACHE_SLOTS;
+	struct include_cache *cache;
+
+	for (cache = include_cache[slot]; cache; cache = cache->next) {
+		if (!strcmp(cache->path, path))
+			return cache;
+	}
+
+	return NULL;
+}
+
+static struct include_cache *include_cache_add(const char *path)
+{
+	unsigned int slot = hash_str(path) % INCLUDE_CACHE_SLOTS;
+	struct include_cache *cache = calloc(1, sizeof(*cache));
+
+	if (!cache) {
+		fprintf(stderr, "Failed to allocate memory\n");
+		exit(1);
+	}
+
+	cache->path = strdup(path);
+	cache->next = include_cache[slot];
+	include_cache[slot] = cache;
+
+	return cache;
 }
 
 static void parse_include_macros(FILE *f)
 {
+	struct include_cache *cache;
 	FILE *inc;
 	const char *token;
+	char *path;
+	unsigned int i;
 	int hash = 0;
 
-	inc = open_include(f);
-	if (!inc)
+	path = find_include(f);
+	if (!path)
+		return;
+
+	cache = include_cache_get(path);
+	if (cache) {
+		for (i = 0; i < cache->macros.cnt; i += 2)
+			macro_add(cache->macros.strs[i], cache->macros.strs[i+1]);
+
+		free(path);
+		close_include(NULL);
+		return;
+	}
+
+	inc = fopen(path, "r");
+	if (!inc) {
+		free(path);
 		return;
+	}
+
+	cache = include_cache_add(path);
+	free(path);
 
 	while ((token = next_token(inc, NULL))) {
 		if (token[0] == '#') {
@@ -658,7 +803,7 @@ static void parse_include_macros(FILE *f)
 			continue;
 
 		if (!strcmp(token, "define"))
-			parse_macro(inc);
+			parse_macro(inc, cache);
 
 		hash = 0;
 	}
@@ -671,6 +816,8 @@ static struct data_node *parse_file(const char *fname)
 	int state = 0, found = 0;
 	const char *token;
 
+	strvec_add(&deps, strdup(fname));
+
 	if (access(fname, F_OK)) {
 		fprintf(stderr, "file %s does not exist\n", fname);
 		return NULL;
@@ -678,7 +825,9 @@ static struct data_node *parse_file(const char *fname)
 
 	FILE *f = fopen(fname, "r");
 
-	includepath = dirname(strdup(fname));
+	free(includepath_buf);
+	includepath_buf = strdup(fname);
+	includepath = dirname(includepath_buf);
 
 	struct data_node *res = data_node_hash();
 	struct data_node *doc = data_node_array();
@@ -691,7 +840,7 @@ static struct data_node *parse_file(const char *fname)
 				token = next_token(f, doc);
 				if (token) {
 					if (!strcmp(token, "define"))
-						parse_macro(f);
+						parse_macro(f, NULL);
 
 					if (!strcmp(token, "include"))
 						parse_include_macros(f);
@@ -818,23 +967,407 @@ const char *strip_name(char *path)
 	return name;
 }
 
+/*
+ * Parses a test source and prints the JSON entry, returns 1 if there was
+ * anything to print.
+ */
+static int process_file(const char *fname, FILE *out)
+{
+	unsigned int i, j;
+	struct data_node *res;
+	char *name;
+
+	res = parse_file(fname);
+	if (!res)
+		return 0;
+
+	/* Filter out useless data */
+	for (i = 0; filter_out[i]; i++)
+		data_node_hash_del(res, filter_out[i]);
+
+	/* Normalize the result */
+	for (i = 0; implies[i].flag; i++) {
+		if (data_node_hash_get(res, implies[i].flag)) {
+			for (j = 0; implies[i].implies[j]; j++) {
+				if (data_node_hash_get(res, implies[i].implies[j]))
+					fprintf(stderr, "%s: useless tag: %s\n",
+						fname, implies[i].implies[j]);
+			}
+		}
+	}
+
+	/* Normalize types */
+	check_normalize_types(res);
+
+	for (i = 0; implies[i].flag; i++) {
+		if (data_node_hash_get(res, implies[i].flag)) {
+			for (j = 0; implies[i].implies[j]; j++) {
+				if (!data_node_hash_get(res, implies[i].implies[j]))
+					data_node_hash_add(res, implies[i].implies[j],
+							   data_node_string("1"));
+			}
+		}
+	}
+
+	data_node_hash_add(res, "fname", data_node_string(fname));
+	name = strdup(fname);
+	fprintf(out, "  \"%s\": ", strip_name(name));
+	free(name);
+	data_to_json(res, out, 2);
+	data_node_free(res);
+
+	return 1;
+}
+
+/*
+ * Multi file mode
+ *
+ * The files are parsed by a pool of worker processes, each of them takes the
+ * next file from a shared counter, so that the slow files do not stall the
+ * rest. Each result is stored into a cache entry along with the modification
+ * time and size of the source and of all the headers it included. In the
+ * incremental mode the entries are kept between runs and reused as long as
+ * none of the dependencies changed, otherwise a temporary directory is used.
+ * The parent then prints the entries in the order of the command line.
+ */
+#define CACHE_MAGIC "metaparse-cache 1"
+
+static char *cache_dir;
+static char cache_args[4096];
+
+static char *cache_entry_path(const char *fname)
+{
+	char *path;
+
+	if (asprintf(&path, "%s/%016llx.json", cache_dir,
+		     (unsigned long long)hash_str(fname)) < 0) {
+		fprintf(stderr, "Failed to allocate memory\n");
+		exit(1);
+	}
+
+	return path;
+}
+
+static void cache_init_args(void)
+{
+	size_t len = 0;
+	unsigned int i;
+
+	for (i = 0; i < cmdline_includepaths; i++) {
+		len += snprintf(cache_args + len, sizeof(cache_args) - len,
+				" -I%s", cmdline_includepath[i]);
+
+		if (len >= sizeof(cache_args)) {
+			fprintf(stderr, "Include paths too long\n");
+			exit(1);
+		}
+	}
+}
+
+/*
+ * Returns open cache entry positioned at the JSON result if the entry is up
+ * to date, NULL otherwise.
+ */
+static FILE *cache_entry_open(const char *fname)
+{
+	char *path = cache_entry_path(fname);
+	FILE *f = fopen(path, "r");
+	char *line = NULL;
+	size_t line_len = 0;
+	unsigned int lineno = 0;
+	ssize_t len;
+
+	free(path);
+
+	if (!f)
+		return NULL;
+
+	while ((len = getline(&line, &line_len, f)) > 0) {
+		long long sec, nsec, size;
+		struct stat st;
+		int pos;
+
+		if (line[len - 1] != '\n')
+			goto invalid;
+
+		line[--len] = 0;
+
+		if (!len) {
+			free(line);
+			return lineno > 1 ? f : NULL;
+		}
+
+		if (!lineno++) {
+			if (strncmp(line, CACHE_MAGIC, strlen(CACHE_MAGIC)) ||
+			    strcmp(line + strlen(CACHE_MAGIC), cache_args))
+				goto invalid;
+			continue;
+		}
+
+		if (sscanf(line, "%lli %lli %lli %n", &sec, &nsec, &size, &pos) != 3)
+			goto invalid;
+
+		/* first dependency is the source itself */
+		if (lineno == 2 && strcmp(line + pos, fname))
+			goto invalid;
+
+		/* size -1 marks file that did not exist */
+		if (stat(line + pos, &st)) {
+			if (size != -1)
+				goto invalid;
+			continue;
+		}
+
+		if (st.st_mtim.tv_sec != sec || st.st_mtim.tv_nsec != nsec ||
+		    st.st_size != size)
+			goto invalid;
+	}
+
+invalid:
+	free(line);
+	fclose(f);
+	return NULL;
+}
+
+static void cache_entry_write(const char *fname, const char *json, size_t len)
+{
+	char *path = cache_entry_path(fname);
+	char *tmp_path;
+	struct stat st;
+	unsigned int i;
+	FILE *f;
+
+	if (asprintf(&tmp_path, "%s.%i", path, getpid()) < 0)
+		goto err;
+
+	f = fopen(tmp_path, "w");
+	if (!f)
+		goto err;
+
+	fprintf(f, "%s%s\n", CACHE_MAGIC, cache_args);
+
+	for (i = 0; i < deps.cnt; i++) {
+		if (stat(deps.strs[i], &st)) {
+			fprintf(f, "0 0 -1 %s\n", deps.strs[i]);
+			continue;
+		}
+
+		fprintf(f, "%lli %lli %lli %s\n", (long long)st.st_mtim.tv_sec,
+			(long long)st.st_mtim.tv_nsec, (long long)st.st_size,
+			deps.strs[i]);
+	}
+
+	fputc('\n', f);
+	fwrite(json, 1, len, f);
+
+	if (fclose(f) || rename(tmp_path, path))
+		goto err;
+
+	free(tmp_path);
+	free(path);
+	return;
+err:
+	fprintf(stderr, "Failed to write cache entry %s: %s\n", path,
+		strerror(errno));
+	exit(1);
+}
+
+static void reset_file_state(void)
+{
+	hdestroy();
+	strvec_clear(&macro_strs);
+	strvec_clear(&deps);
+
+	if (!hcreate(128)) {
+		fprintf(stderr, "Failed to initialize hash table\n");
+		exit(1);
+	}
+}
+
+static void worker_run(char *files[], unsigned int cnt, unsigned int *next,
+		       int incremental)
+{
+	unsigned int i;
+	char *json;
+	size_t len;
+	FILE *f;
+
+	while ((i = __atomic_fetch_add(next, 1, __ATOMIC_RELAXED)) < cnt) {
+		if (incremental) {
+			f = cache_entry_open(files[i]);
+
+			if (f) {
+				fclose(f);
+				continue;
+			}
+		}
+
+		if (verbose)
+			fprintf(stderr, "PARSING %s\n", files[i]);
+
+		reset_file_state();
+
+		f = open_memstream(&json, &len);
+		if (!f) {
+			fprintf(stderr, "open_memstream() failed\n");
+			exit(1);
+		}
+
+		process_file(files[i], f);
+		fclose(f);
+
+		cache_entry_write(files[i], json, len);
+		free(json);
+	}
+
+	exit(0);
+}
+
+static void remove_cache_dir(void)
+{
+	struct dirent *ent;
+	char *path;
+	DIR *dir = opendir(cache_dir);
+
+	if (!dir)
+		return;
+
+	while ((ent = readdir(dir))) {
+		if (ent->d_name[0] == '.')
+			continue;
+
+		if (asprintf(&path, "%s/%s", cache_dir, ent->d_name) < 0)
+			continue;
+
+		unlink(path);
+		free(path);
+	}
+
+	closedir(dir);
+	rmdir(cache_dir);
+}
+
+static int print_results(char *files[], unsigned int cnt)
+{
+	int first = 1, c, empty;
+	unsigned int i;
+	FILE *f;
+
+	for (i = 0; i < cnt; i++) {
+		f = cache_entry_open(files[i]);
+
+		if (!f) {
+			fprintf(stderr, "Missing result for %s\n", files[i]);
+			return 1;
+		}
+
+		empty = 1;
+
+		while ((c = getc(f)) != EOF) {
+			if (empty && !first)
+				fputs(",\n", stdout);
+
+			empty = first = 0;
+			putchar(c);
+		}
+
+		if (!empty)
+			putchar('\n');
+
+		fclose(f);
+	}
+
+	return 0;
+}
+
+static int parse_files(char *files[], unsigned int cnt, unsigned int jobs,
+		       char *incremental_dir)
+{
+	char tmp_dir[] = "/tmp/metaparse.XXXXXX";
+	unsigned int *next, i;
+	int status, ret = 0;
+	pid_t pid;
+
+	if (incremental_dir) {
+		cache_dir = incremental_dir;
+
+		if (mkdir(cache_dir, 0755) && errno != EEXIST) {
+			fprintf(stderr, "mkdir(%s): %s\n", cache_dir, strerror(errno));
+			return 1;
+		}
+	} else {
+		cache_dir = mkdtemp(tmp_dir);
+
+		if (!cache_dir) {
+			fprintf(stderr, "mkdtemp(): %s\n", strerror(errno));
+			return 1;
+		}
+	}
+
+	cache_init_args();
+
+	next = mmap(NULL, sizeof(*next), PROT_READ | PROT_WRITE,
+		    MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+	if (next == MAP_FAILED) {
+		fprintf(stderr, "mmap(): %s\n", strerror(errno));
+		return 1;
+	}
+
+	*next = 0;
+	fflush(stdout);
+
+	for (i = 0; i < jobs && i < cnt; i++) {
+		pid = fork();
+
+		if (pid < 0) {
+			fprintf(stderr, "fork(): %s\n", strerror(errno));
+			ret = 1;
+			break;
+		}
+
+		if (!pid)
+			worker_run(files, cnt, next, !!incremental_dir);
+	}
+
+	while (wait(&status) > 0) {
+		if (!WIFEXITED(status) || WEXITSTATUS(status))
+			ret = 1;
+	}
+
+	if (!ret)
+		ret = print_results(files, cnt);
+
+	if (!incremental_dir)
+		remove_cache_dir();
+
+	munmap(next, sizeof(*next));
+
+	return ret;
+}
+
 static void print_help(const char *prgname)
 {
-	printf("usage: %s [-vh] input.c\n\n", prgname);
+	printf("usage: %s [-vh] [-j jobs] [-C cachedir] input.c [input.c ...]\n\n", prgname);
 	printf("-v sets verbose mode\n");
 	printf("-I add include path\n");
+	printf("-j number of parallel jobs for multiple input files\n");
+	printf("-C cache directory, reparse only files that changed since last run\n");
 	printf("-h prints this help\n\n");
 	exit(0);
 }
 
 int main(int argc, char *argv[])
 {
-	unsigned int i, j;
-	struct data_node *res;
+	char *incremental_dir = NULL;
+	long jobs = 0;
 	int opt;
 
-	while ((opt = getopt(argc, argv, "hI:v")) != -1) {
+	while ((opt = getopt(argc, argv, "C:hI:j:v")) != -1) {
 		switch (opt) {
+		case 'C':
+			incremental_dir = optarg;
+		break;
 		case 'h':
 			print_help(argv[0]);
 		break;
@@ -846,6 +1379,14 @@ int main(int argc, char *argv[])
 
 			cmdline_includepath[cmdline_includepaths++] = optarg;
 		break;
+		case 'j':
+			jobs = atol(optarg);
+
+			if (jobs < 1) {
+				fprintf(stderr, "Invalid number of jobs %s\n", optarg);
+				exit(1);
+			}
+		break;
 		case 'v':
 			verbose = 1;
 		break;
@@ -857,47 +1398,20 @@ int main(int argc, char *argv[])
 		return 1;
 	}
 
-	if (!hcreate(128)) {
-		fprintf(stderr, "Failed to initialize hash table\n");
-		return 1;
-	}
-
-	res = parse_file(argv[optind]);
-	if (!res)
-		return 0;
-
-	/* Filter out useless data */
-	for (i = 0; filter_out[i]; i++)
-		data_node_hash_del(res, filter_out[i]);
+	if (argc - optind > 1 || jobs || incremental_dir) {
+		if (!jobs)
+			jobs = sysconf(_SC_NPROCESSORS_ONLN);
 
-	/* Normalize the result */
-	for (i = 0; implies[i].flag; i++) {
-		if (data_node_hash_get(res, implies[i].flag)) {
-			for (j = 0; implies[i].implies[j]; j++) {
-				if (data_node_hash_get(res, implies[i].implies[j]))
-					fprintf(stderr, "%s: useless tag: %s\n",
-						argv[optind], implies[i].implies[j]);
-			}
-		}
+		return parse_files(argv + optind, argc - optind, jobs > 0 ? jobs : 1,
+				   incremental_dir);
 	}
 
-	/* Normalize types */
-	check_normalize_types(res);
-
-	for (i = 0; implies[i].flag; i++) {
-		if (data_node_hash_get(res, implies[i].flag)) {
-			for (j = 0; implies[i].implies[j]; j++) {
-				if (!data_node_hash_get(res, implies[i].implies[j]))
-					data_node_hash_add(res, implies[i].implies[j],
-							   data_node_string("1"));
-			}
-		}
+	if (!hcreate(128)) {
+		fprintf(stderr, "Failed to initialize hash table\n");
+		return 1;
 	}
 
-	data_node_hash_add(res, "fname", data_node_string(argv[optind]));
-	printf("  \"%s\": ", strip_name(argv[optind]));
-	data_to_json(res, stdout, 2);
-	data_node_free(res);
+	process_file(argv[optind], stdout);
 
 	return 0;
 }
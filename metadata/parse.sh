@@ -27,20 +27,13 @@ echo '  "timeout": 300'
 echo ' },'
 echo ' "tests": {'
 
-first=1
-
-for test in `find testcases/ -name '*.c'|sort`; do
-	a=$($top_builddir/metadata/metaparse -Iinclude -Itestcases/kernel/syscalls/utils/ "$test")
-	if [ -n "$a" ]; then
-		if [ -z "$first" ]; then
-			echo ','
-		fi
-		first=
-		cat <<EOF
-$a
-EOF
-	fi
-done
+# All files are parsed by a single metaparse process with a pool of workers,
+# set METAPARSE_CACHE to a directory to reparse only files that changed since
+# the last run.
+$top_builddir/metadata/metaparse -Iinclude -Itestcases/kernel/syscalls/utils/ \
+	${METAPARSE_JOBS:+-j $METAPARSE_JOBS} \
+	${METAPARSE_CACHE:+-C $METAPARSE_CACHE} \
+	$(find testcases/ -name '*.c'|sort)
 
 echo
 echo ' }'
@@ -69,6 +69,7 @@
 
 #include "splitstr.h"
 #include "zoolib.h"
+#include "scheduler.h"
 #include "tst_res_flags.h"
 
 /* One entry in the command line collection.  */
@@ -76,6 +77,7 @@ struct coll_entry {
 	char *name;		/* tag name */
 	char *cmdline;		/* command line */
 	char *pcnt_f;		/* location of %f in the command line args, flag */
+	int idx;		/* index in the collection array */
 	struct coll_entry *next;
 };
 
@@ -100,6 +102,8 @@ struct orphan_pgrp {
 static pid_t run_child(struct coll_entry *colle, struct tag_pgrp *active,
 		       int quiet_mode, int *failcnt, int fmt_print,
 		       FILE * logfile, int no_kmsg);
+static void log_start_failure(struct coll_entry *colle, FILE *logfile,
+			      int fmt_print, int *failcnt, int err);
 static char *slurp(char *file);
 static struct collection *get_collection(char *file, int optind, int argc,
 					 char **argv);
@@ -130,6 +134,7 @@ static char *panname = NULL;
 static char *test_out_dir = NULL;	/* dir to buffer output to */
 zoo_t zoofile;
 static char *reporttype = NULL;
+static int sched_enabled;	/* resource-aware scheduling (-M) */
 
 /* Common format string for ltp-pan results */
 #define ResultFmt	"%-50s %-10.10s"
@@ -159,6 +164,7 @@ int main(int argc, char **argv)
 	char *failcmdfilename = NULL;
 	char *tconfcmdfilename = NULL;
 	char *outputfilename = NULL;
+	char *metafilename = NULL;
 	struct collection *coll = NULL;
 	struct tag_pgrp *running;
 	struct orphan_pgrp *orphans, *orph;
@@ -191,13 +197,16 @@ int main(int argc, char **argv)
 	struct sigaction sa;
 
 	while ((c =
-		getopt(argc, argv, "AO:Sa:C:QT:d:ef:hl:n:o:pqr:s:t:x:y"))
+		getopt(argc, argv, "AM:O:Sa:C:QT:d:ef:hl:n:o:pqr:s:t:x:y"))
 		       != -1) {
 		switch (c) {
 		case 'A':	/* all-stop flag */
 			has_brakes = 1;
 			track_exit_stats = 1;
 			break;
+		case 'M':	/* metadata file for resource-aware scheduling */
+			metafilename = strdup(optarg);
+			break;
 		case 'O':	/* output buffering directory */
 			test_out_dir = strdup(optarg);
 			break;
@@ -236,7 +245,8 @@ int main(int argc, char **argv)
 				"[ -a active-file ] [ -f command-file ] "
 				"[ -C fail-command-file ] "
 				"[ -d debug-level ]\n\t[-o output-file] "
-				"[-O output-buffer-directory] [cmd]\n");
+				"[-O output-buffer-directory] "
+				"[-M metadata-file] [cmd]\n");
 			exit(0);
 		case 'l':	/* log file */
 			logfilename = strdup(optarg);
@@ -375,6 +385,40 @@ int main(int argc, char **argv)
 	if (Debug & Dsetup)
 		dump_coll(coll);
 
+	/* the scheduler hands out every tag exactly once */
+	if (metafilename) {
+		char **tags = malloc(coll->cnt * sizeof(char *));
+		char **cmdlines = malloc(coll->cnt * sizeof(char *));
+
+		if (tags == NULL || cmdlines == NULL) {
+			fprintf(stderr, "pan(%s): Failed to allocate memory: %s\n",
+				panname, strerror(errno));
+			exit(2);
+		}
+
+		for (i = 0; i < coll->cnt; i++) {
+			tags[i] = coll->ary[i]->name;
+			cmdlines[i] = coll->ary[i]->cmdline;
+		}
+
+		if (sched_init(metafilename, tags, cmdlines, coll->cnt,
+			       keep_active)) {
+			fprintf(stderr, "pan(%s): Failed to initialize scheduler\n",
+				panname);
+			exit(1);
+		}
+		free(tags);
+		free(cmdlines);
+
+		sched_enabled = 1;
+		sequential = 1;
+		starts = -1;
+		timed = 0;
+
+		if (!quiet_mode)
+			sched_print_estimate(stdout, panname);
+	}
+
 	/* a place to store the pgrps we're watching */
 	running =
 		malloc((keep_active + 1) *
@@ -527,8 +571,13 @@ int main(int argc, char **argv)
 			if (stop || rec_signal || go_idle)
 				break;
 
-			if (!sequential)
+			if (metafilename) {
+				c = sched_next();
+				if (c < 0)
+					break;
+			} else if (!sequential) {
 				c = lrand48() % coll->cnt;
+			}
 
 			/* find a slot for the child */
 			for (i = 0; i < keep_active; ++i) {
@@ -547,8 +596,11 @@ int main(int argc, char **argv)
 			cpid =
 			    run_child(coll->ary[c], running + i, quiet_mode,
 				      &failcnt, fmt_print, logfile, no_kmsg);
-			if (cpid != -1)
+			if (cpid != -1) {
 				++num_active;
+				if (metafilename)
+					sched_start(c);
+			}
 			if ((cpid != -1 || sequential) && starts > 0)
 				--starts;
 
@@ -872,6 +924,9 @@ check_pids(struct tag_pgrp *running, int *num_active, int keep_active,
 				if (signaled && !running[i].stopping)
 					ret++;
 
+				if (sched_enabled)
+					sched_done(running[i].cmd->idx);
+
 				running[i].pgrp = 0;
 				if (zoo_clear(zoofile, cpid)) {
 					fprintf(stderr, "pan(%s): %s\n",
@@ -928,6 +983,8 @@ run_child(struct coll_entry *colle, struct tag_pgrp *active, int quiet_mode,
 				"pan(%s): open of stdout file failed (tag %s).  errno: %d  %s\n  file: %s\n",
 				panname, colle->name, errno, strerror(errno),
 				active->output);
+			log_start_failure(colle, logfile, fmt_print, failcnt,
+					  errno);
 			return -1;
 		}
 	}
@@ -944,6 +1001,7 @@ run_child(struct coll_entry *colle, struct tag_pgrp *active, int quiet_mode,
 	if (pipe(errpipe) < 0) {
 		fprintf(stderr, "pan(%s): pipe() failed. errno:%d %s\n",
 			panname, errno, strerror(errno));
+		log_start_failure(colle, logfile, fmt_print, failcnt, errno);
 		if (capturing) {
 			close(c_stdout);
 			unlink(active->output);
@@ -963,6 +1021,7 @@ run_child(struct coll_entry *colle, struct tag_pgrp *active, int quiet_mode,
 		fprintf(stderr,
 			"pan(%s): fork failed (tag %s).  errno:%d  %s\n",
 			panname, colle->name, errno, strerror(errno));
+		log_start_failure(colle, logfile, fmt_print, failcnt, errno);
 		if (capturing) {
 			unlink(active->output);
 			close(c_stdout);
@@ -1156,6 +1215,31 @@ run_child(struct coll_entry *colle, struct tag_pgrp *active, int quiet_mode,
 	return cpid;
 }
 
+/*
+ * Records a tag that could not be started at all as failed, otherwise it would
+ * be missing from the results.
+ */
+static void log_start_failure(struct coll_entry *colle, FILE *logfile,
+			      int fmt_print, int *failcnt, int err)
+{
+	time_t now;
+
+	if (logfile == NULL)
+		return;
+
+	time(&now);
+
+	if (!fmt_print) {
+		fprintf(logfile,
+			"tag=%s stime=%d dur=0 exit=exited stat=%d core=no "
+			"cu=0 cs=0\n", colle->name, (int)now, err);
+	} else {
+		++*failcnt;
+		fprintf(logfile, ResultFmt" %-5d\n", colle->name, "FAIL", err);
+	}
+	fflush(logfile);
+}
+
 static char *subst_pcnt_f(struct coll_entry *colle)
 {
 	static int counter = 1;
@@ -1261,6 +1345,7 @@ static struct collection *get_collection(char *file, int optind, int argc,
 	i = 0;
 	n = head;
 	while (n != NULL) {
+		n->idx = i;
 		coll->ary[i] = n;
 		n = n->next;
 		++i;
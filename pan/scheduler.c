@@ -0,0 +1,593 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (c) Linux Test Project, 2026
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "scheduler.h"
+
+#define NAME_LEN 128
+#define VAL_LEN 256
+
+struct meta_test {
+	char name[NAME_LEN];
+	struct sched_req req;
+};
+
+struct sched_state {
+	int workers;
+	int active;
+	int devices;
+	int cgroups;
+	int exclusive;
+	long mem_mb;
+};
+
+static struct meta_test *meta;
+static unsigned int meta_cnt;
+static unsigned int meta_size;
+
+static struct sched_req *reqs;
+static int *queue;
+static int queue_cnt;
+static int queue_len;
+
+static struct sched_state state;
+static long mem_avail_mb;
+
+/*
+ * A minimal JSON reader, just enough to walk the "tests" object of ltp.json.
+ */
+static const char *skip_ws(const char *p)
+{
+	while (*p && isspace(*p))
+		p++;
+
+	return p;
+}
+
+static const char *parse_string(const char *p, char *buf, size_t size)
+{
+	size_t len = 0;
+
+	if (*p != '"')
+		return NULL;
+
+	for (p++; *p && *p != '"'; p++) {
+		if (*p == '\\' && *(p+1))
+			p++;
+
+		if (buf && len + 1 < size)
+			buf[len++] = *p;
+	}
+
+	if (!*p)
+		return NULL;
+
+	if (buf)
+		buf[len] = 0;
+
+	return p + 1;
+}
+
+static const char *skip_value(const char *p)
+{
+	int depth = 0;
+
+	do {
+		p = skip_ws(p);
+
+		switch (*p) {
+		case '"':
+			p = parse_string(p, NULL, 0);
+			if (!p)
+				return NULL;
+		break;
+		case '{':
+		case '[':
+			depth++;
+			p++;
+		break;
+		case '}':
+		case ']':
+			depth--;
+			p++;
+		break;
+		case ',':
+		case ':':
+			p++;
+		break;
+		case 0:
+			return NULL;
+		default:
+			while (*p && !isspace(*p) && !strchr(",:]}", *p))
+				p++;
+		}
+	} while (depth > 0);
+
+	return p;
+}
+
+static long parse_runtime(const char *val)
+{
+	long ret = 1, n;
+	char *end;
+
+	/* max_runtime is a C expression, handle the usual "5 * 60" */
+	for (;;) {
+		n = strtol(val, &end, 0);
+		if (end == val || n <= 0)
+			return SCHED_DEFAULT_RUNTIME;
+
+		ret *= n;
+		end = (char *)skip_ws(end);
+
+		if (!*end)
+			return ret;
+
+		if (*end != '*')
+			return SCHED_DEFAULT_RUNTIME;
+
+		val = end + 1;
+	}
+}
+
+static void set_attr(struct sched_req *req, const char *key, const char *val)
+{
+	if (!strcmp(key, "needs_device") || !strcmp(key, "all_filesystems") ||
+	    !strcmp(key, "mount_device") || !strcmp(key, "format_device")) {
+		req->device = 1;
+		return;
+	}
+
+	if (!strcmp(key, "needs_cgroup_ctrls")) {
+		req->cgroup = 1;
+		return;
+	}
+
+	if (!strcmp(key, "save_restore") || !strcmp(key, "hugepages")) {
+		req->exclusive = 1;
+		return;
+	}
+
+	if (!val)
+		return;
+
+	if (!strcmp(key, "max_runtime"))
+		req->runtime = parse_runtime(val);
+
+	if (!strcmp(key, "min_mem_avail"))
+		req->mem_mb = atol(val);
+}
+
+static struct meta_test *meta_add(const char *name)
+{
+	struct meta_test *tmp;
+
+	if (meta_cnt >= meta_size) {
+		meta_size = meta_size ? 2 * meta_size : 1024;
+		tmp = realloc(meta, meta_size * sizeof(*meta));
+		if (!tmp)
+			return NULL;
+		meta = tmp;
+	}
+
+	tmp = &meta[meta_cnt++];
+	memset(tmp, 0, sizeof(*tmp));
+	snprintf(tmp->name, NAME_LEN, "%s", name);
+	tmp->req.runtime = SCHED_DEFAULT_RUNTIME;
+	tmp->req.known = 1;
+
+	return tmp;
+}
+
+static const char *parse_test(const char *p, struct meta_test *test)
+{
+	char key[NAME_LEN], val[VAL_LEN];
+
+	p = skip_ws(p);
+	if (*p++ != '{')
+		return NULL;
+
+	for (;;) {
+		p = skip_ws(p);
+
+		if (*p == '}')
+			return p + 1;
+
+		if (*p == ',') {
+			p++;
+			continue;
+		}
+
+		p = parse_string(p, key, sizeof(key));
+		if (!p)
+			return NULL;
+
+		p = skip_ws(p);
+		if (*p++ != ':')
+			return NULL;
+
+		p = skip_ws(p);
+		if (*p == '"') {
+			p = parse_string(p, val, sizeof(val));
+			set_attr(&test->req, key, val);
+		} else {
+			p = skip_value(p);
+			set_attr(&test->req, key, NULL);
+		}
+
+		if (!p)
+			return NULL;
+	}
+}
+
+static const char *parse_tests(const char *p)
+{
+	char name[NAME_LEN];
+	struct meta_test *test;
+
+	p = skip_ws(p);
+	if (*p++ != '{')
+		return NULL;
+
+	for (;;) {
+		p = skip_ws(p);
+
+		if (*p == '}')
+			return p + 1;
+
+		if (*p == ',') {
+			p++;
+			continue;
+		}
+
+		p = parse_string(p, name, sizeof(name));
+		if (!p)
+			return NULL;
+
+		p = skip_ws(p);
+		if (*p++ != ':')
+			return NULL;
+
+		test = meta_add(name);
+		if (!test)
+			return NULL;
+
+		p = parse_test(p, test);
+		if (!p)
+			return NULL;
+	}
+}
+
+static int parse_metadata(const char *buf)
+{
+	char key[NAME_LEN];
+	const char *p = skip_ws(buf);
+
+	if (*p++ != '{')
+		return -1;
+
+	for (;;) {
+		p = skip_ws(p);
+
+		if (*p == '}')
+			return 0;
+
+		if (*p == ',') {
+			p++;
+			continue;
+		}
+
+		p = parse_string(p, key, sizeof(key));
+		if (!p)
+			return -1;
+
+		p = skip_ws(p);
+		if (*p++ != ':')
+			return -1;
+
+		if (!strcmp(key, "tests"))
+			p = parse_tests(p);
+		else
+			p = skip_value(p);
+
+		if (!p)
+			return -1;
+	}
+}
+
+static char *read_file(const char *path)
+{
+	struct stat st;
+	char *buf;
+	ssize_t ret;
+	size_t len = 0;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+
+	if (fstat(fd, &st) || !(buf = malloc(st.st_size + 1))) {
+		close(fd);
+		return NULL;
+	}
+
+	while (len < (size_t)st.st_size) {
+		ret = read(fd, buf + len, st.st_size - len);
+		if (ret <= 0)
+			break;
+		len += ret;
+	}
+
+	close(fd);
+	buf[len] = 0;
+
+	return buf;
+}
+
+static int meta_cmp(const void *a, const void *b)
+{
+	return strcmp(((const struct meta_test *)a)->name,
+		      ((const struct meta_test *)b)->name);
+}
+
+static struct meta_test *find(const char *name)
+{
+	struct meta_test key;
+
+	snprintf(key.name, NAME_LEN, "%s", name);
+
+	return bsearch(&key, meta, meta_cnt, sizeof(*meta), meta_cmp);
+}
+
+static void lookup(const char *tag, const char *cmdline, struct sched_req *req)
+{
+	char name[NAME_LEN];
+	struct meta_test *res;
+	size_t len;
+
+	memset(req, 0, sizeof(*req));
+	req->runtime = SCHED_DEFAULT_RUNTIME;
+
+	/* runtest tags are usually the test names */
+	res = find(tag);
+
+	if (!res) {
+		cmdline = skip_ws(cmdline);
+		len = strcspn(cmdline, " \t");
+		if (len >= NAME_LEN)
+			len = NAME_LEN - 1;
+
+		memcpy(name, cmdline, len);
+		name[len] = 0;
+		res = find(basename(name));
+	}
+
+	if (res)
+		*req = res->req;
+}
+
+static long read_mem_avail(void)
+{
+	FILE *f;
+	char line[128];
+	long kb = -1;
+
+	f = fopen("/proc/meminfo", "r");
+	if (!f)
+		return -1;
+
+	while (fgets(line, sizeof(line), f)) {
+		if (sscanf(line, "MemAvailable: %ld kB", &kb) == 1)
+			break;
+	}
+
+	fclose(f);
+
+	return kb < 0 ? -1 : kb / 1024;
+}
+
+static int fits(const struct sched_state *s, const struct sched_req *req)
+{
+	if (s->active >= s->workers || s->exclusive)
+		return 0;
+
+	/* Never starve a test whose requirements cannot be met at all */
+	if (!s->active)
+		return 1;
+
+	if (req->exclusive)
+		return 0;
+
+	if (req->device && s->devices)
+		return 0;
+
+	if (req->cgroup && s->cgroups)
+		return 0;
+
+	if (mem_avail_mb >= 0 && s->mem_mb + req->mem_mb > mem_avail_mb)
+		return 0;
+
+	return 1;
+}
+
+static void account(struct sched_state *s, const struct sched_req *req,
+		    int dir)
+{
+	s->active += dir;
+	s->devices += dir * req->device;
+	s->cgroups += dir * req->cgroup;
+	s->exclusive += dir * req->exclusive;
+	s->mem_mb += dir * req->mem_mb;
+}
+
+static int pick(const struct sched_state *s, int *q, int *q_len)
+{
+	int i, idx;
+
+	for (i = 0; i < *q_len; i++) {
+		idx = q[i];
+
+		if (!fits(s, &reqs[idx]))
+			continue;
+
+		memmove(q + i, q + i + 1, (*q_len - i - 1) * sizeof(*q));
+		(*q_len)--;
+		return idx;
+	}
+
+	return -1;
+}
+
+static int runtime_cmp(const void *a, const void *b)
+{
+	int ia = *(const int *)a, ib = *(const int *)b;
+
+	if (reqs[ia].runtime != reqs[ib].runtime)
+		return reqs[ia].runtime < reqs[ib].runtime ? 1 : -1;
+
+	/* keep the runtest file order for ties */
+	return ia - ib;
+}
+
+int sched_init(const char *metafile, char *const tags[],
+	       char *const cmdlines[], int cnt, int workers)
+{
+	char *buf;
+	int i, ret;
+
+	buf = read_file(metafile);
+	if (!buf) {
+		fprintf(stderr, "Failed to read '%s': %s\n",
+			metafile, strerror(errno));
+		return -1;
+	}
+
+	ret = parse_metadata(buf);
+	free(buf);
+
+	if (ret) {
+		fprintf(stderr, "Failed to parse metadata '%s'\n", metafile);
+		return -1;
+	}
+
+	qsort(meta, meta_cnt, sizeof(*meta), meta_cmp);
+
+	reqs = calloc(cnt, sizeof(*reqs));
+	queue = calloc(cnt, sizeof(*queue));
+	if (!reqs || !queue) {
+		fprintf(stderr, "Failed to allocate memory\n");
+		return -1;
+	}
+
+	for (i = 0; i < cnt; i++) {
+		lookup(tags[i], cmdlines[i], &reqs[i]);
+		queue[i] = i;
+	}
+
+	queue_cnt = queue_len = cnt;
+	qsort(queue, cnt, sizeof(*queue), runtime_cmp);
+
+	state.workers = workers;
+	mem_avail_mb = read_mem_avail();
+
+	return 0;
+}
+
+int sched_next(void)
+{
+	return pick(&state, queue, &queue_len);
+}
+
+void sched_start(int idx)
+{
+	account(&state, &reqs[idx], 1);
+}
+
+void sched_done(int idx)
+{
+	account(&state, &reqs[idx], -1);
+}
+
+/*
+ * Replays the admission on the runtime estimates, the result is the
+ * makespan under the assumption that every test runs for its max_runtime.
+ */
+static long simulate(void)
+{
+	struct sched_state s = {.workers = state.workers};
+	long *end = calloc(queue_cnt, sizeof(*end));
+	int *q = malloc(queue_cnt * sizeof(*q));
+	int *running = malloc(state.workers * sizeof(*running));
+	int q_len = queue_cnt, nrun = 0, i, idx, min;
+	long now = 0;
+
+	if (!end || !q || !running) {
+		now = -1;
+		goto exit;
+	}
+
+	memcpy(q, queue, queue_cnt * sizeof(*q));
+
+	while (q_len || nrun) {
+		while ((idx = pick(&s, q, &q_len)) >= 0) {
+			account(&s, &reqs[idx], 1);
+			end[idx] = now + reqs[idx].runtime;
+			running[nrun++] = idx;
+		}
+
+		for (min = 0, i = 1; i < nrun; i++) {
+			if (end[running[i]] < end[running[min]])
+				min = i;
+		}
+
+		idx = running[min];
+		now = end[idx];
+		account(&s, &reqs[idx], -1);
+		running[min] = running[--nrun];
+	}
+
+exit:
+	free(end);
+	free(q);
+	free(running);
+	return now;
+}
+
+void sched_print_estimate(FILE *f, const char *panname)
+{
+	int i, known = 0, device = 0, cgroup = 0, exclusive = 0;
+	long serial = 0;
+
+	for (i = 0; i < queue_cnt; i++) {
+		known += reqs[i].known;
+		device += reqs[i].device;
+		cgroup += reqs[i].cgroup;
+		exclusive += reqs[i].exclusive;
+		serial += reqs[i].runtime;
+	}
+
+	fprintf(f, "pan(%s): scheduling %d tags (%d with metadata) on %d workers\n",
+		panname, queue_cnt, known, state.workers);
+	fprintf(f, "pan(%s): serialized: %d device, %d cgroup, %d exclusive\n",
+		panname, device, cgroup, exclusive);
+
+	if (mem_avail_mb >= 0)
+		fprintf(f, "pan(%s): memory budget %ld MB\n", panname,
+			mem_avail_mb);
+
+	fprintf(f, "pan(%s): estimated makespan %lds (serial %lds), tags without max_runtime counted as %ds\n",
+		panname, simulate(), serial, SCHED_DEFAULT_RUNTIME);
+	fflush(f);
+}
@@ -0,0 +1,60 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (c) Linux Test Project, 2026
+ */
+
+/*
+ * Resource-aware admission for ltp-pan.
+ *
+ * The requirements of each tag are looked up by the test name in the ltp.json
+ * file generated by metadata/metaparse. Tests that share a resource which
+ * cannot be used concurrently are serialized, the rest is packed on the
+ * available workers, longest max_runtime first.
+ */
+
+#ifndef PAN_SCHEDULER_H
+#define PAN_SCHEDULER_H
+
+#include <stdio.h>
+
+/* Runtime estimate for tests that do not set max_runtime */
+#define SCHED_DEFAULT_RUNTIME 1
+
+struct sched_req {
+	/* needs a block device (loop devices are allocated racily) */
+	int device;
+	/* needs cgroup controllers */
+	int cgroup;
+	/* changes system wide settings, has to run alone */
+	int exclusive;
+	/* min_mem_avail in MB */
+	long mem_mb;
+	/* max_runtime in seconds */
+	long runtime;
+	/* set when the metadata for the test was found */
+	int known;
+};
+
+/*
+ * Loads the metadata and prepares the admission queue for cnt commands. The
+ * tests are looked up by the tag first, then by the command basename.
+ * Returns 0 on success, -1 on failure with message printed to stderr.
+ */
+int sched_init(const char *metafile, char *const tags[],
+	       char *const cmdlines[], int cnt, int workers);
+
+/*
+ * Returns index of the next command that can be started right now or -1 if
+ * the next one has to wait for a running command to finish. The command is
+ * removed from the queue.
+ */
+int sched_next(void);
+
+/* Accounts the resources of a started or finished command. */
+void sched_start(int idx);
+void sched_done(int idx);
+
+/* Prints the estimated makespan and the scheduling constraints. */
+void sched_print_estimate(FILE *f, const char *panname);
+
+#endif /* PAN_SCHEDULER_H */
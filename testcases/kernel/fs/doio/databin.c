@@ -34,6 +34,10 @@
 #include <string.h>		/* memset */
 #include <stdlib.h>		/* rand */
 #include "databin.h"
+#include "tst_rand_data.h"
+
+/* Seed of the 's' stream, the same for all writers of a file */
+#define DATABIN_SEED 221849
 
 #if UNIT_TEST
 #include <stdlib.h>
@@ -72,6 +76,11 @@ void databingen(int mode, char *buffer, int bsize, int offset)
 	case 'r':		/* random */
 		for (ind = 0; ind < bsize; ind++)
 			buffer[ind] = (rand() & 0177) | 0100;
+		break;
+
+	case 's':		/* seeded random stream */
+		tst_rand_data_fill(DATABIN_SEED, offset, buffer, bsize);
+		break;
 	}
 }
 
@@ -126,6 +135,17 @@ int databinchk(int mode, char *buffer, int bsize, int offset, char **errmsg)
 
 	case 'r':
 		return -1;	/* no check can be done for random */
+
+	case 's':
+		cnt = tst_rand_data_verify(DATABIN_SEED, offset, buffer, bsize);
+		if (cnt >= 0) {
+			sprintf(Errmsg,
+				"data mismatch at offset %d, act:%#o (seeded stream)",
+				offset + cnt, chr[cnt]);
+			return offset + cnt;
+		}
+		sprintf(Errmsg, "all %d bytes match desired pattern", bsize);
+		return -1;
 	}
 
 	for (cnt = 0; cnt < bsize; chr++, cnt++) {
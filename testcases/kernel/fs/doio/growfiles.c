@@ -191,6 +191,8 @@ int open_flags = O_RDWR | O_CREAT;	/* open flags */
 #define PATTERN_ONES	7	/* all bits set (i.e. 0xffffffffffffff...) */
 #define PATTERN_ZEROS	8	/* all bits cleared (i.e. 0x000000000...) */
 #define PATTERN_RANDOM	9	/* random integers - can not be checked */
+#define PATTERN_STREAM	10	/* seeded random stream, offset based */
+				/* Allows multiple processes to write/read */
 #define STATIC_NUM	221849	/* used instead of pid when PATTERN_OFFSET */
 
 #define MODE_RAND_SIZE	1	/* random write and trunc */
@@ -713,6 +715,9 @@ int main(int argc, char **argv)
 				Pattern = PATTERN_RANDOM;
 				using_random++;
 				break;
+			case 's':
+				Pattern = PATTERN_STREAM;
+				break;
 			case 'z':
 				Pattern = PATTERN_ZEROS;
 				break;
@@ -721,7 +726,7 @@ int main(int argc, char **argv)
 				break;
 			default:
 				fprintf(stderr,
-					"%s%s: --C option arg invalid, A, a, p, o, c, C, r, z, or 0\n",
+					"%s%s: --C option arg invalid, A, a, p, o, c, C, r, s, z, or 0\n",
 					Progname, TagName);
 				usage();
 				exit(1);
@@ -1039,6 +1044,10 @@ no whole file checking will be performed!\n", Progname, TagName,
 			printf
 			    ("%s: %d DEBUG3 random integer pattern - no write/file checking\n",
 			     Progname, Pid);
+		else if (Pattern == PATTERN_STREAM)
+			printf
+			    ("%s: %d DEBUG3 seeded random stream - allows multiple writers\n",
+			     Progname, Pid);
 		else if (Pattern == PATTERN_ONES)
 			printf
 			    ("%s: %d DEBUG3 all ones pattern - allows multiple writers\n",
@@ -1861,7 +1870,7 @@ void help(void)
   -p             Specifies to pre-allocate space\n\
   -q pattern     pattern can be a - ascii, p - pid with boff, o boff (def)\n\
 		 A - Alternating bits, r - random, O - all ones, z - all zeros,\n\
-		 c - checkboard, C - counting\n\
+		 c - checkboard, C - counting, s - seeded random stream\n\
   -R [min-]max   random lseek before write and trunc, max of -1 means filesz,\n\
 		 -2 means filesz+grow, -3 filesz-grow. (min def is 0)\n\
   -r [min-]max   random io write size (min def is 1)\n\
@@ -2171,6 +2180,8 @@ int /* BUG:14136 */ growfile(int fd, char *file, int grow_incr, char *buf,
 			dataasciigen(NULL, buf, grow_incr, Woffset);
 		else if (Pattern == PATTERN_RANDOM)
 			databingen('r', buf, grow_incr, Woffset);
+		else if (Pattern == PATTERN_STREAM)
+			databingen('s', buf, grow_incr, Woffset);
 		else if (Pattern == PATTERN_ALT)
 			databingen('a', buf, grow_incr, Woffset);
 		else if (Pattern == PATTERN_CHKER)
@@ -2649,6 +2660,8 @@ int check_write(int fd, int cf_inter, char *filename, int mode)
 	else if (Pattern == PATTERN_ASCII)
 		ret = dataasciichk(NULL, Buffer, Grow_incr, Woffset, &errmsg);
 	else if (Pattern == PATTERN_RANDOM) ;	/* no check for random */
+	else if (Pattern == PATTERN_STREAM)
+		ret = databinchk('s', Buffer, Grow_incr, Woffset, &errmsg);
 	else if (Pattern == PATTERN_ALT)
 		ret = databinchk('a', Buffer, Grow_incr, Woffset, &errmsg);
 	else if (Pattern == PATTERN_CHKER)
@@ -2804,6 +2817,10 @@ int check_file(int fd, int cf_inter, char *filename, int no_file_check)
 				    dataasciichk(NULL, buf, rd_size, rd_cnt,
 						 &errmsg);
 			else if (Pattern == PATTERN_RANDOM) ;	/* no checks for random */
+			else if (Pattern == PATTERN_STREAM)
+				ret =
+				    databinchk('s', buf, rd_size, rd_cnt,
+					       &errmsg);
 			else if (Pattern == PATTERN_ALT)
 				ret =
 				    databinchk('a', buf, rd_size, rd_cnt,
@@ -2890,6 +2907,8 @@ int check_file(int fd, int cf_inter, char *filename, int no_file_check)
 				ret =
 				    dataasciichk(NULL, buf, fsize, 0, &errmsg);
 			else if (Pattern == PATTERN_RANDOM) ;	/* no check for random */
+			else if (Pattern == PATTERN_STREAM)
+				ret = databinchk('s', buf, fsize, 0, &errmsg);
 			else if (Pattern == PATTERN_ALT)
 				ret = databinchk('a', buf, fsize, 0, &errmsg);
 			else if (Pattern == PATTERN_CHKER)
@@ -32,6 +32,9 @@
 *
 *               'r' - writes random integers
 *
+*               's' - writes a seeded pseudo random stream (see tst_rand_data.h),
+*                     which, unlike 'r', is file offset based and can be checked
+*
 * RETURN VALUE
 *       None
 *
@@ -33,11 +33,14 @@
 #include "config.h"
 #include "global.h"
 #include "tst_common.h"
+#include "tst_histogram.h"
 
 #ifdef HAVE_SYS_PRCTL_H
 # include <sys/prctl.h>
 #endif
 #include <limits.h>
+#include <sys/mman.h>
+#include <time.h>
 
 #define XFS_ERRTAG_MAX		17
 
@@ -130,6 +133,10 @@ typedef struct pathname {
 #define	MAXFSIZE	((1ULL << 63) - 1ULL)
 #define	MAXFSIZE32	((1ULL << 40) - 1ULL)
 
+/* per-op latencies in ns, up to ~68s with 1.5% precision */
+#define	LAT_MAX_NS	(1LL << 36)
+#define	LAT_SUB_BITS	6
+
 void allocsp_f(int, long);
 void attr_remove_f(int, long);
 void attr_set_f(int, long);
@@ -235,6 +242,16 @@ int no_xfs = 0;
 int no_xfs = 1;
 #endif
 sig_atomic_t should_stop = 0;
+int stats;			/* collect per-op latencies */
+int print_stats;
+int duration;			/* -t, seconds per process */
+char *csvfile;
+char *jsonfile;
+struct tst_histogram *op_lat;	/* latencies of this process */
+struct tst_histogram *total_lat;	/* merged over processes and loops */
+char *shared_lat;		/* per process slots for the children */
+size_t shared_lat_slot;
+double run_time;
 
 void add_to_flist(int, int, int);
 void append_pathname(pathname_t *, char *);
@@ -273,6 +290,10 @@ int rename_path(pathname_t *, pathname_t *);
 int rmdir_path(pathname_t *);
 void separate_pathname(pathname_t *, char *, pathname_t *);
 void show_ops(int, char *);
+void stats_collect(void);
+void stats_init(void);
+void stats_report(void);
+void stats_save(int);
 int stat64_path(pathname_t *, struct stat64 *);
 int symlink_path(const char *, pathname_t *);
 int truncate64_path(pathname_t *, off64_t);
@@ -311,13 +332,14 @@ int main(int argc, char **argv)
 	xfs_error_injection_t err_inj;
 #endif
 	struct sigaction action;
+	struct timespec run_start, run_end;
 
 	errrange = errtag = 0;
 	umask(0);
 	nops = ARRAY_SIZE(ops);
 	ops_end = &ops[nops];
 	myprog = argv[0];
-	while ((c = getopt(argc, argv, "cd:e:f:i:l:n:p:rs:vwzHSX")) != -1) {
+	while ((c = getopt(argc, argv, "cd:e:f:i:l:n:p:rs:t:vwzC:HJ:STX")) != -1) {
 		switch (c) {
 		case 'c':
 			/*Don't cleanup */
@@ -362,6 +384,14 @@ int main(int argc, char **argv)
 		case 's':
 			seed = strtoul(optarg, NULL, 0);
 			break;
+		case 't':
+			duration = atoi(optarg);
+			if (duration <= 0) {
+				fprintf(stderr, "invalid duration %s\n", optarg);
+				exit(1);
+			}
+			stats = print_stats = 1;
+			break;
 		case 'v':
 			verbose = 1;
 			break;
@@ -376,6 +406,17 @@ int main(int argc, char **argv)
 			printf("\n");
 			nousage = 1;
 			break;
+		case 'C':
+			csvfile = optarg;
+			stats = 1;
+			break;
+		case 'J':
+			jsonfile = optarg;
+			stats = 1;
+			break;
+		case 'T':
+			stats = print_stats = 1;
+			break;
 		case '?':
 			fprintf(stderr, "%s - invalid parameters\n", myprog);
 			/* fall through */
@@ -403,6 +444,9 @@ int main(int argc, char **argv)
 
 	make_freq_table();
 
+	if (stats)
+		stats_init();
+
 	while (((loopcntr <= loops) || (loops == 0)) && !should_stop) {
 		if (!dirname) {
 			/* no directory specified */
@@ -480,6 +524,9 @@ int main(int argc, char **argv)
 			close(fd);
 		unlink(buf);
 
+		if (shared_lat)
+			memset(shared_lat, 0, nproc * shared_lat_slot);
+		clock_gettime(CLOCK_MONOTONIC, &run_start);
 
 		if (nproc == 1) {
 			procid = 0;
@@ -508,6 +555,8 @@ int main(int argc, char **argv)
 #endif
 					procid = i;
 					doproc();
+					if (stats)
+						stats_save(i);
 					return 0;
 				}
 			}
@@ -522,6 +571,12 @@ int main(int argc, char **argv)
 					continue;
 			}
 		}
+
+		clock_gettime(CLOCK_MONOTONIC, &run_end);
+		run_time += (run_end.tv_sec - run_start.tv_sec) +
+			    (run_end.tv_nsec - run_start.tv_nsec) / 1e9;
+		if (stats)
+			stats_collect();
 #ifndef NO_XFS
 		if (errtag != 0) {
 			memset(&err_inj, 0, sizeof(err_inj));
@@ -552,6 +607,10 @@ int main(int argc, char **argv)
 		}
 		loopcntr++;
 	}
+
+	if (stats)
+		stats_report();
+
 	return 0;
 }
 
@@ -755,6 +814,7 @@ void doproc(void)
 	int opno;
 	int rval;
 	opdesc_t *p;
+	struct timespec start, end, deadline;
 
 	sprintf(buf, "p%x", procid);
 	(void)mkdir(buf, 0777);
@@ -768,12 +828,26 @@ void doproc(void)
 	srandom(seed);
 	if (namerand)
 		namerand = random();
-	for (opno = 0; opno < operations; opno++) {
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	deadline = end;
+	deadline.tv_sec += duration;
+	for (opno = 0; duration ? end.tv_sec < deadline.tv_sec ||
+	     (end.tv_sec == deadline.tv_sec && end.tv_nsec < deadline.tv_nsec) :
+	     opno < operations; opno++) {
 		p = &ops[freq_table[random() % freq_table_size]];
 		if ((unsigned long)p->func < 4096)
 			abort();
 
+		if (stats)
+			clock_gettime(CLOCK_MONOTONIC, &start);
 		p->func(opno, random());
+		if (stats) {
+			clock_gettime(CLOCK_MONOTONIC, &end);
+			tst_histogram_record(&op_lat[p - ops],
+					     (end.tv_sec - start.tv_sec) *
+					     1000000000LL + end.tv_nsec -
+					     start.tv_nsec);
+		}
 		/*
 		 * test for forced shutdown by stat'ing the test
 		 * directory.  If this stat returns EIO, assume
@@ -1301,6 +1375,191 @@ int stat64_path(pathname_t * name, struct stat64 *sbuf)
 	return rval;
 }
 
+void stats_init(void)
+{
+	int i;
+
+	op_lat = calloc(nops, sizeof(*op_lat));
+	total_lat = calloc(nops + 1, sizeof(*total_lat));
+	if (!op_lat || !total_lat) {
+		perror("calloc");
+		exit(1);
+	}
+
+	for (i = 0; i <= nops; i++) {
+		if ((i < nops && tst_histogram_init(&op_lat[i], LAT_MAX_NS,
+						    LAT_SUB_BITS)) ||
+		    tst_histogram_init(&total_lat[i], LAT_MAX_NS,
+				       LAT_SUB_BITS)) {
+			perror("tst_histogram_init");
+			exit(1);
+		}
+	}
+
+	if (nproc == 1)
+		return;
+
+	/* each child copies its histograms into its slot before exiting */
+	shared_lat_slot = nops * (sizeof(*op_lat) +
+				  op_lat[0].nbuckets * sizeof(uint64_t));
+	shared_lat = mmap(NULL, nproc * shared_lat_slot,
+			  PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS,
+			  -1, 0);
+	if (shared_lat == MAP_FAILED) {
+		perror("mmap");
+		exit(1);
+	}
+}
+
+void stats_save(int id)
+{
+	char *slot = shared_lat + id * shared_lat_slot;
+	struct tst_histogram *h = (struct tst_histogram *)slot;
+	uint64_t *counts = (uint64_t *)(slot + nops * sizeof(*h));
+	int i;
+
+	for (i = 0; i < nops; i++) {
+		h[i] = op_lat[i];
+		memcpy(counts + i * op_lat[i].nbuckets, op_lat[i].counts,
+		       op_lat[i].nbuckets * sizeof(uint64_t));
+	}
+}
+
+static void stats_merge(struct tst_histogram *h, int i)
+{
+	/* slots of killed children are left zeroed */
+	if (!h->count)
+		return;
+
+	tst_histogram_merge(&total_lat[i], h);
+	tst_histogram_merge(&total_lat[nops], h);
+}
+
+void stats_collect(void)
+{
+	struct tst_histogram *h, tmp;
+	uint64_t *counts;
+	int i, j;
+
+	if (nproc == 1) {
+		for (i = 0; i < nops; i++) {
+			stats_merge(&op_lat[i], i);
+			tst_histogram_reset(&op_lat[i]);
+		}
+		return;
+	}
+
+	for (j = 0; j < nproc; j++) {
+		h = (struct tst_histogram *)(shared_lat + j * shared_lat_slot);
+		counts = (uint64_t *)(h + nops);
+		for (i = 0; i < nops; i++) {
+			tmp = h[i];
+			tmp.counts = counts + i * op_lat[i].nbuckets;
+			stats_merge(&tmp, i);
+		}
+	}
+}
+
+static void stats_write(FILE *f, int json, const char *name,
+			struct tst_histogram *h, int last)
+{
+	double rate = run_time > 0 ? h->count / run_time : 0;
+
+	if (!json) {
+		fprintf(f, "%s,%llu,%.1f,%lld,%.0f,%lld,%lld,%lld,%lld,%lld\n",
+			name, (unsigned long long)h->count, rate, h->min,
+			tst_histogram_mean(h),
+			tst_histogram_percentile(h, 50),
+			tst_histogram_percentile(h, 90),
+			tst_histogram_percentile(h, 99),
+			tst_histogram_percentile(h, 99.9), h->max);
+		return;
+	}
+
+	fprintf(f, "  \"%s\": {\"count\": %llu, \"ops_per_sec\": %.1f, "
+		"\"min_ns\": %lld, \"mean_ns\": %.0f, \"p50_ns\": %lld, "
+		"\"p90_ns\": %lld, \"p99_ns\": %lld, \"p999_ns\": %lld, "
+		"\"max_ns\": %lld}%s\n",
+		name, (unsigned long long)h->count, rate, h->min,
+		tst_histogram_mean(h), tst_histogram_percentile(h, 50),
+		tst_histogram_percentile(h, 90),
+		tst_histogram_percentile(h, 99),
+		tst_histogram_percentile(h, 99.9), h->max, last ? "" : ",");
+}
+
+static void stats_file(const char *path, int json)
+{
+	FILE *f = fopen(path, "w");
+	int i, last;
+
+	if (!f) {
+		perror(path);
+		exit(1);
+	}
+
+	if (json) {
+		fprintf(f, "{\n \"seed\": %lu,\n \"nproc\": %d,\n"
+			" \"run_time_s\": %.3f,\n \"ops\": {\n",
+			seed, nproc, run_time);
+	} else {
+		fprintf(f, "op,count,ops_per_sec,min_ns,mean_ns,p50_ns,p90_ns,"
+			"p99_ns,p999_ns,max_ns\n");
+	}
+
+	for (last = nops - 1; last > 0 && !total_lat[last].count; last--)
+		;
+
+	for (i = 0; i < nops; i++) {
+		if (total_lat[i].count)
+			stats_write(f, json, ops[i].name, &total_lat[i],
+				    i == last);
+	}
+
+	if (json)
+		fprintf(f, " },\n");
+
+	stats_write(f, json, "all", &total_lat[nops], 1);
+
+	if (json)
+		fprintf(f, "}\n");
+
+	if (fclose(f)) {
+		perror(path);
+		exit(1);
+	}
+}
+
+void stats_report(void)
+{
+	struct tst_histogram *h;
+	int i;
+
+	if (print_stats) {
+		printf("%-12s %10s %10s %10s %10s %10s %10s %10s\n", "op",
+		       "count", "ops/s", "mean_us", "p50_us", "p99_us",
+		       "p99.9_us", "max_us");
+		for (i = 0; i <= nops; i++) {
+			h = &total_lat[i];
+			if (!h->count)
+				continue;
+			printf("%-12s %10llu %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+			       i < nops ? ops[i].name : "all",
+			       (unsigned long long)h->count,
+			       run_time > 0 ? h->count / run_time : 0,
+			       tst_histogram_mean(h) / 1000,
+			       tst_histogram_percentile(h, 50) / 1000.0,
+			       tst_histogram_percentile(h, 99) / 1000.0,
+			       tst_histogram_percentile(h, 99.9) / 1000.0,
+			       h->max / 1000.0);
+		}
+	}
+
+	if (csvfile)
+		stats_file(csvfile, 0);
+	if (jsonfile)
+		stats_file(jsonfile, 1);
+}
+
 int symlink_path(const char *name1, pathname_t * name)
 {
 	char buf[MAXNAMELEN];
@@ -1366,7 +1625,8 @@ void usage(void)
 	printf
 	    ("       %s [-c][-d dir][-e errtg][-f op_name=freq][-l loops][-n nops]\n",
 	     myprog);
-	printf("          [-p nproc][-r len][-s seed][-v][-w][-z][-S]\n");
+	printf("          [-p nproc][-r len][-s seed][-t secs][-v][-w][-z][-S][-T]\n");
+	printf("          [-C csvfile][-J jsonfile]\n");
 	printf("where\n");
 	printf
 	    ("   -c               specifies not to remove files(cleanup) after execution\n");
@@ -1387,13 +1647,19 @@ void usage(void)
 	printf("   -r               specifies random name padding\n");
 	printf
 	    ("   -s seed          specifies the seed for the random generator (default random)\n");
+	printf
+	    ("   -t secs          run for secs seconds instead of -n operations, implies -T\n");
 	printf("   -v               specifies verbose mode\n");
 	printf
 	    ("   -w               zeros frequencies of non-write operations\n");
 	printf("   -z               zeros frequencies of all operations\n");
 	printf
 	    ("   -S               prints the table of operations (omitting zero frequency)\n");
+	printf("   -C csvfile       writes per operation latencies into csvfile\n");
 	printf("   -H               prints usage and exits\n");
+	printf("   -J jsonfile      writes per operation latencies into jsonfile\n");
+	printf
+	    ("   -T               prints per operation counts, rates and latencies\n");
 	printf
 	    ("   -X               don't do anything XFS specific (default with -DNO_XFS)\n");
 }
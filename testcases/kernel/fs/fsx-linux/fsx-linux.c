@@ -35,6 +35,10 @@
  * $FreeBSD: src/tools/regression/fsx/fsx.c,v 1.1 2001/12/20 04:15:57 jkh Exp $
  *
  *	Add multi-file testing feature -- Zach Brown <zab@clusterfs.com>
+ *
+ *	Add fallocate, punch hole and copy_file_range operations, io_uring
+ *	reads and writes, parallel processes and a binary operation log that
+ *	can be replayed.
  */
 
 #include <sys/types.h>
@@ -59,6 +63,21 @@
 #include <unistd.h>
 #include <stdarg.h>
 #include <errno.h>
+#include <stdint.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+
+#include "config.h"
+#ifdef HAVE_LINUX_IO_URING_H
+#include <linux/io_uring.h>
+#endif
+
+#ifndef FALLOC_FL_KEEP_SIZE
+#define FALLOC_FL_KEEP_SIZE	0x01
+#endif
+#ifndef FALLOC_FL_PUNCH_HOLE
+#define FALLOC_FL_PUNCH_HOLE	0x02
+#endif
 
 /*
  *	A log entry is an operation and a bunch of arguments.
@@ -72,10 +91,44 @@ struct log_entry {
 
 #define	LOGSIZE	1000
 
+/* Exit status ltp-pan reports as TCONF */
+#define EXIT_TCONF	32
+
 struct log_entry oplog[LOGSIZE];	/* the log */
 int logptr = 0;			/* current position in log */
 int logcount = 0;		/* total ops */
 
+/*
+ *	The binary log (-B) records every operation, the replay (-X) executes
+ *	the operations from it instead of generating random ones. The header
+ *	carries everything that affects the data written into the file.
+ */
+
+#define BINLOG_MAGIC	"FSXBLOG1"
+#define BINLOG_LITE	0x01
+#define BINLOG_URING	0x02
+
+struct binlog_header {
+	char magic[8];
+	uint32_t seed;
+	uint32_t maxfilelen;
+	uint32_t maxoplen;
+	uint32_t flags;
+};
+
+struct binlog_entry {
+	uint32_t opnum;		/* value of testcalls */
+	uint16_t operation;
+	uint16_t tf;		/* index of the test file path */
+	uint32_t args[3];
+};
+
+FILE *binlogf = NULL;		/* -B flag */
+FILE *replayf = NULL;		/* -X flag */
+int replaying = 0;
+unsigned replay_tf = 0;		/* test file used by the replayed op */
+unsigned cur_tf = 0;		/* test file used by the current op */
+
 /*
  *	Define operations
  */
@@ -87,6 +140,9 @@ int logcount = 0;		/* total ops */
 #define OP_MAPREAD	5
 #define OP_MAPWRITE	6
 #define OP_SKIPPED	7
+#define OP_FALLOCATE	8
+#define OP_PUNCH_HOLE	9
+#define OP_COPY_RANGE	10
 
 int page_size;
 int page_mask;
@@ -124,6 +180,16 @@ int randomoplen = 1;		/* -O flag disables it */
 int seed = 1;			/* -S flag */
 int mapped_writes = 1;		/* -W flag disables */
 int mapped_reads = 1;		/* -R flag disables it */
+int fallocate_calls = 0;	/* -F flag */
+int punch_hole_calls = 0;	/* -H flag */
+int copy_range_calls = 0;	/* -C flag */
+int uring_io = 0;		/* -U flag */
+int uring_fallback = 0;		/* -U given but io_uring not available */
+int nr_procs = 1;		/* -j flag */
+char *binlogpath = NULL;	/* -B flag */
+char *replaypath = NULL;	/* -X flag */
+int extra_ops[3];		/* enabled fallocate/punch/copy operations */
+int nr_extra_ops = 0;
 int fsxgoodfd = 0;
 FILE *fsxlogf = NULL;
 int badoff = -1;
@@ -182,6 +248,20 @@ void log4(int operation, int arg0, int arg1, int arg2, struct timeval *tv)
 	logcount++;
 	if (logptr >= LOGSIZE)
 		logptr = 0;
+
+	if (binlogf) {
+		struct binlog_entry be = {
+			.opnum = testcalls,
+			.operation = operation,
+			.tf = cur_tf,
+			.args = {arg0, arg1, arg2},
+		};
+
+		if (fwrite(&be, sizeof(be), 1, binlogf) != 1) {
+			prterr("log4: binary log write");
+			exit(93);
+		}
+	}
 }
 
 void logdump(void)
@@ -249,6 +329,31 @@ void logdump(void)
 			    badoff < lp->args[! !down])
 				prt("\t******WWWW");
 			break;
+		case OP_FALLOCATE:
+			prt("FALLOC   0x%x thru 0x%x (0x%x bytes)%s",
+			    lp->args[0], lp->args[0] + lp->args[1] - 1,
+			    lp->args[1], lp->args[2] ? " KEEP_SIZE" : "");
+			if (badoff >= lp->args[0] && badoff <
+			    lp->args[0] + lp->args[1])
+				prt("\t******FFFF");
+			break;
+		case OP_PUNCH_HOLE:
+			prt("PUNCH    0x%x thru 0x%x (0x%x bytes)",
+			    lp->args[0], lp->args[0] + lp->args[1] - 1,
+			    lp->args[1]);
+			if (badoff >= lp->args[0] && badoff <
+			    lp->args[0] + lp->args[1])
+				prt("\t******PPPP");
+			break;
+		case OP_COPY_RANGE:
+			prt("COPY     0x%x thru 0x%x (0x%x bytes) to 0x%x thru 0x%x",
+			    lp->args[0], lp->args[0] + lp->args[2] - 1,
+			    lp->args[2], lp->args[1],
+			    lp->args[1] + lp->args[2] - 1);
+			if (badoff >= lp->args[1] && badoff <
+			    lp->args[1] + lp->args[2])
+				prt("\t******CCCC");
+			break;
 		case OP_CLOSEOPEN:
 			prt("CLOSE/OPEN");
 			break;
@@ -387,6 +492,11 @@ struct test_file *get_tf(void)
 {
 	unsigned index = 0;
 
+	if (replaying) {
+		cur_tf = replay_tf % num_test_files;
+		return &test_files[cur_tf];
+	}
+
 	switch (fd_policy) {
 	case FD_ROTATE:
 		index = fd_last++;
@@ -402,7 +512,8 @@ struct test_file *get_tf(void)
 		exit(1);
 		break;
 	}
-	return &test_files[index % num_test_files];
+	cur_tf = index % num_test_files;
+	return &test_files[cur_tf];
 }
 
 void assign_fd_policy(char *policy)
@@ -507,6 +618,53 @@ void check_trunc_hack(void)
 	ftruncate(fd, 0);
 }
 
+ssize_t fsx_copy_file_range(int fd, loff_t *off_in, loff_t *off_out,
+			    size_t len)
+{
+#ifdef HAVE_COPY_FILE_RANGE
+	return copy_file_range(fd, off_in, fd, off_out, len, 0);
+#elif defined(__NR_copy_file_range)
+	return syscall(__NR_copy_file_range, fd, off_in, fd, off_out, len, 0);
+#else
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+/*
+ *	Disable the requested operations the filesystem does not support and
+ *	build the table of the enabled ones for test().
+ */
+void check_extra_ops(void)
+{
+	int fd = test_files[0].fd;
+	loff_t off_in = 0, off_out = 1;
+
+	if (fallocate_calls && fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, 1) == -1) {
+		prt("fallocate not supported (%s), disabled\n", strerror(errno));
+		fallocate_calls = 0;
+	}
+	if (punch_hole_calls &&
+	    fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, 0, 1)) {
+		prt("punch hole not supported (%s), disabled\n",
+		    strerror(errno));
+		punch_hole_calls = 0;
+	}
+	if (copy_range_calls &&
+	    fsx_copy_file_range(fd, &off_in, &off_out, 1) == -1) {
+		prt("copy_file_range not supported (%s), disabled\n",
+		    strerror(errno));
+		copy_range_calls = 0;
+	}
+
+	if (fallocate_calls)
+		extra_ops[nr_extra_ops++] = OP_FALLOCATE;
+	if (punch_hole_calls)
+		extra_ops[nr_extra_ops++] = OP_PUNCH_HOLE;
+	if (copy_range_calls)
+		extra_ops[nr_extra_ops++] = OP_COPY_RANGE;
+}
+
 static char *tf_buf = NULL;
 static int max_tf_len = 0;
 
@@ -560,6 +718,9 @@ output_line(struct test_file *tf, int op, unsigned offset,
 		[OP_TRUNCATE] = "trunc from",
 		[OP_MAPREAD] = "mapread",
 		[OP_MAPWRITE] = "mapwrite",
+		[OP_FALLOCATE] = "falloc",
+		[OP_PUNCH_HOLE] = "punch",
+		[OP_COPY_RANGE] = "copy to",
 	};
 
 	/* W. */
@@ -581,10 +742,139 @@ output_line(struct test_file *tf, int op, unsigned offset,
 	    offset + size - 1, size);
 }
 
+#ifdef HAVE_LINUX_IO_URING_H
+/*
+ *	Minimal io_uring with a single entry, the reads and writes are
+ *	submitted and waited for one by one.
+ */
+struct {
+	int fd;
+	unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+	unsigned *cq_head, *cq_tail, *cq_mask;
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+} ring = {.fd = -1};
+
+void *uring_mmap(size_t size, off_t offset)
+{
+	void *p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+		       MAP_SHARED | MAP_POPULATE, ring.fd, offset);
+
+	if (p == MAP_FAILED) {
+		prterr("uring_init: mmap");
+		exit(87);
+	}
+	return p;
+}
+
+void uring_init(void)
+{
+	struct io_uring_params p;
+	char *sq, *cq;
+
+	memset(&p, 0, sizeof(p));
+	ring.fd = syscall(__NR_io_uring_setup, 1, &p);
+	if (ring.fd < 0) {
+		prterr("uring_init: io_uring_setup");
+		prt("io_uring not available, using read() and write()\n");
+		uring_io = 0;
+		uring_fallback = 1;
+		return;
+	}
+
+	sq = uring_mmap(p.sq_off.array + p.sq_entries * sizeof(unsigned),
+			IORING_OFF_SQ_RING);
+	cq = uring_mmap(p.cq_off.cqes +
+			p.cq_entries * sizeof(struct io_uring_cqe),
+			IORING_OFF_CQ_RING);
+	ring.sqes = uring_mmap(p.sq_entries * sizeof(struct io_uring_sqe),
+			       IORING_OFF_SQES);
+
+	ring.sq_head = (unsigned *)(sq + p.sq_off.head);
+	ring.sq_tail = (unsigned *)(sq + p.sq_off.tail);
+	ring.sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+	ring.sq_array = (unsigned *)(sq + p.sq_off.array);
+	ring.cq_head = (unsigned *)(cq + p.cq_off.head);
+	ring.cq_tail = (unsigned *)(cq + p.cq_off.tail);
+	ring.cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+	ring.cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+}
+
+/*
+ *	Returns the number of bytes transferred, or -1 with errno set.
+ */
+ssize_t uring_rw(int opcode, int fd, char *buf, unsigned size, off_t offset)
+{
+	struct iovec iov = {.iov_base = buf, .iov_len = size };
+	struct io_uring_sqe *sqe;
+	struct io_uring_cqe *cqe;
+	unsigned tail, head;
+	int res;
+
+	tail = *ring.sq_tail;
+	sqe = &ring.sqes[tail & *ring.sq_mask];
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = opcode;
+	sqe->fd = fd;
+	sqe->addr = (unsigned long)&iov;
+	sqe->len = 1;
+	sqe->off = offset;
+	ring.sq_array[tail & *ring.sq_mask] = tail & *ring.sq_mask;
+	__atomic_store_n(ring.sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+	do {
+		res = syscall(__NR_io_uring_enter, ring.fd, 1, 1,
+			      IORING_ENTER_GETEVENTS, NULL, 0);
+	} while (res < 0 && errno == EINTR);
+	if (res < 0)
+		return -1;
+
+	head = *ring.cq_head;
+	if (head == __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE)) {
+		errno = EIO;
+		return -1;
+	}
+	cqe = &ring.cqes[head & *ring.cq_mask];
+	res = cqe->res;
+	__atomic_store_n(ring.cq_head, head + 1, __ATOMIC_RELEASE);
+
+	if (res < 0) {
+		errno = -res;
+		return -1;
+	}
+	return res;
+}
+#endif
+
+ssize_t do_pread(int fd, char *buf, unsigned size, off_t offset)
+{
+#ifdef HAVE_LINUX_IO_URING_H
+	if (uring_io)
+		return uring_rw(IORING_OP_READV, fd, buf, size, offset);
+#endif
+	if (lseek(fd, offset, SEEK_SET) == (off_t) - 1) {
+		prterr("doread: lseek");
+		report_failure(140);
+	}
+	return read(fd, buf, size);
+}
+
+ssize_t do_pwrite(int fd, char *buf, unsigned size, off_t offset)
+{
+#ifdef HAVE_LINUX_IO_URING_H
+	if (uring_io)
+		return uring_rw(IORING_OP_WRITEV, fd, buf, size, offset);
+#endif
+	if (lseek(fd, offset, SEEK_SET) == (off_t) - 1) {
+		prterr("dowrite: lseek");
+		report_failure(150);
+	}
+	return write(fd, buf, size);
+}
+
 void doread(unsigned offset, unsigned size)
 {
 	struct timeval t;
-	off_t ret;
 	unsigned iret;
 	struct test_file *tf = get_tf();
 	int fd = tf->fd;
@@ -611,12 +901,7 @@ void doread(unsigned offset, unsigned size)
 
 	output_line(tf, OP_READ, offset, size, &t);
 
-	ret = lseek(fd, (off_t) offset, SEEK_SET);
-	if (ret == (off_t) - 1) {
-		prterr("doread: lseek");
-		report_failure(140);
-	}
-	iret = read(fd, temp_buf, size);
+	iret = do_pread(fd, temp_buf, size, offset);
 	if (!quiet && (debug > 1 &&
 		       (monitorstart == -1 ||
 			(offset + size > monitorstart &&
@@ -717,7 +1002,6 @@ void gendata(char *original_buf, char *good_buf, unsigned offset, unsigned size)
 void dowrite(unsigned offset, unsigned size)
 {
 	struct timeval t;
-	off_t ret;
 	unsigned iret;
 	struct test_file *tf = get_tf();
 	int fd = tf->fd;
@@ -749,12 +1033,7 @@ void dowrite(unsigned offset, unsigned size)
 
 	output_line(tf, OP_WRITE, offset, size, &t);
 
-	ret = lseek(fd, (off_t) offset, SEEK_SET);
-	if (ret == (off_t) - 1) {
-		prterr("dowrite: lseek");
-		report_failure(150);
-	}
-	iret = write(fd, good_buf + offset, size);
+	iret = do_pwrite(fd, good_buf + offset, size, offset);
 	if (!quiet && (debug > 1 &&
 		       (monitorstart == -1 ||
 			(offset + size > monitorstart &&
@@ -910,6 +1189,144 @@ void dotruncate(unsigned size)
 	}
 }
 
+void dofallocate(unsigned offset, unsigned size, int keep_size)
+{
+	struct timeval t;
+	struct test_file *tf = get_tf();
+	int fd = tf->fd;
+
+	offset -= offset % writebdy;
+	gettimeofday(&t, NULL);
+	if (size == 0) {
+		if (!quiet && testcalls > simulatedopcount)
+			prt("skipping zero size fallocate\n");
+		log4(OP_SKIPPED, OP_FALLOCATE, offset, size, &t);
+		return;
+	}
+
+	log4(OP_FALLOCATE, offset, size, keep_size, &t);
+
+	if (!keep_size && file_size < offset + size) {
+		memset(good_buf + file_size, '\0', offset + size - file_size);
+		file_size = offset + size;
+		if (lite) {
+			warn("Lite file size bug in fsx!");
+			report_failure(164);
+		}
+	}
+
+	if (testcalls <= simulatedopcount)
+		return;
+
+	output_line(tf, OP_FALLOCATE, offset, size, &t);
+
+	if (fallocate(fd, keep_size ? FALLOC_FL_KEEP_SIZE : 0,
+		      (off_t) offset, (off_t) size) == -1) {
+		prt("fallocate: %x to %x\n", offset, size);
+		prterr("dofallocate: fallocate");
+		report_failure(165);
+	}
+	if (!quiet && debug > 1) {
+		gettimeofday(&t, NULL);
+		prt("       %lu.%06lu fallocate done\n", t.tv_sec, t.tv_usec);
+	}
+}
+
+void dopunchhole(unsigned offset, unsigned size)
+{
+	struct timeval t;
+	struct test_file *tf = get_tf();
+	int fd = tf->fd;
+
+	offset -= offset % writebdy;
+	gettimeofday(&t, NULL);
+	if (size == 0 || offset + size > file_size) {
+		if (!quiet && testcalls > simulatedopcount)
+			prt("skipping zero size or past end of file punch\n");
+		log4(OP_SKIPPED, OP_PUNCH_HOLE, offset, size, &t);
+		return;
+	}
+
+	log4(OP_PUNCH_HOLE, offset, size, 0, &t);
+
+	memset(good_buf + offset, '\0', size);
+
+	if (testcalls <= simulatedopcount)
+		return;
+
+	output_line(tf, OP_PUNCH_HOLE, offset, size, &t);
+
+	if (fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+		      (off_t) offset, (off_t) size) == -1) {
+		prt("punch hole: %x to %x\n", offset, size);
+		prterr("dopunchhole: fallocate");
+		report_failure(166);
+	}
+	if (!quiet && debug > 1) {
+		gettimeofday(&t, NULL);
+		prt("       %lu.%06lu punch hole done\n", t.tv_sec, t.tv_usec);
+	}
+}
+
+void docopyrange(unsigned src, unsigned dst, unsigned size)
+{
+	struct timeval t;
+	loff_t off_in, off_out;
+	ssize_t ret;
+	unsigned left;
+	struct test_file *tf = get_tf();
+	int fd = tf->fd;
+
+	src -= src % readbdy;
+	dst -= dst % writebdy;
+	gettimeofday(&t, NULL);
+	/* copies within a single file must not overlap */
+	if (size == 0 || src + size > file_size ||
+	    (src < dst + size && dst < src + size)) {
+		if (!quiet && testcalls > simulatedopcount)
+			prt("skipping zero size, overlapping or past end of "
+			    "file copy\n");
+		log4(OP_SKIPPED, OP_COPY_RANGE, src, size, &t);
+		return;
+	}
+
+	log4(OP_COPY_RANGE, src, dst, size, &t);
+
+	if (file_size < dst + size) {
+		if (file_size < dst)
+			memset(good_buf + file_size, '\0', dst - file_size);
+		file_size = dst + size;
+		if (lite) {
+			warn("Lite file size bug in fsx!");
+			report_failure(167);
+		}
+	}
+	memcpy(good_buf + dst, good_buf + src, size);
+
+	if (testcalls <= simulatedopcount)
+		return;
+
+	output_line(tf, OP_COPY_RANGE, dst, size, &t);
+
+	off_in = src;
+	off_out = dst;
+	for (left = size; left > 0; left -= ret) {
+		ret = fsx_copy_file_range(fd, &off_in, &off_out, left);
+		if (ret <= 0) {
+			if (ret == -1)
+				prterr("docopyrange: copy_file_range");
+			else
+				prt("short copy: 0x%x bytes instead of 0x%x\n",
+				    size - left, size);
+			report_failure(168);
+		}
+	}
+	if (!quiet && debug > 1) {
+		gettimeofday(&t, NULL);
+		prt("       %lu.%06lu copy done\n", t.tv_sec, t.tv_usec);
+	}
+}
+
 void writefileimage(void)
 {
 	ssize_t iret;
@@ -968,12 +1385,47 @@ void docloseopen(void)
 	}
 }
 
+void doextraop(int op)
+{
+	unsigned long offset = random();
+	unsigned long size = maxoplen;
+	unsigned long dst;
+
+	if (randomoplen)
+		size = random() % (maxoplen + 1);
+
+	switch (op) {
+	case OP_FALLOCATE:
+		offset %= maxfilelen;
+		if (offset + size > maxfilelen)
+			size = maxfilelen - offset;
+		dofallocate(offset, size, lite ? 1 : random() % 2);
+		break;
+	case OP_PUNCH_HOLE:
+		offset = file_size ? offset % file_size : 0;
+		if ((off_t)(offset + size) > file_size)
+			size = file_size - offset;
+		dopunchhole(offset, size);
+		break;
+	case OP_COPY_RANGE:
+		offset = file_size ? offset % file_size : 0;
+		if ((off_t)(offset + size) > file_size)
+			size = file_size - offset;
+		dst = random() % maxfilelen;
+		if (dst + size > maxfilelen)
+			size = maxfilelen - dst;
+		docopyrange(offset, dst, size);
+		break;
+	}
+}
+
 void test(void)
 {
 	unsigned long offset;
 	unsigned long size = maxoplen;
 	unsigned long rv = random();
-	unsigned long op = rv % (3 + !lite + mapped_writes);
+	unsigned long nr_base_ops = 3 + !lite + mapped_writes;
+	unsigned long op = rv % (nr_base_ops + nr_extra_ops);
 
 	/* turn off the map read if necessary */
 
@@ -997,8 +1449,11 @@ void test(void)
 	 * MAPREAD:     op = 2
 	 * TRUNCATE:    op = 3
 	 * MAPWRITE:    op = 3 or 4
+	 * FALLOCATE, PUNCH_HOLE, COPY_RANGE: op >= nr_base_ops when enabled
 	 */
-	if (lite ? 0 : op == 3 && (style & 1) == 0)	/* vanilla truncate? */
+	if (op >= nr_base_ops)
+		doextraop(extra_ops[op - nr_base_ops]);
+	else if (lite ? 0 : op == 3 && (style & 1) == 0)	/* vanilla truncate? */
 		dotruncate(random() % maxfilelen);
 	else {
 		if (randomoplen)
@@ -1035,6 +1490,183 @@ void test(void)
 		docloseopen();
 }
 
+/*
+ *	Executes the operations recorded in a binary log (-X), the -b, -D and
+ *	-N flags refer to the recorded operation numbers, which allows to
+ *	bisect a failure by replaying shorter prefixes of the log.
+ */
+void replay(void)
+{
+	struct binlog_entry be;
+	struct timeval t;
+
+	replaying = 1;
+
+	while (fread(&be, sizeof(be), 1, replayf) == 1) {
+		if (numops != -1 && be.opnum > numops)
+			break;
+
+		if (simulatedopcount > 0 && testcalls == simulatedopcount &&
+		    be.opnum > testcalls)
+			writefileimage();
+
+		testcalls = be.opnum;
+		replay_tf = be.tf;
+
+		if (debugstart > 0 && testcalls >= debugstart)
+			debug = 1;
+
+		switch (be.operation) {
+		case OP_READ:
+			doread(be.args[0], be.args[1]);
+			break;
+		case OP_WRITE:
+			dowrite(be.args[0], be.args[1]);
+			break;
+		case OP_MAPREAD:
+			domapread(be.args[0], be.args[1]);
+			break;
+		case OP_MAPWRITE:
+			domapwrite(be.args[0], be.args[1]);
+			break;
+		case OP_TRUNCATE:
+			dotruncate(be.args[0]);
+			break;
+		case OP_FALLOCATE:
+			dofallocate(be.args[0], be.args[1], be.args[2]);
+			break;
+		case OP_PUNCH_HOLE:
+			dopunchhole(be.args[0], be.args[1]);
+			break;
+		case OP_COPY_RANGE:
+			docopyrange(be.args[0], be.args[1], be.args[2]);
+			break;
+		case OP_CLOSEOPEN:
+			docloseopen();
+			continue;
+		case OP_SKIPPED:
+			gettimeofday(&t, NULL);
+			log4(OP_SKIPPED, be.args[0], be.args[1], be.args[2],
+			     &t);
+			continue;
+		default:
+			prt("replay: bogus log entry (operation code = %d)\n",
+			    be.operation);
+			report_failure(85);
+		}
+
+		if (sizechecks && testcalls > simulatedopcount)
+			check_size();
+	}
+
+	if (ferror(replayf)) {
+		prterr("replay: read");
+		exit(85);
+	}
+}
+
+void read_replay_header(void)
+{
+	struct binlog_header bh;
+
+	replayf = fopen(replaypath, "r");
+	if (replayf == NULL) {
+		prterr(replaypath);
+		exit(85);
+	}
+	if (fread(&bh, sizeof(bh), 1, replayf) != 1 ||
+	    memcmp(bh.magic, BINLOG_MAGIC, sizeof(bh.magic))) {
+		prt("%s: not a fsx binary log\n", replaypath);
+		exit(85);
+	}
+
+	seed = bh.seed;
+	maxfilelen = bh.maxfilelen;
+	maxoplen = bh.maxoplen;
+	lite = !!(bh.flags & BINLOG_LITE);
+	uring_io = !!(bh.flags & BINLOG_URING);
+}
+
+void write_binlog_header(void)
+{
+	struct binlog_header bh = {
+		.magic = BINLOG_MAGIC,
+		.seed = seed,
+		.maxfilelen = maxfilelen,
+		.maxoplen = maxoplen,
+		.flags = (lite ? BINLOG_LITE : 0) | (uring_io ? BINLOG_URING : 0),
+	};
+
+	binlogf = fopen(binlogpath, "w");
+	if (binlogf == NULL) {
+		prterr(binlogpath);
+		exit(93);
+	}
+	if (fwrite(&bh, sizeof(bh), 1, binlogf) != 1) {
+		prterr("binary log header write");
+		exit(93);
+	}
+}
+
+char *suffix_path(char *path, int i)
+{
+	char *ret;
+
+	if (asprintf(&ret, "%s.%d", path, i) < 0) {
+		prterr("asprintf");
+		exit(84);
+	}
+	return ret;
+}
+
+/*
+ *	Runs nr_procs independent copies of fsx, each one on its own set of
+ *	files with ".N" suffix and with seed + N. Only the children return,
+ *	the parent exits with the status of the first failed child, or with
+ *	TCONF if a child could not use io_uring.
+ */
+void fork_procs(char **argv, int argc)
+{
+	int i, j, status, ret = 0, conf = 0;
+	pid_t pid;
+
+	fflush(stdout);
+
+	for (i = 0; i < nr_procs; i++) {
+		pid = fork();
+		if (pid == -1) {
+			prterr("fork");
+			exit(84);
+		}
+		if (pid)
+			continue;
+
+		for (j = 0; j < argc; j++)
+			argv[j] = suffix_path(argv[j], i);
+		if (binlogpath)
+			binlogpath = suffix_path(binlogpath, i);
+		if (replaypath)
+			replaypath = suffix_path(replaypath, i);
+		seed += i;
+		return;
+	}
+
+	while ((pid = wait(&status)) > 0) {
+		if (WIFEXITED(status) && !WEXITSTATUS(status))
+			continue;
+		if (WIFEXITED(status) && WEXITSTATUS(status) == EXIT_TCONF) {
+			conf = 1;
+			continue;
+		}
+		prt("fsx process %d failed with status 0x%x\n", pid, status);
+		if (!ret)
+			ret = WIFEXITED(status) ? WEXITSTATUS(status) :
+			      128 + WTERMSIG(status);
+	}
+
+	exit(ret ? ret : (conf ? EXIT_TCONF : 0));
+}
+
 void cleanup(int sig)
 {
 	if (sig)
@@ -1046,13 +1678,14 @@ void cleanup(int sig)
 void usage(void)
 {
 	fprintf(stdout, "usage: %s",
-		"fsx [-dnqLOW] [-b opnum] [-c Prob] [-l flen] [-m "
+		"fsx [-dnqCFHLOUW] [-b opnum] [-c Prob] [-j procs] [-l flen] [-m "
 		"start:end] [-o oplen] [-p progressinterval] [-r readbdy] [-s style] [-t "
-		"truncbdy] [-w writebdy] [-D startingop] [-N numops] [-P dirpath] [-S seed] "
-		"[ -I random|rotate ] fname [additional paths to fname..]\n"
+		"truncbdy] [-w writebdy] [-B binlog] [-D startingop] [-N numops] [-P dirpath] [-S seed] "
+		"[-X binlog] [ -I random|rotate ] fname [additional paths to fname..]\n"
 		"	-b opnum: beginning operation number (default 1)\n"
 		"	-c P: 1 in P chance of file close+open at each op (default infinity)\n"
 		"	-d: debug output for all operations [-d -d = more debugging]\n"
+		"	-j procs: run procs independent processes, each on fname.N with seed + N\n"
 		"	-l flen: the upper bound on file size (default 262144)\n"
 		"	-m start:end: monitor (print debug) specified byte range (default 0:infinity)\n"
 		"	-n: no verifications of file size\n"
@@ -1063,13 +1696,21 @@ void usage(void)
 		"	-s style: 1 gives smaller truncates (default 0)\n"
 		"	-t truncbdy: 4096 would make truncates page aligned (default 1)\n"
 		"	-w writebdy: 4096 would make writes page aligned (default 1)\n"
+		"	-B binlog: record all operations into binary log file binlog\n"
+		"	-C: copy_file_range operations ENabled\n"
 		"	-D startingop: debug output starting at specified operation\n"
+		"	-F: fallocate operations ENabled\n"
+		"	-H: punch hole operations ENabled\n"
 		"	-L: fsxLite - no file creations & no file size changes\n"
 		"	-N numops: total # operations to do (default infinity)\n"
 		"	-O: use oplen (see -o flag) for every op (default random)\n"
 		"	-P: save .fsxlog and .fsxgood files in dirpath (default ./)\n"
 		"	-S seed: for random # generator (default 1) 0 gets timestamp\n"
+		"	-U: use io_uring for read() and write() operations if available,\n"
+		"	    exits with TCONF (32) after the run otherwise\n"
 		"	-W: mapped write operations DISabled\n"
+		"	-X binlog: replay operations from binary log instead of random ones,\n"
+		"	    -b, -D and -N refer to the recorded operation numbers\n"
 		"	-R: read() system calls only (mapped reads disabled)\n"
 		"	-I: When multiple paths to the file are given each operation uses\n"
 		"	    a different path.  Iterate through them in order with 'rotate'\n"
@@ -1125,7 +1766,7 @@ int main(int argc, char **argv)
 	setvbuf(stdout, NULL, _IOLBF, 0);	/* line buffered stdout */
 
 	while ((ch = getopt(argc, argv,
-			    "b:c:dl:m:no:p:qr:s:t:w:D:I:LN:OP:RS:W"))
+			    "b:c:dj:l:m:no:p:qr:s:t:w:B:CD:FHI:LN:OP:RS:UWX:"))
 	       != EOF)
 		switch (ch) {
 		case 'b':
@@ -1149,6 +1790,11 @@ int main(int argc, char **argv)
 		case 'd':
 			debug++;
 			break;
+		case 'j':
+			nr_procs = getnum(optarg, &endp);
+			if (nr_procs <= 0)
+				usage();
+			break;
 		case 'l':
 			maxfilelen = getnum(optarg, &endp);
 			if (maxfilelen <= 0)
@@ -1202,6 +1848,18 @@ int main(int argc, char **argv)
 			if (writebdy <= 0)
 				usage();
 			break;
+		case 'B':
+			binlogpath = optarg;
+			break;
+		case 'C':
+			copy_range_calls = 1;
+			break;
+		case 'F':
+			fallocate_calls = 1;
+			break;
+		case 'H':
+			punch_hole_calls = 1;
+			break;
 		case 'D':
 			debugstart = getnum(optarg, &endp);
 			if (debugstart < 1)
@@ -1240,11 +1898,23 @@ int main(int argc, char **argv)
 			if (seed < 0)
 				usage();
 			break;
+		case 'U':
+#ifdef HAVE_LINUX_IO_URING_H
+			uring_io = 1;
+#else
+			fprintf(stdout, "io_uring support not compiled in, "
+				"using read() and write()\n");
+			uring_fallback = 1;
+#endif
+			break;
 		case 'W':
 			mapped_writes = 0;
 			if (!quiet)
 				fprintf(stdout, "mapped writes DISABLED\n");
 			break;
+		case 'X':
+			replaypath = optarg;
+			break;
 
 		default:
 			usage();
@@ -1254,6 +1924,8 @@ int main(int argc, char **argv)
 	argv += optind;
 	if (argc < 1)
 		usage();
+	if (nr_procs > 1)
+		fork_procs(argv, argc);
 	fname = argv[0];
 
 	signal(SIGHUP, cleanup);
@@ -1267,11 +1939,19 @@ int main(int argc, char **argv)
 	signal(SIGUSR1, cleanup);
 	signal(SIGUSR2, cleanup);
 
+	if (replaypath)
+		read_replay_header();
+
 	initstate(seed, state, 256);
 	setstate(state);
 
 	open_test_files(argv, argc);
 
+#ifdef HAVE_LINUX_IO_URING_H
+	if (uring_io)
+		uring_init();
+#endif
+
 	strncat(goodfile, dirpath ? basename(fname) : fname, 256);
 	strcat(goodfile, ".fsxgood");
 	fsxgoodfd = open(goodfile, O_RDWR | O_CREAT | O_TRUNC, 0666);
@@ -1302,6 +1982,9 @@ int main(int argc, char **argv)
 			exit(95);
 		}
 	}
+	if (binlogpath)
+		write_binlog_header();
+
 	original_buf = malloc(maxfilelen);
 	if (original_buf == NULL)
 		exit(96);
@@ -1318,6 +2001,9 @@ int main(int argc, char **argv)
 		exit(99);
 	memset(temp_buf, '\0', maxoplen);
 
+	if (!replayf)
+		check_extra_ops();
+
 	if (lite) {		/* zero entire existing file */
 		ssize_t written;
 		int fd = get_fd();
@@ -1336,12 +2022,25 @@ int main(int argc, char **argv)
 	} else
 		check_trunc_hack();
 
-	while (numops == -1 || numops--)
-		test();
+	if (replayf)
+		replay();
+	else
+		while (numops == -1 || numops--)
+			test();
 
 	close_test_files();
+	if (binlogf && fclose(binlogf)) {
+		prterr("binary log close");
+		exit(93);
+	}
 	prt("All operations completed A-OK!\n");
 
+	/* The io_uring I/O requested by -U was not tested */
+	if (uring_fallback) {
+		prt("io_uring was not used, exiting with TCONF\n");
+		return EXIT_TCONF;
+	}
+
 	if (tf_buf)
 		free(tf_buf);
 
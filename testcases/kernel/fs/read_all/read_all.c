@@ -25,11 +25,22 @@
  * processors. However this is limited by default to 15 to avoid this becoming
  * an IPC stress test on systems with large numbers of weak cores. This can be
  * overridden with the 'w' parameters.
+ *
+ * Paths are passed to the workers in batches, each queue entry is a list of
+ * NULL terminated paths ended by an empty string, which saves the semaphore
+ * operations per path. The scanning can be split between several scanner
+ * processes (-s), each of them walks a share of the top level directory
+ * entries and feeds its own subset of the workers, so that every queue still
+ * has a single producer.
+ *
+ * At the end the number of scanned paths and reads per second and the 99th
+ * percentile of the read latency of each worker are printed.
  */
 #include <signal.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
+#include <sys/prctl.h>
 #include <fnmatch.h>
 #include <lapi/fnmatch.h>
 #include <stdlib.h>
@@ -52,15 +63,21 @@
 
 #define QUEUE_SIZE 16384
 #define BUFFER_SIZE 1024
+#define BATCH_SIZE 4096
 #define MAX_PATH 4096
 #define MAX_DISPLAY 40
+#define LAT_BUCKETS 32
 
 struct queue {
 	sem_t sem;
 	int front;
 	int back;
+	/* offset of the path being read in popped, -1 between batches */
+	int cur;
+	/* offset of the last path the worker started reading */
+	int last;
 	char data[QUEUE_SIZE];
-	char popped[BUFFER_SIZE];
+	char popped[BATCH_SIZE];
 };
 
 struct worker {
@@ -69,6 +86,15 @@ struct worker {
 	struct queue *q;
 	int last_seen;
 	unsigned int kill_sent:1;
+	unsigned int reads;
+	/* read latency histogram, bucket n counts reads < 2^(n+1)us */
+	unsigned int lat_hist[LAT_BUCKETS];
+};
+
+/* Paths collected by the producer before they are pushed to a queue */
+struct batch {
+	int len;
+	char data[BATCH_SIZE];
 };
 
 enum dent_action {
@@ -92,6 +118,14 @@ static char *drop_privs;
 static char *str_worker_timeout;
 static int worker_timeout;
 static int timeout_warnings_left = 15;
+static char *str_scanner_count;
+static int scanner_count = 1;
+static int *scanned_paths;
+
+/* The workers fed by this process, i.e. by the current scanner */
+static int *own_workers;
+static int own_count;
+static struct batch *batches;
 
 static char *blacklist[] = {
 	NULL, /* reserved for -e parameter */
@@ -121,35 +155,36 @@ static int queue_pop(struct queue *q)
 	if (!q->data[i])
 		return 0;
 
-	while (q->data[i]) {
+	/* Copy up to and including the empty string ending the batch */
+	do {
 		q->popped[j] = q->data[i];
 
-		if (++j >= BUFFER_SIZE - 1)
-			tst_brk(TBROK, "Buffer is too small for path");
+		if (++j >= BATCH_SIZE - 1)
+			tst_brk(TBROK, "Buffer is too small for batch");
 
 		 i = (i + 1) % QUEUE_SIZE;
-	}
+	} while (q->data[i] || q->popped[j - 1]);
 
 	q->popped[j] = '\0';
+	tst_atomic_store(0, &q->cur);
 	tst_atomic_store((i + 1) % QUEUE_SIZE, &q->front);
 
 	return 1;
 }
 
-static int queue_push(struct queue *q, const char *buf)
+static int queue_push(struct queue *q, const char *buf, int len)
 {
-	int i = q->back, j = 0;
+	int i = q->back, j;
 	int front = tst_atomic_load(&q->front);
 
-	do {
+	for (j = 0; j < len; j++) {
 		q->data[i] = buf[j];
 
 		i = (i + 1) % QUEUE_SIZE;
 
 		if (i == front)
 			return 0;
-
-	} while (buf[j++]);
+	}
 
 	q->back = i;
 	sem_post(&q->sem);
@@ -157,6 +192,38 @@ static int queue_push(struct queue *q, const char *buf)
 	return 1;
 }
 
+static int queue_is_empty(struct queue *q)
+{
+	return tst_atomic_load(&q->front) == q->back;
+}
+
+/* Counts the batches and stop codes between front and back */
+static int queue_len(struct queue *q)
+{
+	int i = q->front, len = 0;
+	char prev;
+
+	while (i != q->back) {
+		len++;
+
+		if (!q->data[i]) {
+			i = (i + 1) % QUEUE_SIZE;
+			continue;
+		}
+
+		prev = 1;
+		while (i != q->back && (q->data[i] || prev)) {
+			prev = q->data[i];
+			i = (i + 1) % QUEUE_SIZE;
+		}
+
+		if (i != q->back)
+			i = (i + 1) % QUEUE_SIZE;
+	}
+
+	return len;
+}
+
 static struct queue *queue_init(void)
 {
 	struct queue *q = SAFE_MMAP(NULL, sizeof(*q),
@@ -167,6 +234,8 @@ static struct queue *queue_init(void)
 	sem_init(&q->sem, 1, 0);
 	q->front = 0;
 	q->back = 0;
+	q->cur = -1;
+	q->last = 0;
 
 	return q;
 }
@@ -225,6 +294,20 @@ static int worker_ttl(const int worker)
 	return MAX(0, worker_timeout - worker_elapsed(worker));
 }
 
+static void record_latency(const int worker, int elapsed)
+{
+	struct worker *const w = workers + worker;
+	int b = 0;
+
+	while (elapsed > 1 && b < LAT_BUCKETS - 1) {
+		elapsed >>= 1;
+		b++;
+	}
+
+	w->lat_hist[b]++;
+	w->reads++;
+}
+
 static void read_test(const int worker, const char *const path)
 {
 	char buf[BUFFER_SIZE];
@@ -251,6 +334,7 @@ static void read_test(const int worker, const char *const path)
 	worker_heartbeat(worker);
 	count = read(fd, buf, sizeof(buf) - 1);
 	elapsed = worker_elapsed(worker);
+	record_latency(worker, elapsed);
 
 	if (count > 0 && verbose) {
 		sanitize_str(buf, count);
@@ -302,9 +386,19 @@ static int worker_run(int worker)
 	};
 	struct worker *const self = workers + worker;
 	struct queue *q = self->q;
+	const char *path;
+	int cur;
 
 	sigaction(SIGTTIN, &term_sa, NULL);
+
 	maybe_drop_privs();
+
+	/*
+	 * Don't outlive a scanner that exited on tst_brk(), set after the
+	 * credentials change which clears the parent death signal.
+	 */
+	if (scanner_count > 1 && prctl(PR_SET_PDEATHSIG, SIGKILL))
+		tst_brk(TBROK | TERRNO, "prctl(PR_SET_PDEATHSIG)");
 	self->pid = getpid();
 
 	if (!worker_ttl(self->i)) {
@@ -316,10 +410,22 @@ static int worker_run(int worker)
 	while (1) {
 		worker_heartbeat(worker);
 
-		if (!queue_pop(q))
-			break;
+		/* A restarted worker continues after the path it got stuck on */
+		cur = tst_atomic_load(&q->cur);
+		if (cur < 0) {
+			if (!queue_pop(q))
+				break;
+			cur = 0;
+		}
 
-		read_test(worker, q->popped);
+		for (path = q->popped + cur; *path; path += strlen(path) + 1) {
+			q->last = path - q->popped;
+			tst_atomic_store(q->last, &q->cur);
+			read_test(worker, path);
+			worker_heartbeat(worker);
+		}
+
+		tst_atomic_store(-1, &q->cur);
 	}
 
 	queue_destroy(q, 1);
@@ -327,27 +433,36 @@ static int worker_run(int worker)
 	return 0;
 }
 
-static void spawn_workers(void)
+static void init_workers(void)
 {
 	int i;
-	struct worker *wa = workers;
 
 	memset(workers, 0, worker_count * sizeof(*workers));
 
 	for (i = 0; i < worker_count; i++) {
-		wa[i].i = i;
-		wa[i].q = queue_init();
-		wa[i].last_seen = atomic_timestamp();
-		wa[i].pid = SAFE_FORK();
-		if (!wa[i].pid)
-			exit(worker_run(i));
+		workers[i].i = i;
+		workers[i].q = queue_init();
+	}
+}
+
+static void spawn_workers(void)
+{
+	int i;
+	struct worker *wa;
+
+	for (i = 0; i < own_count; i++) {
+		wa = workers + own_workers[i];
+		wa->last_seen = atomic_timestamp();
+		wa->pid = SAFE_FORK();
+		if (!wa->pid)
+			exit(worker_run(own_workers[i]));
 	}
 }
 
 static void restart_worker(const int worker)
 {
 	struct worker *const w = workers + worker;
-	int wstatus, ret, i, q_len;
+	int wstatus, ret, q_len, cur;
 
 	if (!w->kill_sent) {
 		SAFE_KILL(w->pid, SIGKILL);
@@ -381,21 +496,21 @@ static void restart_worker(const int worker)
 
 	if (!quiet || timeout_warnings_left) {
 		tst_res(TINFO, "Worker %d (%d): Last popped '%s'",
-			w->pid, worker, w->q->popped);
+			w->pid, worker, w->q->popped + w->q->last);
+	}
+
+	/* Skip the stuck path, the rest of the batch is read by the new worker */
+	cur = w->q->cur;
+	if (cur >= 0) {
+		cur += strlen(w->q->popped + cur) + 1;
+		w->q->cur = w->q->popped[cur] ? cur : -1;
 	}
 
 	/* Make sure the queue length and semaphore match. Threre is a
 	 * race in qeue_pop where the semaphore can be decremented
 	 * then the worker killed before updating q->front
 	 */
-	q_len = 0;
-	i = w->q->front;
-	while (i != w->q->back) {
-		if (!w->q->data[i])
-			q_len++;
-
-		i = (i + 1) % QUEUE_SIZE;
-	}
+	q_len = queue_len(w->q);
 
 	ret = sem_destroy(&w->q->sem);
 	if (ret == -1)
@@ -425,7 +540,7 @@ static void check_timeout_warnings_limit(void)
 		"Silencing timeout warnings; consider increasing LTP_RUNTIME_MUL or removing -q");
 }
 
-static int try_push_work(const int worker, const char *buf)
+static int try_push_entry(const int worker, const char *buf, int len)
 {
 	int ret = 0;
 	int elapsed;
@@ -436,7 +551,7 @@ static int try_push_work(const int worker, const char *buf)
 		return 0;
 	}
 
-	ret = queue_push(w->q, buf);
+	ret = queue_push(w->q, buf, len);
 	if (ret)
 		return 1;
 
@@ -455,11 +570,52 @@ static int try_push_work(const int worker, const char *buf)
 	return 0;
 }
 
-static void push_work(const int worker, const char *buf)
+static int try_flush_batch(const int worker)
+{
+	struct batch *const b = batches + worker;
+
+	if (!b->len)
+		return 1;
+
+	b->data[b->len] = '\0';
+
+	if (!try_push_entry(worker, b->data, b->len + 1))
+		return 0;
+
+	b->len = 0;
+
+	return 1;
+}
+
+/*
+ * Adds the path to the worker's batch. The batch is pushed when it is full or
+ * when the worker has nothing else to do.
+ */
+static int try_push_work(const int worker, const char *buf)
+{
+	struct batch *const b = batches + worker;
+	int len = strlen(buf) + 1;
+
+	if (len >= BATCH_SIZE - 2)
+		tst_brk(TBROK, "Buffer is too small for path");
+
+	if (b->len + len >= BATCH_SIZE - 2 && !try_flush_batch(worker))
+		return 0;
+
+	memcpy(b->data + b->len, buf, len);
+	b->len += len;
+
+	if (queue_is_empty(workers[worker].q))
+		try_flush_batch(worker);
+
+	return 1;
+}
+
+static void push_entry(const int worker, const char *buf, int len)
 {
 	int sleep_time = 1;
 
-	while (!try_push_work(worker, buf)) {
+	while (!try_push_entry(worker, buf, len)) {
 		const int ttl = worker_ttl(worker);
 
 		sleep_time = MIN(2 * sleep_time, ttl);
@@ -470,15 +626,27 @@ static void push_work(const int worker, const char *buf)
 static void stop_workers(void)
 {
 	const char stop_code[1] = { '\0' };
-	int i;
+	int i, j;
 
-	if (!workers)
+	if (!workers || !batches)
 		return;
 
-	for (i = 0; i < worker_count; i++) {
-		if (workers[i].q)
-			push_work(i, stop_code);
+	for (i = 0; i < own_count; i++) {
+		j = own_workers[i];
+
+		if (!workers[j].q)
+			continue;
+
+		if (batches[j].len) {
+			batches[j].data[batches[j].len] = '\0';
+			push_entry(j, batches[j].data, batches[j].len + 1);
+			batches[j].len = 0;
+		}
+
+		push_entry(j, stop_code, 1);
 	}
+
+	own_count = 0;
 }
 
 static void destroy_workers(void)
@@ -503,8 +671,11 @@ static int sched_work(const int first_worker,
 	int min_ttl = worker_timeout, sleep_time = 1;
 	int pushed, workers_pushed = 0;
 
+	tst_atomic_inc(scanned_paths);
+
+	/* first_worker and j index own_workers */
 	for (i = 0, j = first_worker; i < repetitions; j++) {
-		if (j >= worker_count)
+		if (j >= own_count)
 			j = 0;
 
 		if (j == first_worker && !workers_pushed) {
@@ -516,12 +687,12 @@ static int sched_work(const int first_worker,
 		if (j == first_worker)
 			workers_pushed = 0;
 
-		pushed = try_push_work(j, path);
+		pushed = try_push_work(own_workers[j], path);
 		i += pushed;
 		workers_pushed += pushed;
 
 		if (!pushed)
-			min_ttl = MIN(min_ttl, worker_ttl(j));
+			min_ttl = MIN(min_ttl, worker_ttl(own_workers[j]));
 	}
 
 	return j;
@@ -550,9 +721,30 @@ static void setup(void)
 	if (!root_dir)
 		tst_brk(TBROK, "The directory argument (-d) is required");
 
+	if (tst_parse_int(str_scanner_count, &scanner_count, 1, INT_MAX)) {
+		tst_brk(TBROK,
+			"Invalid scanner count (-s) argument: '%s'",
+			str_scanner_count);
+	}
+
 	if (!worker_count)
 		worker_count = MIN(MAX(tst_ncpus() - 1, 1L), max_workers);
-	workers = SAFE_MALLOC(worker_count * sizeof(*workers));
+
+	if (scanner_count > worker_count) {
+		tst_res(TINFO, "Limiting scanners to the number of workers %ld",
+			worker_count);
+		scanner_count = worker_count;
+	}
+
+	/* Shared so that the heartbeats and statistics are seen by all */
+	workers = SAFE_MMAP(NULL, worker_count * sizeof(*workers),
+			    PROT_READ | PROT_WRITE,
+			    MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	scanned_paths = SAFE_MMAP(NULL, sizeof(*scanned_paths),
+				  PROT_READ | PROT_WRITE,
+				  MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	own_workers = SAFE_MALLOC(worker_count * sizeof(*own_workers));
+	batches = SAFE_MALLOC(worker_count * sizeof(*batches));
 
 	if (tst_parse_int(str_worker_timeout, &worker_timeout, 1, INT_MAX)) {
 		tst_brk(TBROK,
@@ -610,10 +802,22 @@ static void cleanup(void)
 	stop_workers();
 	reap_children();
 	destroy_workers();
-	free(workers);
+
+	if (workers)
+		SAFE_MUNMAP(workers, worker_count * sizeof(*workers));
+
+	if (scanned_paths)
+		SAFE_MUNMAP(scanned_paths, sizeof(*scanned_paths));
+
+	free(own_workers);
+	free(batches);
 }
 
-static void visit_dir(const char *path)
+/*
+ * Every scanner visits only its share of the top level entries, the
+ * subdirectories below them are walked by the scanner that owns the entry.
+ */
+static void visit_dir(const char *path, const int scanner)
 {
 	DIR *dir;
 	struct dirent *dent;
@@ -621,6 +825,7 @@ static void visit_dir(const char *path)
 	char dent_path[MAX_PATH];
 	enum dent_action act;
 	int last_sched = 0;
+	unsigned int entry = 0;
 
 	dir = opendir(path);
 	if (!dir) {
@@ -642,6 +847,9 @@ static void visit_dir(const char *path)
 		    !strcmp(dent->d_name, ".."))
 			continue;
 
+		if (scanner >= 0 && (int)(entry++ % scanner_count) != scanner)
+			continue;
+
 		if (dent->d_type == DT_DIR)
 			act = DA_VISIT;
 		else if (dent->d_type == DT_LNK)
@@ -666,7 +874,7 @@ static void visit_dir(const char *path)
 		}
 
 		if (act == DA_VISIT)
-			visit_dir(dent_path);
+			visit_dir(dent_path, -1);
 		else if (act == DA_READ)
 			last_sched = sched_work(last_sched, dent_path, reads);
 	}
@@ -675,14 +883,86 @@ static void visit_dir(const char *path)
 		tst_res(TINFO | TERRNO, "closedir(%s)", path);
 }
 
-static void run(void)
+static unsigned int latency_percentile(const struct worker *w, int pct)
 {
+	unsigned int sum = 0;
+	int i;
+
+	for (i = 0; i < LAT_BUCKETS; i++) {
+		sum += w->lat_hist[i];
+
+		if (sum * 100ULL >= w->reads * (unsigned long long)pct)
+			break;
+	}
+
+	return 2U << MIN(i, LAT_BUCKETS - 1);
+}
+
+static void print_stats(long long elapsed_us)
+{
+	unsigned long long total_reads = 0;
+	double secs = MAX(elapsed_us, 1LL) / 1000000.0;
+	int i;
+
+	for (i = 0; i < worker_count; i++) {
+		total_reads += workers[i].reads;
+
+		if (!workers[i].reads)
+			continue;
+
+		tst_res(TINFO, "Worker %d: %u reads, p99 latency < %uus",
+			i, workers[i].reads, latency_percentile(workers + i, 99));
+	}
+
+	tst_res(TINFO, "Scanned %d paths in %.2fs by %d scanner(s): %.0f paths/s, %.0f reads/s",
+		*scanned_paths, secs, scanner_count,
+		*scanned_paths / secs, total_reads / secs);
+}
+
+static void scan(const int scanner)
+{
+	int i;
+
+	own_count = 0;
+	for (i = scanner; i < worker_count; i += scanner_count)
+		own_workers[own_count++] = i;
+
+	memset(batches, 0, worker_count * sizeof(*batches));
+
 	spawn_workers();
-	visit_dir(root_dir);
+	visit_dir(root_dir, scanner_count > 1 ? scanner : -1);
 
 	stop_workers();
 	reap_children();
+}
+
+static void run(void)
+{
+	struct timespec start, end;
+	int i;
+
+	init_workers();
+	*scanned_paths = 0;
+
+	SAFE_CLOCK_GETTIME(CLOCK_MONOTONIC_RAW, &start);
+
+	if (scanner_count == 1) {
+		scan(0);
+	} else {
+		for (i = 0; i < scanner_count; i++) {
+			if (!SAFE_FORK()) {
+				scan(i);
+				exit(0);
+			}
+		}
+
+		tst_reap_children();
+	}
+
+	SAFE_CLOCK_GETTIME(CLOCK_MONOTONIC_RAW, &end);
+
 	destroy_workers();
+	print_stats(tst_timespec_diff_us(end, start));
 
 	tst_res(TPASS, "Finished reading files");
 }
@@ -707,6 +987,8 @@ static struct tst_test test = {
 		 "Drop privileges; switch to the nobody user."},
 		{"t:", &str_worker_timeout,
 		 "Milliseconds a worker has to read a file before it is restarted"},
+		{"s:", &str_scanner_count,
+		 "Count Number of parallel directory scanners, the default is 1."},
 		{}
 	},
 	.setup = setup,
@@ -34,9 +34,12 @@
 #include <sys/mman.h>
 #include <string.h>
 #include <pthread.h>
+#include <sys/uio.h>
 #include <libaio.h>
 #include "tst_safe_pthread.h"
 #include "tst_safe_sysv_ipc.h"
+#include "tst_safe_io_uring.h"
+#include "tst_histogram.h"
 
 #define IO_FREE 0
 #define IO_PENDING 1
@@ -53,6 +56,11 @@ enum {
 #define USE_SHM 1
 #define USE_SHMFS 2
 
+enum {
+	ENGINE_LIBAIO,
+	ENGINE_IO_URING,
+};
+
 static char *str_num_files;
 static char *str_max_io_submit;
 static char *str_num_contexts;
@@ -66,6 +74,7 @@ static char *str_o_flag;
 static char *str_stages;
 static char *str_use_shm;
 static char *str_num_threads;
+static char *str_engine;
 
 static int num_files = 1;
 static long long file_size = 1024 * 1024 * 1024;
@@ -91,21 +100,15 @@ static int padded_reclen;
 static char *verify;
 static char *verify_buf;
 static char *unlink_files;
+static int engine = ENGINE_LIBAIO;
+static char *sqpoll;
 
 /*
- * latencies during io_submit are measured, these are the
- * granularities for deviations
+ * latencies are recorded in us into histograms with 1% precision, values
+ * over ~19 hours end up in the last bucket
  */
-#define DEVIATIONS 6
-static int deviations[DEVIATIONS] = { 100, 250, 500, 1000, 5000, 10000 };
-
-struct io_latency {
-	double max;
-	double min;
-	double total_io;
-	double total_lat;
-	double deviations[DEVIATIONS];
-};
+#define LAT_MAX_US (1LL << 36)
+#define LAT_SUB_BITS 7
 
 /* container for a series of operations to a file */
 struct io_oper {
@@ -156,6 +159,9 @@ struct io_oper {
 	struct timeval start_time;
 
 	char *file_name;
+
+	/* index in the io_uring registered files */
+	int file_idx;
 };
 
 /* a single io, and all the tracking needed for it */
@@ -181,12 +187,21 @@ struct io_unit {
 	struct io_unit *next;
 
 	struct timeval io_start_time; /* time of io_submit */
+
+	/* buffer for io_uring, index is the registered buffer index */
+	struct iovec iov;
+	int buf_idx;
 };
 
 struct thread_info {
 	io_context_t io_ctx;
 	pthread_t tid;
 
+	/* io_uring engine state, buffers and files registered if possible */
+	struct tst_io_uring ring;
+	int bufs_registered;
+	int files_registered;
+
 	/* allocated array of io_unit structs */
 	struct io_unit *ios;
 
@@ -209,7 +224,7 @@ struct thread_info {
 	int num_global_events;
 
 	/* latency stats for io_submit */
-	struct io_latency io_submit_latency;
+	struct tst_histogram io_submit_latency;
 
 	/* list of operations still in progress, and of those finished */
 	struct io_oper *active_opers;
@@ -222,7 +237,7 @@ struct thread_info {
 	double stage_mb_trans;
 
 	/* latency completion stats i/o time from io_submit until io_getevents */
-	struct io_latency io_completion_latency;
+	struct tst_histogram io_completion_latency;
 };
 
 /* pthread mutexes and other globals for keeping the threads in sync */
@@ -268,29 +283,9 @@ static double time_since_now(struct timeval *start_tv)
  * Add latency info to latency struct
  */
 static void calc_latency(struct timeval *start_tv, struct timeval *stop_tv,
-			 struct io_latency *lat)
+			 struct tst_histogram *lat)
 {
-	double delta;
-	int i;
-
-	delta = time_since(start_tv, stop_tv);
-	delta = delta * 1000;
-
-	if (delta > lat->max)
-		lat->max = delta;
-
-	if (!lat->min || delta < lat->min)
-		lat->min = delta;
-
-	lat->total_io++;
-	lat->total_lat += delta;
-
-	for (i = 0; i < DEVIATIONS; i++) {
-		if (delta < deviations[i]) {
-			lat->deviations[i]++;
-			break;
-		}
-	}
+	tst_histogram_record(lat, time_since(start_tv, stop_tv) * 1000000);
 }
 
 static void oper_list_add(struct io_oper *oper, struct io_oper **list)
@@ -413,39 +408,31 @@ static void print_time(struct io_oper *oper)
 		stage_name(oper->rw), oper->file_name, tput, mb, runtime);
 }
 
-static void print_lat(char *str, struct io_latency *lat)
+static void print_lat(char *str, struct tst_histogram *lat)
 {
-	char out[4 * 1024];
-	char *ptr = out;
-	double avg = lat->total_lat / lat->total_io;
-	int i;
-	double total_counted = 0;
-
-	tst_res(TINFO, "%s min %.2f avg %.2f max %.2f", str, lat->min, avg, lat->max);
-
-	for (i = 0; i < DEVIATIONS; i++) {
-		ptr += sprintf(ptr, "%.0f < %d", lat->deviations[i], deviations[i]);
-		total_counted += lat->deviations[i];
-	}
-
-	if (total_counted && lat->total_io - total_counted)
-		ptr += sprintf(ptr, " < %.0f", lat->total_io - total_counted);
+	tst_res(TINFO, "%s min %.2f avg %.2f max %.2f ms", str,
+		lat->min / 1000.0, tst_histogram_mean(lat) / 1000.0,
+		lat->max / 1000.0);
 
-	tst_res(TINFO, "%s", out);
+	tst_res(TINFO, "%s p50 %.2f p90 %.2f p99 %.2f p99.9 %.2f ms", str,
+		tst_histogram_percentile(lat, 50) / 1000.0,
+		tst_histogram_percentile(lat, 90) / 1000.0,
+		tst_histogram_percentile(lat, 99) / 1000.0,
+		tst_histogram_percentile(lat, 99.9) / 1000.0);
 
-	memset(lat, 0, sizeof(*lat));
+	tst_histogram_reset(lat);
 }
 
 static void print_latency(struct thread_info *t)
 {
-	struct io_latency *lat = &t->io_submit_latency;
+	struct tst_histogram *lat = &t->io_submit_latency;
 
 	print_lat("latency", lat);
 }
 
 static void print_completion_latency(struct thread_info *t)
 {
-	struct io_latency *lat = &t->io_completion_latency;
+	struct tst_histogram *lat = &t->io_completion_latency;
 
 	print_lat("completion latency", lat);
 }
@@ -474,6 +461,139 @@ static void finish_io(struct thread_info *t, struct io_unit *io, long result,
 	}
 }
 
+/*
+ * The io_uring engine takes the very same iocbs as libaio and converts them
+ * into SQEs, completions are returned as io_events, so that the whole state
+ * machine, the batching and the statistics are shared by both engines.
+ */
+static void uring_prep_sqe(struct thread_info *t, struct io_uring_sqe *sqe,
+			   struct iocb *iocb)
+{
+	struct io_unit *io = (struct io_unit *)iocb;
+	int write = iocb->aio_lio_opcode == IO_CMD_PWRITE;
+
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->off = iocb->u.c.offset;
+	sqe->user_data = (uintptr_t)iocb;
+
+	if (t->bufs_registered) {
+		sqe->opcode = write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+		sqe->addr = (uintptr_t)iocb->u.c.buf;
+		sqe->len = iocb->u.c.nbytes;
+		sqe->buf_index = io->buf_idx;
+	} else {
+		io->iov.iov_base = iocb->u.c.buf;
+		io->iov.iov_len = iocb->u.c.nbytes;
+		sqe->opcode = write ? IORING_OP_WRITEV : IORING_OP_READV;
+		sqe->addr = (uintptr_t)&io->iov;
+		sqe->len = 1;
+	}
+
+	if (t->files_registered) {
+		sqe->fd = io->io_oper->file_idx;
+		sqe->flags = IOSQE_FIXED_FILE;
+	} else {
+		sqe->fd = iocb->aio_fildes;
+	}
+}
+
+/* Same return value as io_submit(), i.e. number of submitted iocbs or -errno */
+static int uring_submit(struct thread_info *t, int nr, struct iocb **iocbs)
+{
+	struct tst_io_uring *ring = &t->ring;
+	unsigned int head, tail, flags = 0;
+	int i, ret;
+
+	/* with SQPOLL the kernel thread may not have consumed all SQEs yet */
+	head = __atomic_load_n(ring->sqr_head, __ATOMIC_ACQUIRE);
+	tail = *ring->sqr_tail;
+	nr = MIN(nr, (int)(ring->sqr_size - (tail - head)));
+
+	if (!nr)
+		return -EAGAIN;
+
+	for (i = 0; i < nr; i++) {
+		unsigned int idx = (tail + i) & *ring->sqr_mask;
+
+		uring_prep_sqe(t, &ring->sqr_entries[idx], iocbs[i]);
+		ring->sqr_array[idx] = idx;
+	}
+
+	__atomic_store_n(ring->sqr_tail, tail + nr, __ATOMIC_RELEASE);
+
+	if (sqpoll) {
+		/* the kernel thread picks the SQEs up unless it went to sleep */
+		if (!(__atomic_load_n(ring->sqr_flags, __ATOMIC_ACQUIRE) &
+		      IORING_SQ_NEED_WAKEUP))
+			return nr;
+
+		flags = IORING_ENTER_SQ_WAKEUP;
+	}
+
+	ret = io_uring_enter(ring->fd, nr, 0, flags, NULL);
+
+	if (sqpoll)
+		return ret < 0 ? -errno : nr;
+
+	/* drop the SQEs that were not consumed, the caller resubmits them */
+	if (ret < nr)
+		__atomic_store_n(ring->sqr_tail, tail + MAX(ret, 0), __ATOMIC_RELEASE);
+
+	return ret < 0 ? -errno : ret;
+}
+
+/* Same as io_getevents() without timeout */
+static int uring_getevents(struct thread_info *t, int min_nr, int nr,
+			   struct io_event *events)
+{
+	struct tst_io_uring *ring = &t->ring;
+	unsigned int head;
+	int cnt = 0;
+
+	for (;;) {
+		head = *ring->cqr_head;
+
+		while (cnt < nr &&
+		       head != __atomic_load_n(ring->cqr_tail, __ATOMIC_ACQUIRE)) {
+			const struct io_uring_cqe *cqe;
+
+			cqe = &ring->cqr_entries[head & *ring->cqr_mask];
+			events[cnt].obj = (struct iocb *)(uintptr_t)cqe->user_data;
+			events[cnt].res = cqe->res;
+			events[cnt].res2 = 0;
+			cnt++;
+			head++;
+		}
+
+		__atomic_store_n(ring->cqr_head, head, __ATOMIC_RELEASE);
+
+		if (cnt >= min_nr)
+			return cnt;
+
+		if (io_uring_enter(ring->fd, 0, min_nr - cnt,
+				   IORING_ENTER_GETEVENTS, NULL) < 0 &&
+		    errno != EINTR)
+			return -errno;
+	}
+}
+
+static int engine_submit(struct thread_info *t, int nr, struct iocb **iocbs)
+{
+	if (engine == ENGINE_IO_URING)
+		return uring_submit(t, nr, iocbs);
+
+	return io_submit(t->io_ctx, nr, iocbs);
+}
+
+static int engine_getevents(struct thread_info *t, int min_nr, int nr,
+			    struct io_event *events)
+{
+	if (engine == ENGINE_IO_URING)
+		return uring_getevents(t, min_nr, nr, events);
+
+	return io_getevents(t->io_ctx, min_nr, nr, events, NULL);
+}
+
 static int read_some_events(struct thread_info *t)
 {
 	struct io_unit *event_io;
@@ -486,7 +606,7 @@ static int read_some_events(struct thread_info *t)
 	if (t->num_global_pending < io_iter)
 		min_nr = t->num_global_pending;
 
-	nr = io_getevents(t->io_ctx, min_nr, t->num_global_events, t->events, NULL);
+	nr = engine_getevents(t, min_nr, t->num_global_events, t->events);
 	if (nr <= 0)
 		return nr;
 
@@ -547,7 +667,7 @@ static int io_oper_wait(struct thread_info *t, struct io_oper *oper)
 		/* this func is not speed sensitive, no need to go wild reading
 		 * more than one event at a time
 		 */
-	while (io_getevents(t->io_ctx, 1, 1, &event, NULL) > 0) {
+	while (engine_getevents(t, 1, 1, &event) > 0) {
 		struct timeval tv_now;
 
 		event_io = (struct io_unit *)((unsigned long)event.obj);
@@ -743,7 +863,7 @@ static int run_built(struct thread_info *t, int num_ios, struct iocb **my_iocbs)
 
 resubmit:
 	gettimeofday(&start_time, NULL);
-	ret = io_submit(t->io_ctx, num_ios, my_iocbs);
+	ret = engine_submit(t, num_ios, my_iocbs);
 
 	gettimeofday(&stop_time, NULL);
 	calc_latency(&start_time, &stop_time, &t->io_submit_latency);
@@ -909,6 +1029,93 @@ static void aio_setup(io_context_t *io_ctx, int n)
 		tst_brk(TBROK, "io_queue_setup(%d) returned %d (%s)", n, res, tst_strerrno(-res));
 }
 
+/*
+ * The ring is sized for all io units of the thread, so the number of
+ * requests in flight never exceeds the queue depth. Buffers and files are
+ * registered so that the kernel does not have to map them on each request,
+ * in case that fails we fall back to plain vectored I/O.
+ */
+static void uring_setup(struct thread_info *t)
+{
+	struct io_uring_params params = {};
+	struct iovec *iovs;
+	struct io_oper *oper;
+	int *fds;
+	int i, nr_files = 0;
+
+	if (sqpoll) {
+		params.flags |= IORING_SETUP_SQPOLL;
+		params.sq_thread_idle = 1000;
+	}
+
+	SAFE_IO_URING_INIT(t->num_global_ios, &params, &t->ring);
+
+	iovs = SAFE_MALLOC(sizeof(*iovs) * t->num_global_ios);
+
+	for (i = 0; i < t->num_global_ios; i++) {
+		iovs[i].iov_base = t->ios[i].buf;
+		iovs[i].iov_len = t->ios[i].buf_size;
+		t->ios[i].buf_idx = i;
+	}
+
+	if (io_uring_register(t->ring.fd, IORING_REGISTER_BUFFERS, iovs,
+			      t->num_global_ios))
+		tst_res(TINFO | TERRNO, "Failed to register buffers");
+	else
+		t->bufs_registered = 1;
+
+	free(iovs);
+
+	fds = SAFE_MALLOC(sizeof(*fds) * MAX(t->num_files, 1));
+	oper = t->active_opers;
+
+	while (oper) {
+		oper->file_idx = nr_files;
+		fds[nr_files++] = oper->fd;
+		oper = oper->next;
+
+		if (oper == t->active_opers)
+			break;
+	}
+
+	if (nr_files && io_uring_register(t->ring.fd, IORING_REGISTER_FILES, fds,
+					  nr_files))
+		tst_res(TINFO | TERRNO, "Failed to register files");
+	else
+		t->files_registered = nr_files;
+
+	free(fds);
+}
+
+/*
+ * Probe the ring setup once, so that missing io_uring support or SQPOLL
+ * that is not permitted to the user skips the test instead of breaking it
+ * in the worker threads.
+ */
+static void uring_check(void)
+{
+	struct io_uring_params params = {};
+	int fd;
+
+	if (sqpoll)
+		params.flags |= IORING_SETUP_SQPOLL;
+
+	fd = io_uring_setup(1, &params);
+
+	if (fd != -1) {
+		SAFE_CLOSE(fd);
+		return;
+	}
+
+	if (errno == EPERM && sqpoll)
+		tst_brk(TCONF | TERRNO, "SQPOLL is not permitted");
+
+	if (errno == EOPNOTSUPP || errno == EPERM)
+		tst_brk(TCONF | TERRNO, "io_uring is not available");
+
+	tst_brk(TBROK | TERRNO, "io_uring_setup() failed");
+}
+
 /*
  * allocate io operation and event arrays for a given thread
  */
@@ -1041,7 +1248,10 @@ static int *worker(struct thread_info *t)
 	int status = 0;
 	int cnt;
 
-	aio_setup(&t->io_ctx, 512);
+	if (engine == ENGINE_IO_URING)
+		uring_setup(t);
+	else
+		aio_setup(&t->io_ctx, 512);
 
 restart:
 	if (num_threads > 1) {
@@ -1128,7 +1338,10 @@ restart:
 	if (t->num_global_pending)
 		tst_res(TINFO, "global num pending is %d", t->num_global_pending);
 
-	io_queue_release(t->io_ctx);
+	if (engine == ENGINE_IO_URING)
+		SAFE_IO_URING_CLOSE(&t->ring);
+	else
+		io_queue_release(t->io_ctx);
 
 	return (void *)(intptr_t)status;
 }
@@ -1214,6 +1427,19 @@ static void setup(void)
 		o_flag = O_SYNC;
 	}
 
+	if (str_engine) {
+		if (!strcmp(str_engine, "io_uring"))
+			engine = ENGINE_IO_URING;
+		else if (strcmp(str_engine, "libaio"))
+			tst_brk(TBROK, "Invalid I/O engine '%s'", str_engine);
+	}
+
+	if (sqpoll && engine != ENGINE_IO_URING)
+		tst_brk(TBROK, "SQPOLL (-S) requires io_uring engine (-E io_uring)");
+
+	if (engine == ENGINE_IO_URING)
+		uring_check();
+
 	if (str_use_shm) {
 		if (!strcmp(str_use_shm, "shm")) {
 			tst_res(TINFO, "using ipc shm");
@@ -1292,6 +1518,9 @@ static void run(void)
 		(long)(file_size / (1024 * 1024)), rec_len / 1024, depth, io_iter);
 	tst_res(TINFO, "max io_submit %d, buffer alignment set to %luKB",
 		max_io_submit, (page_size_mask + 1) / 1024);
+	tst_res(TINFO, "I/O engine %s%s",
+		engine == ENGINE_IO_URING ? "io_uring" : "libaio",
+		sqpoll ? " with SQPOLL" : "");
 	tst_res(TINFO, "threads %d files %d contexts %d context offset %ldMB verification %s",
 		num_threads, num_files, num_contexts,
 		(long)(context_offset / (1024 * 1024)), verify ? "on" : "off");
@@ -1322,9 +1551,14 @@ static void run(void)
 	if (setup_shared_mem(num_threads, num_files * num_contexts, depth, rec_len))
 		tst_brk(TBROK, "error in setup_shared_mem");
 
-	for (i = 0; i < num_threads; i++)
+	for (i = 0; i < num_threads; i++) {
 		setup_ious(&t[i], t[i].num_files, depth, rec_len, max_io_submit);
 
+		if (tst_histogram_init(&t[i].io_submit_latency, LAT_MAX_US, LAT_SUB_BITS) ||
+		    tst_histogram_init(&t[i].io_completion_latency, LAT_MAX_US, LAT_SUB_BITS))
+			tst_brk(TBROK | TERRNO, "tst_histogram_init()");
+	}
+
 	if (num_threads > 1) {
 		tst_res(TINFO, "Running multi thread version num_threads: %d", num_threads);
 		status = run_workers(t, num_threads);
@@ -1336,6 +1570,11 @@ static void run(void)
 	for (i = 0; i < num_files; i++)
 		SAFE_UNLINK(files[i]);
 
+	for (i = 0; i < num_threads; i++) {
+		tst_histogram_free(&t[i].io_submit_latency);
+		tst_histogram_free(&t[i].io_completion_latency);
+	}
+
 	if (status)
 		tst_res(TFAIL, "Test did not pass");
 	else
@@ -1354,6 +1593,7 @@ static struct tst_test test = {
 		{ "c:", &str_num_contexts, "Number of io contexts per file" },
 		{ "d:", &str_depth, "Number of pending aio requests for each file (default 64)" },
 		{ "e:", &str_io_iter, "Number of I/O per file sent before switching to the next file (default 8)" },
+		{ "E:", &str_engine, "I/O engine libaio or io_uring (default libaio)" },
 		{ "f:", &str_num_files, "Number of files to generate" },
 		{ "g:", &str_context_offset, "Offset between contexts (default 2M)" },
 		{ "l", &latency_stats, "Print io_submit latencies after each stage" },
@@ -1364,6 +1604,7 @@ static struct tst_test test = {
 		{ "O", &str_o_flag, "Use O_DIRECT" },
 		{ "r:", &str_rec_len, "Record size in KB used for each io (default 64K)" },
 		{ "s:", &str_file_size, "Size in MB of the test file(s) (default 1024M)" },
+		{ "S", &sqpoll, "Use SQPOLL kernel thread for io_uring submissions" },
 		{ "t:", &str_num_threads, "Number of threads to run" },
 		{ "u", &unlink_files, "Unlink files after completion" },
 		{ "v", &verify, "Verification of bytes written" },
@@ -23,6 +23,7 @@
 #include <unistd.h>
 
 #include "mem.h"
+#include "tst_mem_pattern.h"
 #include "numa_helper.h"
 
 /* OOM */
@@ -305,23 +306,22 @@ void ksm_group_check(int run, int pages_shared, int pages_sharing,
 static void verify(char **memory, char value, int proc,
 		    int start, int end, int start2, int end2)
 {
-	int i, j;
-	void *s = NULL;
-
-	s = SAFE_MALLOC((end - start) * (end2 - start2));
+	struct tst_mem_verify_res res;
+	char desc[64];
+	int j;
 
 	tst_res(TINFO, "child %d verifies memory content.", proc);
-	memset(s, value, (end - start) * (end2 - start2));
-	if (memcmp(memory[start], s, (end - start) * (end2 - start2))
-	    != 0)
-		for (j = start; j < end; j++)
-			for (i = start2; i < end2; i++)
-				if (memory[j][i] != value)
-					tst_res(TFAIL, "child %d has %c at "
-						 "%d,%d,%d.",
-						 proc, memory[j][i], proc,
-						 j, i);
-	free(s);
+
+	for (j = start; j < end; j++) {
+		if (!tst_mem_verify(memory[j] + start2, end2 - start2, value,
+				    TST_MEM_THREADS_AUTO, &res))
+			continue;
+
+		/* range offsets are relative to start2 */
+		snprintf(desc, sizeof(desc), "child %d unit %d from %d",
+			 proc, j, start2);
+		tst_mem_verify_report(&res, value, desc);
+	}
 }
 
 void check_hugepage(void)
@@ -338,7 +338,7 @@ struct ksm_merge_data {
 static void ksm_child_memset(int child_num, int size, int total_unit,
 		 struct ksm_merge_data ksm_merge_data, char **memory)
 {
-	int i = 0, j;
+	int j;
 	int unit = size / total_unit;
 
 	tst_res(TINFO, "child %d continues...", child_num);
@@ -354,15 +354,15 @@ static void ksm_child_memset(int child_num, int size, int total_unit,
 	}
 
 	for (j = 0; j < total_unit; j++) {
-		for (i = 0; (unsigned int)i < unit * MB; i++)
-			memory[j][i] = ksm_merge_data.data;
+		tst_mem_fill(memory[j], unit * MB, ksm_merge_data.data,
+			     TST_MEM_THREADS_AUTO);
 	}
 
 	/* if it contains unshared page, then set 'e' char
 	 * at the end of the last page
 	 */
 	if (ksm_merge_data.mergeable_size < size * MB)
-		memory[j-1][i-1] = 'e';
+		memory[total_unit - 1][unit * MB - 1] = 'e';
 }
 
 static void create_ksm_child(int child_num, int size, int unit,
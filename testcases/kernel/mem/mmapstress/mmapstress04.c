@@ -13,6 +13,7 @@
 #include <stdlib.h>
 #include "tst_test.h"
 #include "tst_safe_macros.h"
+#include "tst_mem_pattern.h"
 
 #define NUM_PAGES (192)
 #define TEST_FILE "mmapstress04-testfile"
@@ -37,6 +38,7 @@ static void mmapstress04(void)
 	int i, j, rofd, rwfd;
 	char *buf;
 	int mapped_pages = 0;
+	struct tst_mem_verify_res res;
 
 	if (tst_fill_file(TEST_FILE, 'b', page_size, 1))
 		tst_brk(TBROK | TERRNO, "fill_file");
@@ -82,17 +84,12 @@ static void mmapstress04(void)
 	 * Just finished scribbling all over interwoven mmapped and unmapped
 	 * regions. Check the data.
 	 */
-	for (i = 0; i < mapped_pages * page_size; i++) {
-		unsigned char val = *(mmap_area + i);
+	if (tst_mem_verify(mmap_area, (size_t)mapped_pages * page_size, 'a',
+			   TST_MEM_THREADS_AUTO, &res))
+		tst_mem_verify_report(&res, 'a', "unexpected value in map");
+	else
+		tst_res(TPASS, "blocks have expected data");
 
-		if (val != 'a') {
-			tst_res(TFAIL, "unexpected value in map, "
-				"i=%d,val=0x%x", i, val);
-			goto done;
-		}
-	}
-	tst_res(TPASS, "blocks have expected data");
-done:
 	SAFE_UNLINK(TEST_FILE);
 }
 
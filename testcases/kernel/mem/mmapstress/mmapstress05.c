@@ -33,6 +33,7 @@
 #include <signal.h>
 #include <stdio.h>
 #include <errno.h>
+#include <string.h>
 /* #include <sys/pte.h> */
 
 /*****	LTP Port	*****/
@@ -107,7 +108,6 @@ int main(int argc, char *argv[])
 	caddr_t mmapaddr;
 	char *buf;
 	time_t t;
-	int i;
 	struct sigaction sa;
 
 	if (!argc) {
@@ -150,8 +150,7 @@ int main(int argc, char *argv[])
 	CATCH_SIG(SIGINT);
 	CATCH_SIG(SIGQUIT);
 	CATCH_SIG(SIGTERM);
-	for (i = 0; i < pagesize; i++)
-		buf[i] = 'a';
+	memset(buf, 'a', pagesize);
 	if (write(fd, buf, pagesize) != pagesize) {
 		CERROR("couldn't write page case 1");
 		anyfail();
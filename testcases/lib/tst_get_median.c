@@ -6,7 +6,9 @@
 
 static int cmp(const void *a, const void *b)
 {
-   return (*(int *)a - *(int *)b);
+	long long x = *(long long *)a, y = *(long long *)b;
+
+	return (x > y) - (x < y);
 }
 
 int main(int argc, const char *argv[])
@@ -18,20 +20,20 @@ int main(int argc, const char *argv[])
 		return 1;
 	}
 	if (size == 1) {
-		printf("%d", atoi(argv[1]));
+		printf("%lld", atoll(argv[1]));
 		return 0;
 	}
 
-	int arr[size];
+	long long arr[size];
 	size_t i;
 
 	for (i = 0; i < size; ++i)
-		arr[i] = atoi(argv[i + 1]);
+		arr[i] = atoll(argv[i + 1]);
 
 	qsort(arr, size, sizeof(arr[0]), cmp);
 
 	const size_t size2 = size / 2;
-	printf("%d", (size & 1) ? arr[size2] : ((arr[size2 - 1] + arr[size2]) / 2));
+	printf("%lld", (size & 1) ? arr[size2] : ((arr[size2 - 1] + arr[size2]) / 2));
 
 	return 0;
 }
@@ -14,6 +14,8 @@ TST_USAGE_CALLER="$TST_USAGE"
 TST_USAGE="tst_net_usage"
 TST_SETUP_CALLER="$TST_SETUP"
 TST_SETUP="tst_net_setup"
+TST_CLEANUP_CALLER="$TST_CLEANUP"
+TST_CLEANUP="tst_net_cleanup"
 
 # Blank for an IPV4 test; 6 for an IPV6 test.
 TST_IPV6=${TST_IPV6:-}
@@ -52,8 +54,7 @@ tst_net_remote_tmpdir()
 {
 	[ "$TST_NEEDS_TMPDIR" = 1 ] || return 0
 	[ -n "$TST_USE_LEGACY_API" ] && tst_tmpdir
-	tst_rhost_run -c "mkdir -p $TST_TMPDIR"
-	tst_rhost_run -c "chmod 777 $TST_TMPDIR"
+	tst_rhost_run_batch "mkdir -p $TST_TMPDIR" "chmod 777 $TST_TMPDIR"
 	export TST_TMPDIR_RHOST=1
 }
 
@@ -73,6 +74,12 @@ tst_net_setup()
 	fi
 }
 
+tst_net_cleanup()
+{
+	[ -n "$TST_CLEANUP_CALLER" ] && $TST_CLEANUP_CALLER
+	tst_rhost_agent_stats
+}
+
 # old vs. new API compatibility layer
 tst_res_()
 {
@@ -218,7 +225,9 @@ tst_rhost_run()
 	local post_cmd=' || echo RTERR'
 	local user="root"
 	local ret=0
-	local cmd out output pre_cmd rcmd sh_cmd safe use
+	local agent_cmd cmd output pre_cmd rcmd sh_cmd safe use
+	# dash keeps the value of the caller's variable for plain local
+	local out=
 
 	local OPTIND
 	while getopts :bc:su: opt; do
@@ -243,9 +252,14 @@ tst_rhost_run()
 
 	sh_cmd="$pre_cmd $cmd $post_cmd"
 
+	# The agent returns the exit code, RTERR is not needed
+	agent_cmd="$cmd"
+	[ "$out" ] && agent_cmd="$sh_cmd"
+
 	if [ -n "${TST_USE_NETNS:-}" ]; then
 		use="NETNS"
 		rcmd="$LTP_NETNS sh -c"
+		_tst_rhost_agent_usable "$agent_cmd" && use="AGENT"
 	else
 		tst_require_cmds ssh
 		use="SSH"
@@ -254,14 +268,24 @@ tst_rhost_run()
 
 	if [ "$TST_NET_RHOST_RUN_DEBUG" = 1 ]; then
 		tst_res_ TINFO "tst_rhost_run: cmd: $cmd"
-		tst_res_ TINFO "$use: $rcmd \"$sh_cmd\" $out 2>&1"
+		if [ "$use" = "AGENT" ]; then
+			tst_res_ TINFO "$use: $agent_cmd"
+		else
+			tst_res_ TINFO "$use: $rcmd \"$sh_cmd\" $out 2>&1"
+		fi
 	fi
 
-	output=$($rcmd "$sh_cmd" $out 2>&1 || echo 'RTERR')
+	if [ "$use" = "AGENT" ]; then
+		_tst_rhost_agent_run all "$agent_cmd" || ret=1
+		output="$_tst_rhost_out"
+	else
+		output=$($rcmd "$sh_cmd" $out 2>&1 || echo 'RTERR')
+
+		echo "$output" | grep -q 'RTERR$' && ret=1
+		[ $ret -eq 1 ] && output=$(echo "$output" | sed 's/RTERR//')
+	fi
 
-	echo "$output" | grep -q 'RTERR$' && ret=1
 	if [ $ret -eq 1 ]; then
-		output=$(echo "$output" | sed 's/RTERR//')
 		[ "$safe" ] && \
 			tst_brk_ TBROK "'$cmd' failed on '$RHOST': '$output'"
 	fi
@@ -271,6 +295,164 @@ tst_rhost_run()
 	return $ret
 }
 
+# Run several commands on remote host in a single round trip, stops at the
+# first failing command.
+# tst_rhost_run_batch [-s] CMD [CMD...]
+# Options:
+# -s safe option, if something goes wrong, will exit with TBROK
+# RETURN: 0 on success, 1 on failure
+tst_rhost_run_batch()
+{
+	local cmd
+	local joined=
+	local safe=
+	local ret=0
+
+	if [ "$1" = "-s" ]; then
+		safe="-s"
+		shift
+	fi
+
+	if [ -n "${TST_USE_NETNS:-}" ] && _tst_rhost_agent_usable "$@"; then
+		[ "$TST_NET_RHOST_RUN_DEBUG" = 1 ] && \
+			tst_res_ TINFO "tst_rhost_run_batch: $# cmds: $*"
+
+		_tst_rhost_agent_run stop "$@" || ret=1
+
+		if [ $ret -eq 1 -a "$safe" ]; then
+			tst_brk_ TBROK "'$*' failed on '$RHOST': '$_tst_rhost_out'"
+		fi
+
+		[ -n "$_tst_rhost_out" ] && echo "$_tst_rhost_out"
+
+		return $ret
+	fi
+
+	for cmd; do
+		joined="${joined:+$joined && }$cmd"
+	done
+
+	tst_rhost_run $safe -c "$joined"
+}
+
+# Start tst_rhost_agent, which runs the remote host commands inside the LTP
+# netns without entering it for each command.
+# The commands get the environment exported at the time the agent started,
+# it is therefore started once tst_net.sh exported all its variables.
+# TST_NET_RHOST_AGENT=0 disables the agent.
+tst_rhost_agent_start()
+{
+	local dir="${TMPDIR:-/tmp}/ltp_rhost_${TST_ID}_$$"
+
+	_tst_rhost_agent_dir=
+	_tst_rhost_agent_pid=
+
+	[ "$TST_NET_RHOST_AGENT" = 0 ] && return
+	tst_cmd_available tst_rhost_agent || return
+
+	_tst_rhost_agent_pid=$($LTP_NETNS tst_rhost_agent "$dir" $$) || return
+
+	# The FIFO must be visible from both namespaces
+	[ -p "$dir/req" ] || return
+
+	exec 9> "$dir/req"
+	_tst_rhost_agent_dir="$dir"
+}
+
+tst_rhost_agent_stats()
+{
+	_tst_rhost_agent_usable && _tst_rhost_agent_run stats || return 0
+
+	set -- $_tst_rhost_out
+	tst_res_ TINFO "tst_rhost_agent ran $2 commands in $1 batches for $(($3 / 1000))ms"
+}
+
+# The agent reads one command per line
+_tst_rhost_agent_usable()
+{
+	local nl='
+'
+	local cmd
+
+	[ -n "$_tst_rhost_agent_dir" ] || return 1
+
+	for cmd; do
+		case "$cmd" in
+		*"$nl"*) return 1;;
+		esac
+	done
+}
+
+# _tst_rhost_agent_run MODE [CMD...]
+# MODE: { all | stop | stats }, see tst_rhost_agent.c
+# Sets _tst_rhost_out to the output of the commands.
+# RETURN: exit code of the last command run
+_tst_rhost_agent_run()
+{
+	local mode="$1"
+	local nl='
+'
+	local cmd id line lines rest self
+	local finished=
+	local msg=
+	local spins=0
+	local ret=0
+	shift
+
+	for cmd; do
+		msg="$msg$nl$cmd"
+	done
+
+	read -r self rest < /proc/self/stat
+	_tst_rhost_agent_seq=$((_tst_rhost_agent_seq + 1))
+	id="$self.$_tst_rhost_agent_seq"
+
+	# A single write, so that requests from subshells do not mix
+	printf '%s\n' "$id $mode $#$msg" >&9
+
+	# The answer FIFO is created once the agent gets to the request
+	while [ ! -p "$_tst_rhost_agent_dir/r.$id" ]; do
+		spins=$((spins + 1))
+		[ $spins -lt 1000 ] && continue
+
+		if ! kill -0 $_tst_rhost_agent_pid 2>/dev/null; then
+			tst_res_ TWARN "tst_rhost_agent is not running"
+			_tst_rhost_agent_dir=
+			return 1
+		fi
+		tst_sleep 10ms
+	done
+
+	_tst_rhost_out=
+	while IFS= read -r line; do
+		case "$line" in
+		.) finished=1; break;;
+		"= "*)
+			set -- $line
+			ret=$2
+			lines=$4
+			[ "$TST_NET_RHOST_RUN_DEBUG" = 1 ] && \
+				tst_res_ TINFO "AGENT: exit $2 in $3us"
+
+			while [ $lines -gt 0 ] && IFS= read -r line; do
+				_tst_rhost_out="$_tst_rhost_out$line$nl"
+				lines=$((lines - 1))
+			done
+		;;
+		*) _tst_rhost_out="$line";;
+		esac
+	done < "$_tst_rhost_agent_dir/r.$id"
+
+	_tst_rhost_out="${_tst_rhost_out%$nl}"
+
+	if [ -z "$finished" ]; then
+		tst_res_ TWARN "tst_rhost_agent did not finish '$id'"
+		return 1
+	fi
+
+	return $ret
+}
+
 # Run command on both lhost and rhost.
 # tst_net_run [-s] [-l LPARAM] [-r RPARAM] [ -q ] CMD [ARG [ARG2]]
 # Options:
@@ -591,17 +773,14 @@ tst_init_iface()
 		return $?
 	fi
 
-	if tst_rhost_run -c "ip xfrm state 1>/dev/null 2>&1"; then
-		tst_rhost_run -c "ip xfrm policy flush" || return $?
-		tst_rhost_run -c "ip xfrm state flush" || return $?
-	fi
-	tst_rhost_run -c "ip link set $iface down" || return $?
-	tst_rhost_run -c "ip route flush dev $iface" || return $?
-	tst_rhost_run -c "ip addr flush dev $iface" || return $?
+	set -- "if ip xfrm state 1>/dev/null 2>&1; then ip xfrm policy flush && ip xfrm state flush; fi" \
+		"ip link set $iface down" \
+		"ip route flush dev $iface" \
+		"ip addr flush dev $iface"
 	if [ "$TST_NET_IPV6_ENABLED" = 1 ]; then
-		tst_rhost_run -c "sysctl -qw net.ipv6.conf.$iface.accept_dad=0" || return $?
+		set -- "$@" "sysctl -qw net.ipv6.conf.$iface.accept_dad=0"
 	fi
-	tst_rhost_run -c "ip link set $iface up"
+	tst_rhost_run_batch "$@" "ip link set $iface up"
 }
 
 # tst_add_ipaddr [TYPE] [LINK] [-a IP] [-d] [-q] [-s]
@@ -711,6 +890,24 @@ tst_wait_ipv6_dad()
 	done
 }
 
+# Prints the spread of the values, (max - min) in % of their median
+_tst_netload_spread()
+{
+	local v= min= max=
+	local median=
+
+	[ $# -eq 0 ] && echo 0 && return
+
+	median=$(tst_get_median $@)
+
+	for v in $@; do
+		[ -z "$min" ] || [ "$v" -lt "$min" ] && min=$v
+		[ -z "$max" ] || [ "$v" -gt "$max" ] && max=$v
+	done
+
+	echo $(((max - min) * 100 / (median ? median : 1)))
+}
+
 tst_netload_brk()
 {
 	tst_rhost_run -c "cat $TST_TMPDIR/netstress.log"
@@ -718,7 +915,13 @@ tst_netload_brk()
 	tst_brk_ $1 $2
 }
 
-# Run network load test, see 'netstress -h' for option description
+# Run network load test, see 'netstress -h' for option description.
+# The median client time is saved in the result file (-d), the medians of
+# the client metrics (throughput, latency percentiles, retransmits, softirq
+# time for long runs) as 'name value' lines in the result file with '.metrics'
+# suffix.
+# With TST_NETLOAD_STABLE_PCT set, the runs are repeated until the spread of
+# the client times is below it, up to TST_NETLOAD_MAX_RUN_COUNT runs.
 tst_netload()
 {
 	local rfile="tst_netload.res"
@@ -731,6 +934,8 @@ tst_netload()
 	local cs_opts=
 
 	local run_cnt="$TST_NETLOAD_RUN_COUNT"
+	local max_run_cnt="$TST_NETLOAD_MAX_RUN_COUNT"
+	local stable_pct="$TST_NETLOAD_STABLE_PCT"
 	local c_num="$TST_NETLOAD_CLN_NUMBER"
 	local c_requests="$TST_NETLOAD_CLN_REQUESTS"
 	local c_opts=
@@ -790,18 +995,27 @@ tst_netload()
 	fi
 
 	s_opts="${cs_opts}${s_opts}-R $s_replies -B $TST_TMPDIR"
-	c_opts="${cs_opts}${c_opts}-a $c_num -r $((c_requests / run_cnt)) -d $PWD/$rfile"
+	c_opts="${cs_opts}${c_opts}-a $c_num -r $((c_requests / run_cnt)) -d $PWD/$rfile -M $PWD/tst_netload.metrics"
 
 	tst_res_ TINFO "run server 'netstress $s_opts'"
 	tst_res_ TINFO "run client 'netstress -l $c_opts' $run_cnt times"
+	[ "$stable_pct" ] && [ "$max_run_cnt" -gt "$run_cnt" ] && \
+		tst_res_ TINFO "repeat up to $max_run_cnt times until time spread < ${stable_pct}%"
 
 	tst_rhost_run -c "pkill -9 netstress\$"
 	rm -f tst_netload.log
 
-	local results
+	local results=
 	local passed=0
+	local metrics=
+	local name= val=
+	local i=0
+
+	while [ $i -lt $run_cnt ] || { [ "$stable_pct" ] && \
+		[ $i -lt "$max_run_cnt" ] && \
+		[ $(_tst_netload_spread $results) -ge "$stable_pct" ]; }; do
+		i=$((i + 1))
 
-	for i in $(seq 1 $run_cnt); do
 		tst_rhost_run -c "netstress $s_opts" > tst_netload.log 2>&1
 		if [ $? -ne 0 ]; then
 			cat tst_netload.log
@@ -841,6 +1055,16 @@ tst_netload()
 
 		results="$results $(cat $rfile)"
 		passed=$((passed + 1))
+
+		[ -f tst_netload.metrics ] || continue
+
+		while read -r name val; do
+			if [ $passed -eq 1 ]; then
+				metrics="$metrics $name"
+				eval "local _tst_m_$name="
+			fi
+			eval "_tst_m_$name=\"\$_tst_m_$name $val\""
+		done < tst_netload.metrics
 	done
 
 	if [ "$ret" -ne 0 ]; then
@@ -852,30 +1076,93 @@ tst_netload()
 	local median=$(tst_get_median $results)
 	echo "$median" > $rfile
 
+	rm -f $rfile.metrics
+	for name in $metrics; do
+		eval "val=\$(tst_get_median \$_tst_m_$name)"
+		echo "$name $val" >> $rfile.metrics
+	done
+
+	if [ -f $rfile.metrics ]; then
+		local mfile=$rfile.metrics
+		local lat="$(tst_netload_metric $mfile lat_p50_us)"
+		local softirq="$(tst_netload_metric $mfile softirq_ms)"
+		lat="$lat/$(tst_netload_metric $mfile lat_p99_us)"
+		lat="$lat/$(tst_netload_metric $mfile lat_p999_us)"
+		[ "$softirq" ] && softirq=", softirq $softirq ms"
+
+		tst_res_ TINFO "median $(tst_netload_metric $mfile req_per_sec) req/s," \
+			"$(tst_netload_metric $mfile bytes_per_sec) bytes/s," \
+			"latency p50/p99/p99.9 $lat us," \
+			"$(tst_netload_metric $mfile retrans) retransmits$softirq"
+	fi
+
+	[ "$stable_pct" ] && tst_res_ TINFO \
+		"time spread $(_tst_netload_spread $results)% after $passed runs"
+
 	tst_res_ TPASS "netstress passed, median time $median ms, data:$results"
 
 	return $ret
 }
 
+# tst_netload_metric FILE NAME
+# Prints the value of the metric saved by tst_netload() in FILE
+tst_netload_metric()
+{
+	sed -n "s/^$2 //p" $1
+}
+
 # Compares results for netload runs.
-# tst_netload_compare TIME_BASE TIME THRESHOLD_LOW [THRESHOLD_HI]
+# tst_netload_compare [-m METRIC] TIME_BASE TIME THRESHOLD_LOW [THRESHOLD_HI]
 # TIME_BASE: time taken to run netstress load test - 100%
 # TIME: time that is compared to the base one
 # THRESHOD_LOW: lower limit for TFAIL
 # THRESHOD_HIGH: upper limit for TWARN
+# METRIC: compare the metric instead, TIME_BASE and TIME are the metrics
+#         files saved by tst_netload(), e.g. 'tst_netload.res.metrics'.
+#         The result is positive when the metric improved, i.e. *_per_sec
+#         metrics increased or the others (latency, retransmits...) decreased.
+#         A zero base is compared as 1, so e.g. retransmits appearing where
+#         there were none are reported as a regression.
 tst_netload_compare()
 {
+	local metric=
+	local opt=
+
+	OPTIND=0
+	while getopts :m: opt; do
+		case "$opt" in
+		m) metric="$OPTARG" ;;
+		*) tst_brk_ TBROK "tst_netload_compare: unknown option: $OPTARG" ;;
+		esac
+	done
+	shift $((OPTIND - 1))
+	OPTIND=0
+
 	local base_time=$1
 	local new_time=$2
 	local threshold_low=$3
 	local threshold_hi=$4
 
+	if [ "$metric" ]; then
+		base_time=$(tst_netload_metric $1 $metric)
+		new_time=$(tst_netload_metric $2 $metric)
+	fi
+
 	if [ -z "$base_time" -o -z "$new_time" -o -z "$threshold_low" ]; then
 		tst_brk_ TBROK "tst_netload_compare: invalid argument(s)"
 	fi
 
-	local res=$(((base_time - new_time) * 100 / base_time))
+	local base=$base_time
+	[ "$base" -eq 0 ] && base=1
+
+	local res
+	case "$metric" in
+	*_per_sec) res=$(((new_time - base_time) * 100 / base)) ;;
+	*) res=$(((base_time - new_time) * 100 / base)) ;;
+	esac
+
 	local msg="performance result is ${res}%"
+	[ "$metric" ] && msg="$metric $base_time -> $new_time, $msg"
 
 	if [ "$res" -lt "$threshold_low" ]; then
 		tst_res_ TFAIL "$msg < threshold ${threshold_low}%"
@@ -1082,6 +1369,10 @@ else
 		tst_res_ TWARN "TST_SETUP_CALLER same as TST_SETUP, unset it ($TST_SETUP)"
 		unset TST_SETUP_CALLER
 	fi
+	if [ "$TST_CLEANUP_CALLER" = "$TST_CLEANUP" ]; then
+		tst_res_ TWARN "TST_CLEANUP_CALLER same as TST_CLEANUP, unset it ($TST_CLEANUP)"
+		unset TST_CLEANUP_CALLER
+	fi
 	if [ "$TST_USAGE_CALLER" = "$TST_USAGE" ]; then
 		tst_res_ TWARN "TST_USAGE_CALLER same as TST_USAGE, unset it ($TST_USAGE)"
 		unset TST_USAGE_CALLER
@@ -1119,6 +1410,7 @@ export TST_NETLOAD_CLN_REQUESTS="${TST_NETLOAD_CLN_REQUESTS:-10000}"
 export TST_NETLOAD_CLN_NUMBER="${TST_NETLOAD_CLN_NUMBER:-2}"
 export TST_NETLOAD_BINDTODEVICE="${TST_NETLOAD_BINDTODEVICE-1}"
 export TST_NETLOAD_RUN_COUNT="${TST_NETLOAD_RUN_COUNT:-5}"
+export TST_NETLOAD_MAX_RUN_COUNT="${TST_NETLOAD_MAX_RUN_COUNT:-$((TST_NETLOAD_RUN_COUNT * 2))}"
 export HTTP_DOWNLOAD_DIR="${HTTP_DOWNLOAD_DIR:-/var/www/html}"
 export FTP_DOWNLOAD_DIR="${FTP_DOWNLOAD_DIR:-/var/ftp}"
 export FTP_UPLOAD_DIR="${FTP_UPLOAD_DIR:-/var/ftp/pub}"
@@ -1167,3 +1459,8 @@ if [ -z "$TST_USE_LEGACY_API" ] && ! tst_cmd_available ping6; then
 		export _tst_net_ping6_warn_printed=1
 	fi
 fi
+
+# After all exports, the agent passes its environment to the commands
+if tst_net_use_netns; then
+	tst_rhost_agent_start
+fi
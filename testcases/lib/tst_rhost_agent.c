@@ -0,0 +1,496 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (c) Linux Test Project, 2026
+ */
+
+/*
+ * Runs the remote host commands of tst_net.sh inside the LTP netns.
+ *
+ * The agent is started once per test with $LTP_NETNS, which saves entering
+ * the namespace for each tst_rhost_run() call. It reads batches of commands
+ * from the DIR/req FIFO, runs them one by one with sh -c and streams the exit
+ * code, the run time and the output of each command into the DIR/r.ID FIFO.
+ *
+ * Request:
+ * ID MODE N            followed by N lines with the commands
+ *
+ * MODE is 'all' to run all commands, 'stop' to stop at the first failing
+ * command or 'stats' to get the number of batches, commands and the time
+ * spent running them in microseconds.
+ *
+ * Answer:
+ * = EXIT USEC NLINES    followed by NLINES lines of the command output
+ * .                     end of the batch
+ *
+ * The agent prints its pid, removes DIR and exits once the test shell exits
+ * or turns into a zombie, so that the inherited stderr does not keep the
+ * output of the test open while the harness waits for EOF before reaping it.
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/param.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define REQ_SIZE (64 * 1024)
+#define MAX_CMDS 256
+#define MAX_REPLIES 64
+/* Drop answers not read by the caller in this time */
+#define REPLY_TIMEOUT_MS 10000
+
+struct reply {
+	int fd;
+	long long written_ms;
+	char path[PATH_MAX];
+};
+
+static struct reply replies[MAX_REPLIES];
+static unsigned int nreplies;
+
+static const char *dir;
+static pid_t test_pid;
+
+static unsigned long batches, commands;
+static long long cmd_us;
+
+#define print_msg(fmt, ...) fprintf(stderr, "tst_rhost_agent: " fmt "\n", ##__VA_ARGS__)
+
+static long long now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+/* Returns 0 once the test shell is gone or a zombie */
+static int test_alive(void)
+{
+	char path[64], buf[512], *p;
+	char state = 0;
+	int fd, len;
+
+	snprintf(path, sizeof(path), "/proc/%i/stat", test_pid);
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return !(kill(test_pid, 0) && errno == ESRCH);
+
+	len = read(fd, buf, sizeof(buf) - 1);
+	close(fd);
+
+	if (len <= 0)
+		return 0;
+
+	buf[len] = 0;
+
+	/* The comm field may contain spaces and parentheses */
+	p = strrchr(buf, ')');
+	if (!p || sscanf(p + 1, " %c", &state) != 1)
+		return 0;
+
+	return state != 'Z';
+}
+
+static void drop_reply(unsigned int i)
+{
+	/* Remove it first, a caller must not open a FIFO that is going away */
+	unlink(replies[i].path);
+	close(replies[i].fd);
+	replies[i] = replies[--nreplies];
+}
+
+static void check_replies(void)
+{
+	unsigned int i = 0;
+	int unread;
+
+	while (i < nreplies) {
+		if (ioctl(replies[i].fd, FIONREAD, &unread))
+			unread = 0;
+
+		if (!unread ||
+		    now_us() / 1000 - replies[i].written_ms > REPLY_TIMEOUT_MS) {
+			drop_reply(i);
+			continue;
+		}
+
+		i++;
+	}
+}
+
+/*
+ * The FIFO is kept open for reading and writing so that the caller can open
+ * it without waiting and the answer is not lost if it did not open it yet.
+ */
+static int open_reply(const char *id, char *path)
+{
+	char tmp[PATH_MAX];
+	int fd;
+
+	snprintf(path, PATH_MAX, "%s/r.%s", dir, id);
+	snprintf(tmp, sizeof(tmp), "%s/t.%s", dir, id);
+
+	if (mkfifo(tmp, 0600) ||
+	    (fd = open(tmp, O_RDWR | O_NONBLOCK | O_CLOEXEC)) < 0) {
+		print_msg("FIFO %s failed: %s", tmp, strerror(errno));
+		unlink(tmp);
+		return -1;
+	}
+
+	if (rename(tmp, path)) {
+		print_msg("rename(%s) failed: %s", path, strerror(errno));
+		close(fd);
+		unlink(tmp);
+		return -1;
+	}
+
+	return fd;
+}
+
+/* Larger outputs are written while the caller reads them */
+static int write_reply(int fd, const char *buf, size_t len)
+{
+	struct pollfd pfd = {.fd = fd, .events = POLLOUT};
+	ssize_t ret;
+
+	while (len) {
+		ret = write(fd, buf, len);
+
+		if (ret < 0 && errno != EAGAIN)
+			return 1;
+
+		if (ret < 0) {
+			if (poll(&pfd, 1, REPLY_TIMEOUT_MS) <= 0)
+				return 1;
+			continue;
+		}
+
+		buf += ret;
+		len -= ret;
+	}
+
+	return 0;
+}
+
+static int run_cmd(const char *cmd, char **out, size_t *len)
+{
+	size_t size = 4096;
+	int pfd[2], status;
+	ssize_t ret;
+	pid_t pid;
+
+	*len = 0;
+	*out = malloc(size);
+
+	if (!*out || pipe(pfd)) {
+		print_msg("pipe() failed: %s", strerror(errno));
+		return 127;
+	}
+
+	pid = fork();
+	if (pid < 0) {
+		print_msg("fork() failed: %s", strerror(errno));
+		close(pfd[0]);
+		close(pfd[1]);
+		return 127;
+	}
+
+	if (!pid) {
+		close(pfd[0]);
+		dup2(pfd[1], STDOUT_FILENO);
+		dup2(pfd[1], STDERR_FILENO);
+		close(pfd[1]);
+		signal(SIGPIPE, SIG_DFL);
+		signal(SIGTERM, SIG_DFL);
+		signal(SIGINT, SIG_DFL);
+
+		execl("/bin/sh", "sh", "-c", cmd, (char *)NULL);
+		_exit(127);
+	}
+
+	close(pfd[1]);
+
+	/* Keep space for the trailing newline */
+	for (;;) {
+		if (size - *len < 2) {
+			char *tmp = realloc(*out, size * 2);
+
+			if (!tmp)
+				break;
+
+			*out = tmp;
+			size *= 2;
+		}
+
+		ret = read(pfd[0], *out + *len, size - *len - 1);
+		if (ret < 0 && errno == EINTR)
+			continue;
+
+		if (ret <= 0)
+			break;
+
+		*len += ret;
+	}
+
+	close(pfd[0]);
+
+	while (waitpid(pid, &status, 0) < 0) {
+		if (errno != EINTR)
+			return 127;
+	}
+
+	if (WIFSIGNALED(status))
+		return 128 + WTERMSIG(status);
+
+	return WEXITSTATUS(status);
+}
+
+static void run_batch(const char *id, const char *mode, char **cmds,
+		      unsigned int ncmds)
+{
+	struct reply *r;
+	char hdr[128], *out;
+	unsigned int i, lines;
+	long long start, us;
+	size_t len, j;
+	int ret, err = 0;
+
+	check_replies();
+
+	if (nreplies >= MAX_REPLIES)
+		drop_reply(0);
+
+	r = &replies[nreplies];
+	r->fd = open_reply(id, r->path);
+	if (r->fd < 0)
+		return;
+
+	if (!strcmp(mode, "stats")) {
+		snprintf(hdr, sizeof(hdr), "%lu %lu %lld\n.\n", batches,
+			 commands, cmd_us);
+		err = write_reply(r->fd, hdr, strlen(hdr));
+		goto done;
+	}
+
+	batches++;
+
+	for (i = 0; i < ncmds && !err; i++) {
+		start = now_us();
+		ret = run_cmd(cmds[i], &out, &len);
+		us = now_us() - start;
+
+		commands++;
+		cmd_us += us;
+
+		if (len && out[len - 1] != '\n')
+			out[len++] = '\n';
+
+		for (lines = 0, j = 0; j < len; j++)
+			lines += out[j] == '\n';
+
+		snprintf(hdr, sizeof(hdr), "= %i %lld %u\n", ret, us, lines);
+
+		err = write_reply(r->fd, hdr, strlen(hdr)) ||
+		      write_reply(r->fd, out, len);
+
+		free(out);
+
+		if (ret && !strcmp(mode, "stop"))
+			break;
+	}
+
+	if (!err)
+		err = write_reply(r->fd, ".\n", 2);
+
+done:
+	if (err) {
+		print_msg("answer %s failed", r->path);
+		close(r->fd);
+		unlink(r->path);
+		return;
+	}
+
+	r->written_ms = now_us() / 1000;
+	nreplies++;
+}
+
+/* Returns the number of bytes consumed, 0 if the request is not complete */
+static size_t parse_request(char *buf, size_t len)
+{
+	char *cmds[MAX_CMDS], *line, *nl, *end = buf + len;
+	char id[64], mode[16];
+	unsigned int i, ncmds;
+
+	nl = memchr(buf, '\n', len);
+	if (!nl)
+		return 0;
+
+	*nl = 0;
+
+	if (sscanf(buf, "%63s %15s %u", id, mode, &ncmds) != 3 ||
+	    ncmds > MAX_CMDS || strchr(id, '/')) {
+		print_msg("invalid request '%s'", buf);
+		return nl + 1 - buf;
+	}
+
+	line = nl + 1;
+
+	for (i = 0; i < ncmds; i++) {
+		nl = memchr(line, '\n', end - line);
+		if (!nl) {
+			/* Wait for the rest, restore the header */
+			buf[strlen(buf)] = '\n';
+			while (i--)
+				cmds[i][strlen(cmds[i])] = '\n';
+			return 0;
+		}
+
+		*nl = 0;
+		cmds[i] = line;
+		line = nl + 1;
+	}
+
+	run_batch(id, mode, cmds, ncmds);
+
+	return line - buf;
+}
+
+static void cleanup_dir(void)
+{
+	char path[PATH_MAX];
+	struct dirent *ent;
+	DIR *d = opendir(dir);
+
+	while (d && (ent = readdir(d))) {
+		if (ent->d_name[0] == '.')
+			continue;
+
+		snprintf(path, sizeof(path), "%s/%s", dir, ent->d_name);
+		unlink(path);
+	}
+
+	if (d)
+		closedir(d);
+
+	rmdir(dir);
+}
+
+static void serve(int req_fd)
+{
+	static char buf[REQ_SIZE + 1];
+	struct pollfd pfd = {.fd = req_fd, .events = POLLIN};
+	size_t used = 0, done;
+	ssize_t ret;
+
+	for (;;) {
+		ret = poll(&pfd, 1, 100);
+
+		check_replies();
+
+		if (!test_alive())
+			return;
+
+		if (ret <= 0)
+			continue;
+
+		ret = read(req_fd, buf + used, REQ_SIZE - used);
+		if (ret <= 0)
+			continue;
+
+		used += ret;
+
+		while (used && (done = parse_request(buf, used))) {
+			used -= done;
+			memmove(buf, buf + done, used);
+		}
+
+		/* Drop requests which do not fit */
+		if (used == REQ_SIZE) {
+			print_msg("request too long");
+			used = 0;
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	char path[PATH_MAX], *end;
+	int req_fd;
+	pid_t child;
+	long pid;
+
+	if (argc != 3) {
+		fprintf(stderr, "usage: %s dir pid\n", argv[0]);
+		return 1;
+	}
+
+	errno = 0;
+	pid = strtol(argv[2], &end, 10);
+	if (errno || *end || pid <= 1) {
+		fprintf(stderr, "usage: %s dir pid\n", argv[0]);
+		return 1;
+	}
+
+	dir = argv[1];
+	test_pid = pid;
+
+	if (mkdir(dir, 0700)) {
+		print_msg("mkdir(%s) failed: %s", dir, strerror(errno));
+		return 1;
+	}
+
+	snprintf(path, sizeof(path), "%s/req", dir);
+
+	/* Opened for reading and writing so that it never reports EOF */
+	if (mkfifo(path, 0600) || (req_fd = open(path, O_RDWR | O_CLOEXEC)) < 0) {
+		print_msg("FIFO %s failed: %s", path, strerror(errno));
+		rmdir(dir);
+		return 1;
+	}
+
+	/* The parent returns once the FIFO is ready */
+	switch ((child = fork())) {
+	case -1:
+		print_msg("fork() failed: %s", strerror(errno));
+		return 1;
+	case 0:
+		break;
+	default:
+		printf("%i\n", child);
+		return 0;
+	}
+
+	/*
+	 * Stay in the process group of the test, so that the commands started
+	 * on background are killed on timeout as before, but serve the cleanup
+	 * after SIGTERM.
+	 */
+	signal(SIGTERM, SIG_IGN);
+	signal(SIGINT, SIG_IGN);
+	signal(SIGPIPE, SIG_IGN);
+
+	/* Do not keep the output pipe of the caller open, stderr is needed */
+	close(STDIN_FILENO);
+	close(STDOUT_FILENO);
+	open("/dev/null", O_RDONLY);
+	open("/dev/null", O_WRONLY);
+
+	serve(req_fd);
+
+	cleanup_dir();
+
+	return 0;
+}
@@ -0,0 +1,540 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (c) Linux Test Project, 2026
+ */
+
+/*
+ * Companion process of the shell test library, see tst_test.sh.
+ *
+ * The library starts it once per test and sends it one line requests through
+ * the DIR/req FIFO, which saves a fork and exec of a helper binary for each
+ * call. Requests which need an answer carry an ID unique to the call, the pid
+ * of the calling shell and a sequence number, and the answer is written into
+ * the DIR/r.ID FIFO created on demand.
+ *
+ * res TYPE              count result reported from a subshell
+ * begin / end           test function started / finished
+ * timeout SEC           (re)arm the test timeout, 0 disarms it
+ * call ID getconf VAR
+ * call ID random VAL1 [VAL2]
+ * call ID port FAMILY TYPE
+ * call ID stats         counted results and the framework overhead
+ *
+ * The timeout is handled in the same way as in tst_timeout_kill. The process
+ * removes DIR and exits once the test shell exits or turns into a zombie, so
+ * that the inherited stderr does not keep the output of the test open while
+ * the harness waits for EOF before reaping the test.
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/param.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_REPLIES 64
+/* Drop answers not read by the caller in this time */
+#define REPLY_TIMEOUT_MS 10000
+
+enum { PASS, FAIL, BROK, WARN, CONF, NRES };
+
+static const char *const res_names[NRES] = {
+	"TPASS", "TFAIL", "TBROK", "TWARN", "TCONF"
+};
+
+static const char *dir;
+static pid_t test_pid;
+static unsigned long results[NRES];
+
+/*
+ * The answers are written into FIFOs kept open for reading and writing, so
+ * that neither side waits for the other to open it. The FIFO is closed and
+ * removed once the caller has read the answer.
+ */
+struct reply {
+	int fd;
+	long long written_ms;
+	char path[PATH_MAX];
+};
+
+static struct reply replies[MAX_REPLIES];
+static unsigned int nreplies;
+
+static long long start_ms, func_start_ms, func_ms;
+/* time of the next timeout action, 0 if not armed */
+static long long timeout_at;
+static int kill_stage;
+
+/* The inherited stderr shares the file offset with the test shell */
+#define print_msg(fmt, ...) fprintf(stderr, fmt "\n", ##__VA_ARGS__)
+
+/* Returns the state letter from /proc/PID/stat, 0 if the process is gone */
+static char proc_state(pid_t pid, pid_t *pgrp)
+{
+	char path[64], buf[512], *p;
+	char state = 0;
+	int fd, len;
+
+	snprintf(path, sizeof(path), "/proc/%i/stat", pid);
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return 0;
+
+	len = read(fd, buf, sizeof(buf) - 1);
+	close(fd);
+
+	if (len <= 0)
+		return 0;
+
+	buf[len] = 0;
+
+	/* The comm field may contain spaces and parentheses */
+	p = strrchr(buf, ')');
+	if (p && sscanf(p + 1, " %c %*d %i", &state, pgrp) != 2)
+		state = 0;
+
+	return state;
+}
+
+static int test_alive(void)
+{
+	pid_t pgrp;
+	char state = proc_state(test_pid, &pgrp);
+
+	return state && state != 'Z';
+}
+
+/* Whether anything but zombies is left in the process group of the test */
+static int group_alive(void)
+{
+	struct dirent *ent;
+	DIR *d = opendir("/proc");
+	pid_t pid, pgrp;
+	char state;
+	int alive = 0;
+
+	while (d && !alive && (ent = readdir(d))) {
+		pid = atoi(ent->d_name);
+		if (pid <= 0)
+			continue;
+
+		state = proc_state(pid, &pgrp);
+		alive = state && state != 'Z' && pgrp == test_pid;
+	}
+
+	if (d)
+		closedir(d);
+
+	return alive;
+}
+
+static long long now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+static void drop_reply(unsigned int i)
+{
+	/* Remove it first, a caller must not open a FIFO that is going away */
+	unlink(replies[i].path);
+	close(replies[i].fd);
+	replies[i] = replies[--nreplies];
+}
+
+static void check_replies(void)
+{
+	unsigned int i = 0;
+	int unread;
+
+	while (i < nreplies) {
+		if (ioctl(replies[i].fd, FIONREAD, &unread))
+			unread = 0;
+
+		if (!unread ||
+		    now_ms() - replies[i].written_ms > REPLY_TIMEOUT_MS) {
+			drop_reply(i);
+			continue;
+		}
+
+		i++;
+	}
+}
+
+static void reply(const char *id, const char *fmt, ...)
+{
+	struct reply *r;
+	char tmp[PATH_MAX], buf[256];
+	va_list va;
+	int len;
+
+	check_replies();
+
+	if (nreplies >= MAX_REPLIES)
+		drop_reply(0);
+
+	r = &replies[nreplies];
+	snprintf(r->path, sizeof(r->path), "%s/r.%s", dir, id);
+	snprintf(tmp, sizeof(tmp), "%s/t.%s", dir, id);
+
+	/* The caller waits until the FIFO appears, fill it before renaming */
+	if (mkfifo(tmp, 0600) || (r->fd = open(tmp, O_RDWR)) < 0) {
+		print_msg("tst_shd: FIFO %s failed: %s", tmp, strerror(errno));
+		unlink(tmp);
+		return;
+	}
+
+	va_start(va, fmt);
+	len = vsnprintf(buf, sizeof(buf) - 1, fmt, va);
+	va_end(va);
+
+	len = MIN(len, (int)sizeof(buf) - 2);
+	buf[len++] = '\n';
+
+	if (write(r->fd, buf, len) != len || rename(tmp, r->path)) {
+		print_msg("tst_shd: reply %s failed: %s", r->path, strerror(errno));
+		close(r->fd);
+		unlink(tmp);
+		return;
+	}
+
+	r->written_ms = now_ms();
+	nreplies++;
+}
+
+static int parse_long(const char *str, long *val)
+{
+	char *end;
+
+	if (!str || !*str)
+		return 1;
+
+	errno = 0;
+	*val = strtol(str, &end, 10);
+
+	return errno || *end;
+}
+
+static void do_getconf(const char *id, char *var)
+{
+	if (var && !strcmp(var, "_NPROCESSORS_ONLN"))
+		reply(id, "%ld", sysconf(_SC_NPROCESSORS_ONLN));
+	else if (var && (!strcmp(var, "PAGESIZE") || !strcmp(var, "PAGE_SIZE")))
+		reply(id, "%ld", sysconf(_SC_PAGE_SIZE));
+	else
+		reply(id, "ERR");
+}
+
+/* Same range semantics as tst_random */
+static void do_random(const char *id, char *val1, char *val2)
+{
+	long min = 0, max, tmp;
+
+	if (parse_long(val1, &max) || (val2 && parse_long(val2, &min))) {
+		reply(id, "ERR");
+		return;
+	}
+
+	if (min > max) {
+		tmp = min;
+		min = max;
+		max = tmp;
+	}
+
+	reply(id, "%ld", random() % (max - min + 1) + min);
+}
+
+static void do_port(const char *id, char *family_str, char *type_str)
+{
+	struct sockaddr_storage addr;
+	socklen_t len = sizeof(addr);
+	int family = 0, type = 0, fd;
+
+	if (family_str && !strcmp(family_str, "ipv4"))
+		family = AF_INET;
+	else if (family_str && !strcmp(family_str, "ipv6"))
+		family = AF_INET6;
+
+	if (type_str && !strcmp(type_str, "stream"))
+		type = SOCK_STREAM;
+	else if (type_str && !strcmp(type_str, "dgram"))
+		type = SOCK_DGRAM;
+
+	if (!family || !type) {
+		reply(id, "ERR");
+		return;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.ss_family = family;
+
+	fd = socket(family, type, 0);
+	if (fd < 0) {
+		reply(id, "ERR");
+		return;
+	}
+
+	/* Binding to port 0 makes the kernel pick an unused one */
+	if (bind(fd, (struct sockaddr *)&addr, len) ||
+	    getsockname(fd, (struct sockaddr *)&addr, &len)) {
+		close(fd);
+		reply(id, "ERR");
+		return;
+	}
+
+	close(fd);
+
+	if (family == AF_INET)
+		reply(id, "%d", ntohs(((struct sockaddr_in *)&addr)->sin_port));
+	else
+		reply(id, "%d", ntohs(((struct sockaddr_in6 *)&addr)->sin6_port));
+}
+
+static void do_stats(const char *id)
+{
+	long long total = now_ms() - start_ms, in_func = func_ms;
+
+	if (func_start_ms)
+		in_func += now_ms() - func_start_ms;
+
+	reply(id, "%lu %lu %lu %lu %lu %lld %lld", results[PASS],
+	      results[FAIL], results[BROK], results[WARN], results[CONF],
+	      total, total - in_func);
+}
+
+static void do_call(char *args)
+{
+	char *id, *cmd, *arg1, *arg2, *save;
+
+	id = strtok_r(args, " ", &save);
+	cmd = strtok_r(NULL, " ", &save);
+	arg1 = strtok_r(NULL, " ", &save);
+	arg2 = strtok_r(NULL, " ", &save);
+
+	if (!id || !cmd || strchr(id, '/'))
+		return;
+
+	if (!strcmp(cmd, "getconf"))
+		do_getconf(id, arg1);
+	else if (!strcmp(cmd, "random"))
+		do_random(id, arg1, arg2);
+	else if (!strcmp(cmd, "port"))
+		do_port(id, arg1, arg2);
+	else if (!strcmp(cmd, "stats"))
+		do_stats(id);
+	else
+		reply(id, "ERR");
+}
+
+static void do_request(char *line)
+{
+	long timeout;
+	int i;
+
+	if (!strncmp(line, "res ", 4)) {
+		for (i = 0; i < NRES; i++) {
+			if (!strcmp(line + 4, res_names[i]))
+				results[i]++;
+		}
+	} else if (!strcmp(line, "begin")) {
+		func_start_ms = now_ms();
+	} else if (!strcmp(line, "end")) {
+		if (func_start_ms)
+			func_ms += now_ms() - func_start_ms;
+		func_start_ms = 0;
+	} else if (!strncmp(line, "timeout ", 8)) {
+		if (!parse_long(line + 8, &timeout) && timeout >= 0) {
+			timeout_at = timeout ? now_ms() + timeout * 1000 : 0;
+			kill_stage = 0;
+		}
+	} else if (!strncmp(line, "call ", 5)) {
+		do_call(line + 5);
+	} else {
+		print_msg("tst_shd: invalid request '%s'", line);
+	}
+}
+
+/* The same sequence as tst_timeout_kill, without blocking the requests */
+static void handle_timeout(void)
+{
+	if (!kill_stage) {
+		print_msg("Test timed out, sending SIGTERM!");
+		print_msg("If you are running on slow machine, try exporting LTP_TIMEOUT_MUL > 1");
+
+		if (kill(-test_pid, SIGTERM)) {
+			print_msg("kill(%i) failed: %s", -test_pid, strerror(errno));
+			timeout_at = 0;
+			return;
+		}
+
+		kill_stage = 1;
+		timeout_at = now_ms() + 100;
+		return;
+	}
+
+	if (!group_alive()) {
+		timeout_at = 0;
+		return;
+	}
+
+	if (kill_stage <= 10) {
+		print_msg("Test is still running... %i", 11 - kill_stage);
+		kill_stage++;
+		timeout_at = now_ms() + 1000;
+		return;
+	}
+
+	print_msg("Test is still running, sending SIGKILL");
+
+	if (kill(-test_pid, SIGKILL))
+		print_msg("kill(%i) failed: %s", -test_pid, strerror(errno));
+
+	timeout_at = 0;
+}
+
+static void cleanup_dir(void)
+{
+	char path[PATH_MAX];
+	struct dirent *ent;
+	DIR *d = opendir(dir);
+
+	/* The req FIFO and the r.ID FIFOs */
+	while (d && (ent = readdir(d))) {
+		if (ent->d_name[0] == '.')
+			continue;
+
+		snprintf(path, sizeof(path), "%s/%s", dir, ent->d_name);
+		unlink(path);
+	}
+
+	if (d)
+		closedir(d);
+
+	rmdir(dir);
+}
+
+static void serve(int req_fd)
+{
+	char buf[4096], *nl, *line;
+	size_t used = 0;
+	struct pollfd pfd = {.fd = req_fd, .events = POLLIN};
+	long long timeout;
+	ssize_t ret;
+
+	for (;;) {
+		/* Check that the test shell is still alive every 100ms */
+		timeout = 100;
+		if (timeout_at)
+			timeout = MAX(MIN(timeout_at - now_ms(), timeout), 0LL);
+
+		ret = poll(&pfd, 1, timeout);
+
+		check_replies();
+
+		if (timeout_at && now_ms() >= timeout_at)
+			handle_timeout();
+
+		/* Keep going while the timeout still kills the process group */
+		if (!test_alive() && (!kill_stage || !group_alive()))
+			return;
+
+		if (ret <= 0)
+			continue;
+
+		ret = read(req_fd, buf + used, sizeof(buf) - used - 1);
+		if (ret <= 0)
+			continue;
+
+		used += ret;
+		buf[used] = 0;
+		line = buf;
+
+		while ((nl = strchr(line, '\n'))) {
+			*nl = 0;
+			do_request(line);
+			line = nl + 1;
+		}
+
+		used -= line - buf;
+		memmove(buf, line, used);
+
+		/* Drop overlong lines */
+		if (used == sizeof(buf) - 1)
+			used = 0;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	char path[PATH_MAX];
+	long pid;
+	int req_fd;
+
+	if (argc != 3 || parse_long(argv[2], &pid) || pid <= 1) {
+		fprintf(stderr, "usage: %s dir pid\n", argv[0]);
+		return 1;
+	}
+
+	dir = argv[1];
+	test_pid = pid;
+
+	if (mkdir(dir, 0700)) {
+		print_msg("tst_shd: mkdir(%s) failed: %s", dir, strerror(errno));
+		return 1;
+	}
+
+	snprintf(path, sizeof(path), "%s/req", dir);
+
+	/* Opened for reading and writing so that it never reports EOF */
+	if (mkfifo(path, 0600) || (req_fd = open(path, O_RDWR)) < 0) {
+		print_msg("tst_shd: FIFO %s failed: %s", path, strerror(errno));
+		rmdir(dir);
+		return 1;
+	}
+
+	start_ms = now_ms();
+	srandom(time(NULL) ^ getpid());
+
+	/* The parent returns once the FIFO is ready */
+	switch (fork()) {
+	case -1:
+		print_msg("tst_shd: fork() failed: %s", strerror(errno));
+		return 1;
+	case 0:
+		break;
+	default:
+		return 0;
+	}
+
+	/* Do not get killed by the timeout together with the test */
+	setsid();
+	signal(SIGPIPE, SIG_IGN);
+
+	/* Do not keep the output pipe of the caller open, stderr is needed */
+	close(STDIN_FILENO);
+	close(STDOUT_FILENO);
+	open("/dev/null", O_RDONLY);
+	open("/dev/null", O_WRONLY);
+
+	serve(req_fd);
+
+	cleanup_dir();
+
+	return 0;
+}
@@ -28,7 +28,9 @@ _tst_do_cleanup()
 {
 	if [ -n "$TST_DO_CLEANUP" -a -n "$TST_CLEANUP" -a -z "$TST_NO_CLEANUP" ]; then
 		if command -v $TST_CLEANUP >/dev/null 2>/dev/null; then
+			_tst_shd_mark begin
 			$TST_CLEANUP
+			_tst_shd_mark end
 		else
 			tst_res TWARN "TST_CLEANUP=$TST_CLEANUP declared, but function not defined (or cmd not found)"
 		fi
@@ -61,7 +63,10 @@ _tst_do_exit()
 		rm $LTP_IPC_PATH
 	fi
 
+	# Still covered by the timeout
+	_tst_shd_report
 	_tst_cleanup_timer
+	_tst_shd_stop
 
 	if [ $TST_FAIL -gt 0 ]; then
 		ret=$((ret|1))
@@ -112,10 +117,17 @@ _tst_inc_res()
 tst_res()
 {
 	local res=$1
+	local _tst_self _tst_rest
 	shift
 
 	_tst_inc_res "$res"
 
+	# Results from subshells are lost unless counted by tst_shd
+	if [ -n "$_tst_shd_dir" -a "$res" != TINFO ]; then
+		read -r _tst_self _tst_rest < /proc/self/stat
+		[ "$_tst_self" != $$ ] && echo "res $res" >&8
+	fi
+
 	printf "$TST_ID $TST_COUNT " >&2
 	tst_print_colored $res "$res: " >&2
 	echo "$@" >&2
@@ -453,7 +465,9 @@ tst_is_int()
 
 tst_is_num()
 {
-	echo "$1" | grep -Eq '^[-+]?[0-9]+\.?[0-9]*$'
+	case "${1#[-+]}" in
+	''|.*|*.*.*|*[!0-9.]*) return 1;;
+	esac
 }
 
 tst_usage()
@@ -480,22 +494,19 @@ LTPROOT              Prefix for installed LTP (default: /opt/ltp)
 LTP_COLORIZE_OUTPUT  Force colorized output behaviour (y/1 always, n/0: never)
 LTP_DEV              Path to the block device to be used (for .needs_device)
 LTP_DEV_FS_TYPE      Filesystem used for testing (default: ext2)
+LTP_SHD              Set to 0 to run without the tst_shd helper process
 LTP_SINGLE_FS_TYPE   Testing only - specifies filesystem instead all supported (for TST_ALL_FILESYSTEMS=1)
 LTP_TIMEOUT_MUL      Timeout multiplier (must be a number >=1, ceiled to int)
 TMPDIR               Base directory for template directory (for .needs_tmpdir, default: /tmp)
 EOF
 }
 
-_tst_resstr()
-{
-	echo "$TST_PASS$TST_FAIL$TST_CONF"
-}
-
+# Results counted by tst_shd are part of the check, see _tst_shd_rescnt
 _tst_rescmp()
 {
-	local res=$(_tst_resstr)
+	_tst_shd_rescnt
 
-	if [ "$1" = "$res" ]; then
+	if [ "$1" = "$TST_PASS$TST_FAIL$TST_CONF.$_tst_shd_rescnt" ]; then
 		tst_brk TBROK "Test didn't report any results"
 	fi
 }
@@ -512,7 +523,7 @@ _tst_multiply_timeout()
 	tst_is_num "$LTP_TIMEOUT_MUL" || tst_brk TBROK "$err ($LTP_TIMEOUT_MUL)"
 
 	if ! tst_is_int "$LTP_TIMEOUT_MUL"; then
-		LTP_TIMEOUT_MUL=$(echo "$LTP_TIMEOUT_MUL" | cut -d. -f1)
+		LTP_TIMEOUT_MUL=${LTP_TIMEOUT_MUL%%.*}
 		LTP_TIMEOUT_MUL=$((LTP_TIMEOUT_MUL+1))
 		tst_res TINFO "ceiling LTP_TIMEOUT_MUL to $LTP_TIMEOUT_MUL"
 	fi
@@ -526,6 +537,8 @@ _tst_multiply_timeout()
 
 _tst_cleanup_timer()
 {
+	[ -z "$_tst_shd_dir" ] || echo "timeout 0" >&8
+
 	if [ -n "$_tst_setup_timer_pid" ]; then
 		kill -TERM $_tst_setup_timer_pid 2>/dev/null
 		# kill is successful only on test timeout
@@ -557,14 +570,19 @@ _tst_setup_timer()
 
 	_tst_cleanup_timer
 
+	if [ -n "$_tst_shd_dir" ]; then
+		echo "timeout $sec" >&8
+		return
+	fi
+
 	tst_timeout_kill $sec $pid &
 
 	_tst_setup_timer_pid=$!
 
 	while true; do
-		local state
+		local state _tst_rest
 
-		state=$(cut -d' ' -f3 "/proc/$_tst_setup_timer_pid/stat")
+		read -r _tst_rest _tst_rest state _tst_rest < "/proc/$_tst_setup_timer_pid/stat"
 
 		if [ "$state" = "S" ]; then
 			break;
@@ -574,6 +592,126 @@ _tst_setup_timer()
 	done
 }
 
+_tst_shd_start()
+{
+	local dir="${TMPDIR:-/tmp}/ltp_shd_${TST_ID}_$$"
+
+	_tst_shd_dir=
+
+	[ "$LTP_SHD" = 0 ] && return
+	command -v tst_shd > /dev/null 2>&1 || return
+
+	# The parent exits once the request FIFO exists
+	tst_shd "$dir" $$ || return
+
+	exec 8> "$dir/req"
+	_tst_shd_dir="$dir"
+}
+
+_tst_shd_stop()
+{
+	# tst_shd removes its directory once the test shell exits
+	[ -z "$_tst_shd_dir" ] || exec 8>&-
+	_tst_shd_dir=
+}
+
+# Splits the run time into test and library time
+_tst_shd_mark()
+{
+	[ -z "$_tst_shd_dir" ] || echo "$1" >&8
+}
+
+# Sends a request to tst_shd and stores the answer into _tst_shd_reply
+_tst_shd_call()
+{
+	local _tst_self _tst_rest _tst_id _tst_spins=0
+
+	_tst_shd_reply=
+	[ -n "$_tst_shd_dir" ] || return 1
+
+	# Unique per call, a late answer to an earlier call is never read
+	read -r _tst_self _tst_rest < /proc/self/stat
+	_tst_shd_seq=$((_tst_shd_seq + 1))
+	_tst_id="$_tst_self.$_tst_shd_seq"
+
+	echo "call $_tst_id $*" >&8
+
+	# Spin briefly, then leave the CPU to tst_shd, give up after ~1s
+	while [ ! -p "$_tst_shd_dir/r.$_tst_id" ]; do
+		_tst_spins=$((_tst_spins+1))
+		[ $_tst_spins -lt 100 ] && continue
+		[ $_tst_spins -lt 1100 ] || return 1
+		tst_sleep 1ms
+	done
+
+	read -r _tst_shd_reply < "$_tst_shd_dir/r.$_tst_id"
+	[ -n "$_tst_shd_reply" -a "$_tst_shd_reply" != ERR ]
+}
+
+# The helpers below are answered by tst_shd, the binaries are the fallback
+tst_getconf()
+{
+	if [ $# -eq 1 ] && _tst_shd_call getconf "$1"; then
+		echo "$_tst_shd_reply"
+		return
+	fi
+
+	command tst_getconf "$@"
+}
+
+tst_random()
+{
+	if [ $# -ge 1 -a $# -le 2 ] && _tst_shd_call random "$@"; then
+		echo "$_tst_shd_reply"
+		return
+	fi
+
+	command tst_random "$@"
+}
+
+tst_get_unused_port()
+{
+	if [ $# -eq 2 ] && _tst_shd_call port "$1" "$2"; then
+		echo "$_tst_shd_reply"
+		return
+	fi
+
+	command tst_get_unused_port "$@"
+}
+
+# Stores the number of TPASS, TFAIL and TCONF results reported from subshells
+# so far into _tst_shd_rescnt, empty without tst_shd
+_tst_shd_rescnt()
+{
+	_tst_shd_rescnt=
+
+	_tst_shd_call stats || return 0
+
+	set -- $_tst_shd_reply
+	_tst_shd_rescnt=$(($1+$2+$5))
+}
+
+# Adds results reported from subshells, run only in the main shell
+_tst_shd_report()
+{
+	local _tst_self _tst_rest
+
+	read -r _tst_self _tst_rest < /proc/self/stat
+	[ "$_tst_self" = $$ ] || return 0
+
+	_tst_shd_call stats || return 0
+
+	set -- $_tst_shd_reply
+
+	TST_PASS=$((TST_PASS+$1))
+	TST_FAIL=$((TST_FAIL+$2))
+	TST_BROK=$((TST_BROK+$3))
+	TST_WARN=$((TST_WARN+$4))
+	TST_CONF=$((TST_CONF+$5))
+
+	tst_res TINFO "Test library overhead ${7}ms of ${6}ms"
+}
+
 tst_require_root()
 {
 	if [ "$(id -ru)" != 0 ]; then
@@ -661,6 +799,8 @@ tst_run()
 	local _tst_pattern='[='\''"} \t\/:`$\;|].*'
 	local ret
 
+	_tst_shd_start
+
 	if [ -n "$TST_TEST_PATH" ]; then
 		for _tst_i in $(grep '^[^#]*\bTST_' "$TST_TEST_PATH" | sed "s/.*TST_//; s/$_tst_pattern//"); do
 			case "$_tst_i" in
@@ -673,7 +813,9 @@ tst_run()
 			NEEDS_KCONFIGS|NEEDS_KCONFIGS_IFS);;
 			IPV6|IPV6_FLAG|IPVER|TEST_DATA|TEST_DATA_IFS);;
 			RETRY_FUNC|RETRY_FN_EXP_BACKOFF|TIMEOUT);;
-			NET_DATAROOT|NET_MAX_PKT|NET_RHOST_RUN_DEBUG|NETLOAD_CLN_NUMBER);;
+			NET_DATAROOT|NET_MAX_PKT|NET_RHOST_RUN_DEBUG);;
+			NET_RHOST_AGENT|NETLOAD_CLN_NUMBER);;
+			NETLOAD_STABLE_PCT|NETLOAD_MAX_RUN_COUNT);;
 			NET_SKIP_VARIABLE_INIT|NEEDS_CHECKPOINTS);;
 			CHECKPOINT_WAIT|CHECKPOINT_WAKE);;
 			CHECKPOINT_WAKE2|CHECKPOINT_WAKE_AND_WAIT);;
@@ -781,7 +923,9 @@ _tst_run_iterations()
 	if [ -n "$TST_SETUP" ]; then
 		if command -v $TST_SETUP >/dev/null 2>/dev/null; then
 			TST_DO_CLEANUP=1
+			_tst_shd_mark begin
 			$TST_SETUP
+			_tst_shd_mark end
 		else
 			tst_brk TBROK "TST_SETUP=$TST_SETUP declared, but function not defined (or cmd not found)"
 		fi
@@ -817,22 +961,29 @@ _tst_run_tests()
 	local _tst_i
 
 	TST_DO_CLEANUP=1
-	for _tst_i in $(seq ${TST_CNT:-1}); do
+	_tst_i=1
+	while [ $_tst_i -le ${TST_CNT:-1} ]; do
 		if command -v ${TST_TESTFUNC}1 > /dev/null 2>&1; then
 			_tst_run_test "$TST_TESTFUNC$_tst_i" $_tst_i "$_tst_data"
 		else
 			_tst_run_test "$TST_TESTFUNC" $_tst_i "$_tst_data"
 		fi
+		_tst_i=$((_tst_i+1))
 	done
 }
 
 _tst_run_test()
 {
-	local _tst_res=$(_tst_resstr)
+	local _tst_res
 	local _tst_fnc="$1"
 	shift
 
+	_tst_shd_rescnt
+	_tst_res="$TST_PASS$TST_FAIL$TST_CONF.$_tst_shd_rescnt"
+
+	_tst_shd_mark begin
 	$_tst_fnc "$@"
+	_tst_shd_mark end
 	_tst_rescmp "$_tst_res"
 	TST_COUNT=$((TST_COUNT+1))
 }
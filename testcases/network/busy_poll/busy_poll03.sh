@@ -37,7 +37,8 @@ test()
 			    -b $x -T $2
 	done
 
-	tst_netload_compare $(cat res_0) $(cat res_50) 1
+	tst_netload_compare -m req_per_sec res_0.metrics res_50.metrics 1
+	tst_netload_compare -m lat_p99_us res_0.metrics res_50.metrics 0
 }
 
 . busy_poll_lib.sh
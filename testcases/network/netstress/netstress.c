@@ -3,11 +3,13 @@
  * Copyright (c) 2014-2016 Oracle and/or its affiliates. All Rights Reserved.
  * Author: Alexey Kodanev <alexey.kodanev@oracle.com>
  */
+#define _GNU_SOURCE
 
 #include <pthread.h>
 #include <stdlib.h>
 #include <limits.h>
 #include <linux/dccp.h>
+#include <sys/epoll.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netdb.h>
@@ -30,6 +32,12 @@
 #include "tst_safe_pthread.h"
 #include "tst_test.h"
 #include "tst_safe_net.h"
+#include "tst_epoll.h"
+#include "tst_histogram.h"
+
+#ifndef EPOLLEXCLUSIVE
+# define EPOLLEXCLUSIVE (1U << 28)
+#endif
 
 #if !defined(HAVE_RAND_R)
 static int rand_r(LTP_ATTRIBUTE_UNUSED unsigned int *seed)
@@ -111,11 +119,13 @@ static int wait_timeout = 60000;
 
 /* in the end test will save time result in this file */
 static char *rpath;
+/* and the client metrics as 'name value' lines in this one */
+static char *mpath;
 static char *port_path = "netstress_port";
 static char *log_path = "netstress.log";
 
 static char *narg, *Narg, *qarg, *rarg, *Rarg, *aarg, *Targ, *barg, *targ,
-	    *Aarg;
+	    *Aarg, *warg;
 
 /* common structure for TCP/UDP server and TCP/UDP client */
 struct net_func {
@@ -140,12 +150,58 @@ struct sock_info {
 	int pmtu_err_cnt;
 	int eshutdown_cnt;
 	int timeout;
+	unsigned long retrans;
 };
 
 static char *zcopy;
 static int send_flags = MSG_NOSIGNAL;
 static char *reuse_port;
 
+/* client request round trip latency in us, one histogram per client */
+#define LAT_MAX_US (1LL << 32)
+#define LAT_SUB_BITS 7
+static struct tst_histogram *client_lat;
+static int *client_conns;
+/* payload bytes sent and received, retransmitted TCP segments per client */
+static long long *client_bytes;
+static unsigned long *client_retrans;
+/*
+ * /proc/stat counts softirq time in USER_HZ ticks, report it only for client
+ * runs long enough for the tick granularity not to matter
+ */
+#define SOFTIRQ_MIN_TICKS 1000
+/* per-CPU softirq time in clock ticks when the clients started */
+static unsigned long long *softirq_start;
+static int softirq_cpus;
+
+/*
+ * Event-driven server, each worker thread runs its own epoll loop serving
+ * many connections. With SO_REUSEPORT every worker has its own listening
+ * socket and the kernel shards the connections, otherwise the workers share
+ * the listening socket with EPOLLEXCLUSIVE.
+ */
+struct srv_conn {
+	int fd;
+	int offset;
+	int buf_size;
+	int num_requests;
+	int send_type;
+	char *buf;
+};
+
+struct srv_worker {
+	pthread_t id;
+	int lfd;
+	int epfd;
+	char *send_buf;
+	unsigned long conns;
+	unsigned long requests;
+};
+
+static int srv_workers_num;
+static struct srv_worker *srv_workers;
+static struct timespec tv_server_start;
+
 static void init_socket_opts(int sd)
 {
 	if (busy_poll >= 0)
@@ -252,6 +308,20 @@ static int sock_recv_poll(char *buf, int size, struct sock_info *i)
 	return len;
 }
 
+/* adds the segments retransmitted on the socket before it is closed */
+static void client_sock_retrans(struct sock_info *i)
+{
+	struct tcp_info ti;
+	socklen_t len = sizeof(ti);
+	int err = errno;
+
+	if (proto_type == TYPE_TCP &&
+	    !getsockopt(i->fd, IPPROTO_TCP, TCP_INFO, &ti, &len))
+		i->retrans += ti.tcpi_total_retrans;
+
+	errno = err;
+}
+
 static int client_recv(char *buf, int srv_msg_len, struct sock_info *i)
 {
 	int len, offset = 0;
@@ -302,6 +372,7 @@ static int client_recv(char *buf, int srv_msg_len, struct sock_info *i)
 		}
 	}
 
+	client_sock_retrans(i);
 	SAFE_CLOSE(i->fd);
 	return (errno) ? -1 : 0;
 }
@@ -371,6 +442,22 @@ static void make_client_request(char client_msg[], int *cln_len, int *srv_len,
 	client_msg[*cln_len - 1] = end_byte;
 }
 
+/* timed out and zero-length datagram replies are not counted */
+static void client_record_latency(struct tst_histogram *lat,
+				  struct timespec *t0, long long *bytes,
+				  int bytes_done)
+{
+	struct timespec t1;
+
+	if (errno)
+		return;
+
+	clock_gettime(CLOCK_MONOTONIC_RAW, &t1);
+	tst_histogram_record(lat, (t1.tv_sec - t0->tv_sec) * 1000000LL +
+			     (t1.tv_nsec - t0->tv_nsec) / 1000);
+	*bytes += bytes_done;
+}
+
 void *client_fn(void *id)
 {
 	int cln_len = init_cln_msg_len,
@@ -381,39 +468,50 @@ void *client_fn(void *id)
 	int i = 0;
 	intptr_t err = 0;
 	unsigned int seed = init_seed ^ (intptr_t)id;
+	struct tst_histogram *lat = &client_lat[(intptr_t)id];
+	long long *bytes = &client_bytes[(intptr_t)id];
+	struct timespec t0;
 
 	inf.raddr_len = sizeof(inf.raddr);
 	inf.etime_cnt = 0;
 	inf.eshutdown_cnt = 0;
 	inf.timeout = wait_timeout;
 	inf.pmtu_err_cnt = 0;
+	inf.retrans = 0;
 
 	make_client_request(client_msg, &cln_len, &srv_len, &seed);
 
 	/* connect & send requests */
+	clock_gettime(CLOCK_MONOTONIC_RAW, &t0);
 	inf.fd = client_connect_send(client_msg, cln_len);
 	if (inf.fd == -1) {
 		err = errno;
 		goto out;
 	}
+	client_conns[(intptr_t)id]++;
 
 	if (client_recv(buf, srv_len, &inf)) {
 		err = errno;
 		goto out;
 	}
+	client_record_latency(lat, &t0, bytes, cln_len + srv_len);
 
 	for (i = 1; i < client_max_requests; ++i) {
+		clock_gettime(CLOCK_MONOTONIC_RAW, &t0);
+
 		if (inf.fd == -1) {
 			inf.fd = client_connect_send(client_msg, cln_len);
 			if (inf.fd == -1) {
 				err = errno;
 				goto out;
 			}
+			client_conns[(intptr_t)id]++;
 
 			if (client_recv(buf, srv_len, &inf)) {
 				err = errno;
 				break;
 			}
+			client_record_latency(lat, &t0, bytes, cln_len + srv_len);
 			continue;
 		}
 
@@ -426,12 +524,17 @@ void *client_fn(void *id)
 			err = errno;
 			break;
 		}
+		client_record_latency(lat, &t0, bytes, cln_len + srv_len);
 	}
 
-	if (inf.fd != -1)
+	if (inf.fd != -1) {
+		client_sock_retrans(&inf);
 		SAFE_CLOSE(inf.fd);
+	}
 
 out:
+	client_retrans[(intptr_t)id] = inf.retrans;
+
 	if (i != client_max_requests)
 		tst_res(TWARN, "client exit on '%d' request", i);
 
@@ -453,6 +556,34 @@ static int parse_client_request(const char *msg)
 static struct timespec tv_client_start;
 static struct timespec tv_client_end;
 
+/*
+ * Reads the softirq time of each CPU from /proc/stat into ticks, returns the
+ * number of CPUs found.
+ */
+static int read_softirq(unsigned long long *ticks, int max_cpus)
+{
+	unsigned long long v[7];
+	char line[512];
+	int cpu, n = 0;
+	FILE *f;
+
+	f = SAFE_FOPEN("/proc/stat", "r");
+
+	while (fgets(line, sizeof(line), f)) {
+		if (sscanf(line, "cpu%d %llu %llu %llu %llu %llu %llu %llu",
+			   &cpu, &v[0], &v[1], &v[2], &v[3], &v[4], &v[5],
+			   &v[6]) != 8)
+			continue;
+
+		if (n < max_cpus)
+			ticks[n++] = v[6];
+	}
+
+	SAFE_FCLOSE(f);
+
+	return n;
+}
+
 static void client_init(void)
 {
 	if (clients_num >= MAX_THREADS) {
@@ -461,6 +592,18 @@ static void client_init(void)
 	}
 
 	thread_ids = SAFE_MALLOC(sizeof(pthread_t) * clients_num);
+	client_lat = SAFE_MALLOC(sizeof(*client_lat) * clients_num);
+	client_conns = SAFE_MALLOC(sizeof(*client_conns) * clients_num);
+	memset(client_conns, 0, sizeof(*client_conns) * clients_num);
+	client_bytes = SAFE_MALLOC(sizeof(*client_bytes) * clients_num);
+	memset(client_bytes, 0, sizeof(*client_bytes) * clients_num);
+	client_retrans = SAFE_MALLOC(sizeof(*client_retrans) * clients_num);
+	memset(client_retrans, 0, sizeof(*client_retrans) * clients_num);
+
+	for (int i = 0; i < clients_num; i++) {
+		if (tst_histogram_init(&client_lat[i], LAT_MAX_US, LAT_SUB_BITS))
+			tst_brk(TBROK | TERRNO, "tst_histogram_init()");
+	}
 
 	struct addrinfo hints;
 	memset(&hints, 0, sizeof(struct addrinfo));
@@ -478,12 +621,85 @@ static void client_init(void)
 
 	family = remote_addrinfo->ai_family;
 
+	softirq_cpus = tst_ncpus_conf();
+	softirq_start = SAFE_MALLOC(sizeof(*softirq_start) * softirq_cpus);
+	softirq_cpus = read_softirq(softirq_start, softirq_cpus);
+
 	clock_gettime(CLOCK_MONOTONIC_RAW, &tv_client_start);
 	intptr_t i;
 	for (i = 0; i < clients_num; ++i)
 		SAFE_PTHREAD_CREATE(&thread_ids[i], &attr, client_fn, (void *)i);
 }
 
+static void client_report(long clnt_time)
+{
+	struct tst_histogram *lat = &client_lat[0];
+	long conns = client_conns[0];
+	long long bytes = client_bytes[0];
+	unsigned long retrans = client_retrans[0];
+	double secs = MAX(clnt_time, 1L) / 1000.0;
+	unsigned long long softirq[softirq_cpus];
+	long long softirq_ms = 0, softirq_max_ms = 0, ms;
+	long clk_tck = sysconf(_SC_CLK_TCK);
+	int i, cpus;
+	FILE *f;
+
+	for (i = 1; i < clients_num; i++) {
+		tst_histogram_merge(lat, &client_lat[i]);
+		conns += client_conns[i];
+		bytes += client_bytes[i];
+		retrans += client_retrans[i];
+	}
+
+	cpus = read_softirq(softirq, softirq_cpus);
+
+	for (i = 0; i < cpus; i++) {
+		ms = (softirq[i] - softirq_start[i]) * 1000 / clk_tck;
+		softirq_ms += ms;
+		softirq_max_ms = MAX(softirq_max_ms, ms);
+	}
+
+	tst_res(TINFO, "%ld connections (%.0f conn/s), %llu requests (%.0f req/s)",
+		conns, conns / secs, (unsigned long long)lat->count,
+		lat->count / secs);
+	tst_res(TINFO, "request latency us: min %lli p50 %lli p90 %lli p99 %lli p99.9 %lli max %lli",
+		lat->min, tst_histogram_percentile(lat, 50),
+		tst_histogram_percentile(lat, 90),
+		tst_histogram_percentile(lat, 99),
+		tst_histogram_percentile(lat, 99.9), lat->max);
+	tst_res(TINFO, "%.0f bytes/s, %lu TCP retransmits",
+		bytes / secs, retrans);
+
+	if (clnt_time < SOFTIRQ_MIN_TICKS * 1000 / clk_tck) {
+		tst_res(TINFO, "softirq time not reported for runs shorter than %li ms",
+			SOFTIRQ_MIN_TICKS * 1000 / clk_tck);
+		softirq_ms = -1;
+	} else {
+		tst_res(TINFO, "softirq %lli ms (max %lli ms per CPU)",
+			softirq_ms, softirq_max_ms);
+	}
+
+	if (!mpath)
+		return;
+
+	f = SAFE_FOPEN(mpath, "w");
+	fprintf(f, "time_ms %ld\n", clnt_time);
+	fprintf(f, "requests %llu\n", (unsigned long long)lat->count);
+	fprintf(f, "req_per_sec %.0f\n", lat->count / secs);
+	fprintf(f, "bytes_per_sec %.0f\n", bytes / secs);
+	fprintf(f, "lat_p50_us %lli\n", tst_histogram_percentile(lat, 50));
+	fprintf(f, "lat_p90_us %lli\n", tst_histogram_percentile(lat, 90));
+	fprintf(f, "lat_p99_us %lli\n", tst_histogram_percentile(lat, 99));
+	fprintf(f, "lat_p999_us %lli\n", tst_histogram_percentile(lat, 99.9));
+	fprintf(f, "lat_max_us %lli\n", lat->max);
+	fprintf(f, "retrans %lu\n", retrans);
+	if (softirq_ms >= 0) {
+		fprintf(f, "softirq_ms %lli\n", softirq_ms);
+		fprintf(f, "softirq_cpu_max_ms %lli\n", softirq_max_ms);
+	}
+	SAFE_FCLOSE(f);
+}
+
 static void client_run(void)
 {
 	void *res = NULL;
@@ -502,6 +718,7 @@ static void client_run(void)
 		(tv_client_end.tv_nsec - tv_client_start.tv_nsec) / 1000000;
 
 	tst_res(TINFO, "total time '%ld' ms", clnt_time);
+	client_report(clnt_time);
 
 	char client_msg[min_msg_len];
 	int msg_len = min_msg_len;
@@ -524,8 +741,21 @@ static void client_run(void)
 
 static void client_cleanup(void)
 {
+	int i;
+
 	free(thread_ids);
 
+	if (client_lat) {
+		for (i = 0; i < clients_num; i++)
+			tst_histogram_free(&client_lat[i]);
+		free(client_lat);
+	}
+
+	free(client_conns);
+	free(client_bytes);
+	free(client_retrans);
+	free(softirq_start);
+
 	if (remote_addrinfo)
 		freeaddrinfo(remote_addrinfo);
 }
@@ -644,6 +874,230 @@ out:
 	return NULL;
 }
 
+static void server_report(void)
+{
+	unsigned long conns = 0, requests = 0;
+	struct timespec now;
+	double secs;
+	int i;
+
+	clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+	secs = (now.tv_sec - tv_server_start.tv_sec) +
+		(now.tv_nsec - tv_server_start.tv_nsec) / 1e9;
+
+	for (i = 0; i < srv_workers_num; i++) {
+		conns += srv_workers[i].conns;
+		requests += srv_workers[i].requests;
+	}
+
+	tst_res(TINFO, "server: %lu connections (%.0f conn/s), %lu requests (%.0f req/s)",
+		conns, conns / secs, requests, requests / secs);
+}
+
+/*
+ * Sends the reply with send(), sendto() or sendmsg() as server_fn() does,
+ * the socket is non-blocking so the reply may go out in several pieces.
+ */
+static void server_send_all(int fd, const char *buf, int len, int send_type)
+{
+	struct pollfd pfd = {.fd = fd, .events = POLLOUT};
+	struct iovec iov[2];
+	struct msghdr msg = {.msg_iov = iov};
+	ssize_t ret;
+
+	while (len > 0) {
+		switch (send_type) {
+		case 0:
+			ret = send(fd, buf, len, send_flags);
+			break;
+		case 1:
+			ret = sendto(fd, buf, len, send_flags, NULL, 0);
+			break;
+		default:
+			iov[0].iov_base = (void *)buf;
+			iov[0].iov_len = len - 1;
+			iov[1].iov_base = (void *)(buf + len - 1);
+			iov[1].iov_len = 1;
+			msg.msg_iovlen = 2;
+			ret = sendmsg(fd, &msg, send_flags);
+			break;
+		}
+
+		if (ret >= 0) {
+			buf += ret;
+			len -= ret;
+			continue;
+		}
+
+		if (errno == EINTR)
+			continue;
+
+		if (errno != EAGAIN || poll(&pfd, 1, wait_timeout) != 1) {
+			tst_res(TFAIL | TERRNO, "send failed, sock '%d'", fd);
+			tst_brk(TBROK, "Server closed");
+		}
+	}
+}
+
+static void server_conn_close(struct srv_worker *w, struct srv_conn *c)
+{
+	SAFE_EPOLL_CTL(w->epfd, EPOLL_CTL_DEL, c->fd, NULL);
+	SAFE_CLOSE(c->fd);
+	free(c->buf);
+	free(c);
+}
+
+/*
+ * Same protocol as server_fn(), returns 1 once the connection is to be
+ * closed.
+ */
+static int server_conn_request(struct srv_worker *w, struct srv_conn *c)
+{
+	int send_msg_len;
+
+	/* client asks to terminate */
+	if (c->buf[0] == start_fin_byte) {
+		server_report();
+		tst_brk(TBROK, "Server closed");
+	}
+
+	send_msg_len = parse_client_request(c->buf);
+	if (send_msg_len < 0) {
+		tst_res(TFAIL, "wrong msg size '%d'", send_msg_len);
+		tst_brk(TBROK, "Server closed");
+	}
+
+	make_server_reply(w->send_buf, send_msg_len);
+	c->offset = 0;
+	w->requests++;
+
+	if (++c->num_requests >= server_max_requests)
+		w->send_buf[0] = start_fin_byte;
+
+	server_send_all(c->fd, w->send_buf, send_msg_len, c->send_type);
+
+	if (proto_type != TYPE_SCTP)
+		c->send_type = (c->send_type + 1) % 3;
+
+	if (c->num_requests >= server_max_requests) {
+		/* max reqs, close socket */
+		shutdown(c->fd, SHUT_WR);
+		return 1;
+	}
+
+	return 0;
+}
+
+static void server_conn_read(struct srv_worker *w, struct srv_conn *c)
+{
+	ssize_t len;
+
+	for (;;) {
+		if (c->offset == c->buf_size) {
+			if (c->buf_size == max_msg_len) {
+				tst_res(TFAIL, "recv failed, sock '%d'", c->fd);
+				tst_brk(TBROK, "Server closed");
+			}
+
+			c->buf_size = MIN(c->buf_size * 2, max_msg_len);
+			c->buf = SAFE_REALLOC(c->buf, c->buf_size);
+		}
+
+		len = recv(c->fd, c->buf + c->offset, c->buf_size - c->offset, 0);
+
+		if (len < 0) {
+			if (errno == EAGAIN)
+				return;
+
+			if (errno == EINTR)
+				continue;
+
+			tst_res(TFAIL | TERRNO, "recv failed, sock '%d'", c->fd);
+			tst_brk(TBROK, "Server closed");
+		}
+
+		if (!len) {
+			server_conn_close(w, c);
+			return;
+		}
+
+		if (c->buf[0] != start_byte && c->buf[0] != start_fin_byte) {
+			tst_res(TFAIL, "recv failed, sock '%d'", c->fd);
+			tst_brk(TBROK, "Server closed");
+		}
+
+		c->offset += len;
+
+		/* msg is not complete, continue recv */
+		if (c->buf[c->offset - 1] != end_byte)
+			continue;
+
+		if (server_conn_request(w, c)) {
+			server_conn_close(w, c);
+			return;
+		}
+	}
+}
+
+static void server_accept(struct srv_worker *w)
+{
+	struct epoll_event ev = {.events = EPOLLIN};
+	struct srv_conn *c;
+	int fd;
+
+	for (;;) {
+		fd = accept4(w->lfd, NULL, NULL, SOCK_NONBLOCK);
+
+		if (fd == -1) {
+			if (errno == EAGAIN || errno == EINTR)
+				return;
+
+			tst_brk(TBROK | TERRNO, "Can't create client socket");
+		}
+
+		init_socket_opts(fd);
+
+		c = SAFE_MALLOC(sizeof(*c));
+		c->fd = fd;
+		c->offset = 0;
+		c->num_requests = 0;
+		c->send_type = 0;
+		c->buf_size = 512;
+		c->buf = SAFE_MALLOC(c->buf_size);
+
+		ev.data.ptr = c;
+		SAFE_EPOLL_CTL(w->epfd, EPOLL_CTL_ADD, fd, &ev);
+		w->conns++;
+	}
+}
+
+static void *server_worker_fn(void *arg)
+{
+	struct srv_worker *w = arg;
+	struct epoll_event ev = {.events = EPOLLIN}, events[64];
+	int i, n;
+
+	if (!reuse_port)
+		ev.events |= EPOLLEXCLUSIVE;
+
+	/* NULL data marks the listening socket */
+	ev.data.ptr = NULL;
+	SAFE_EPOLL_CTL(w->epfd, EPOLL_CTL_ADD, w->lfd, &ev);
+
+	for (;;) {
+		n = SAFE_EPOLL_WAIT(w->epfd, events, ARRAY_SIZE(events), -1);
+
+		for (i = 0; i < n; i++) {
+			if (events[i].data.ptr)
+				server_conn_read(w, events[i].data.ptr);
+			else
+				server_accept(w);
+		}
+	}
+
+	return NULL;
+}
+
 static pthread_t server_thread_add(intptr_t client_fd)
 {
 	pthread_t id;
@@ -651,6 +1105,58 @@ static pthread_t server_thread_add(intptr_t client_fd)
 	return id;
 }
 
+static void server_listen(int fd)
+{
+	init_socket_opts(fd);
+
+	if (fastopen_api || fastopen_sapi) {
+		SAFE_SETSOCKOPT_INT(fd, IPPROTO_TCP, TCP_FASTOPEN,
+			tfo_queue_size);
+	}
+
+	if (zcopy)
+		SAFE_SETSOCKOPT_INT(fd, SOL_SOCKET, SO_ZEROCOPY, 1);
+
+	SAFE_LISTEN(fd, max_queue_len);
+}
+
+/* Another listening socket on the server port for SO_REUSEPORT sharding */
+static int server_listen_clone(void)
+{
+	struct sockaddr_storage addr;
+	socklen_t addr_len = sizeof(addr);
+	int fd;
+
+	SAFE_GETSOCKNAME(sfd, (struct sockaddr *)&addr, &addr_len);
+
+	fd = SAFE_SOCKET(family, sock_type, protocol);
+	SAFE_SETSOCKOPT_INT(fd, SOL_SOCKET, SO_REUSEADDR, 1);
+	SAFE_SETSOCKOPT_INT(fd, SOL_SOCKET, SO_REUSEPORT, 1);
+	SAFE_BIND(fd, (struct sockaddr *)&addr, addr_len);
+	server_listen(fd);
+
+	return fd;
+}
+
+static void server_workers_init(void)
+{
+	int i;
+
+	srv_workers = SAFE_MALLOC(sizeof(*srv_workers) * srv_workers_num);
+	memset(srv_workers, 0, sizeof(*srv_workers) * srv_workers_num);
+
+	for (i = 0; i < srv_workers_num; i++) {
+		struct srv_worker *w = &srv_workers[i];
+
+		w->lfd = (reuse_port && i) ? server_listen_clone() : sfd;
+		w->epfd = SAFE_EPOLL_CREATE1(0);
+		w->send_buf = SAFE_MALLOC(max_msg_len);
+	}
+
+	tst_res(TINFO, "%d event-driven workers, %s", srv_workers_num,
+		reuse_port ? "SO_REUSEPORT sharding" : "shared listening socket");
+}
+
 static void server_init(void)
 {
 	char *src_addr = NULL;
@@ -692,23 +1198,27 @@ static void server_init(void)
 	if (sock_type == SOCK_DGRAM)
 		return;
 
-	init_socket_opts(sfd);
-
-	if (fastopen_api || fastopen_sapi) {
-		SAFE_SETSOCKOPT_INT(sfd, IPPROTO_TCP, TCP_FASTOPEN,
-			tfo_queue_size);
-	}
-
-	if (zcopy)
-		SAFE_SETSOCKOPT_INT(sfd, SOL_SOCKET, SO_ZEROCOPY, 1);
-
-	SAFE_LISTEN(sfd, max_queue_len);
+	server_listen(sfd);
 
 	tst_res(TINFO, "Listen on the socket '%d'", sfd);
+
+	if (srv_workers_num)
+		server_workers_init();
 }
 
 static void server_cleanup(void)
 {
+	int i;
+
+	for (i = 0; i < srv_workers_num && srv_workers; i++) {
+		if (srv_workers[i].lfd != sfd)
+			SAFE_CLOSE(srv_workers[i].lfd);
+		if (srv_workers[i].epfd > 0)
+			SAFE_CLOSE(srv_workers[i].epfd);
+		free(srv_workers[i].send_buf);
+	}
+
+	free(srv_workers);
 	SAFE_CLOSE(sfd);
 }
 
@@ -743,6 +1253,26 @@ static void server_run_udp(void)
 	SAFE_PTHREAD_JOIN(p_id, NULL);
 }
 
+static void server_run_events(void)
+{
+	int i;
+
+	if (server_bg)
+		move_to_background();
+
+	clock_gettime(CLOCK_MONOTONIC_RAW, &tv_server_start);
+
+	for (i = 0; i < srv_workers_num; i++)
+		SAFE_FCNTL(srv_workers[i].lfd, F_SETFL, O_NONBLOCK);
+
+	for (i = 1; i < srv_workers_num; i++) {
+		SAFE_PTHREAD_CREATE(&srv_workers[i].id, &attr,
+				    server_worker_fn, &srv_workers[i]);
+	}
+
+	server_worker_fn(&srv_workers[0]);
+}
+
 static void server_run(void)
 {
 	if (server_bg)
@@ -868,6 +1398,8 @@ static void setup(void)
 		tst_brk(TBROK, "Invalid net.ipv4.tcp_fastopen '%s'", targ);
 	if (tst_parse_int(Aarg, &max_rand_msg_len, 10, max_msg_len))
 		tst_brk(TBROK, "Invalid max random payload size '%s'", Aarg);
+	if (tst_parse_int(warg, &srv_workers_num, 1, INT_MAX))
+		tst_brk(TBROK, "Invalid number of server workers '%s'", warg);
 
 	if (!server_addr)
 		server_addr = "localhost";
@@ -928,11 +1460,15 @@ static void setup(void)
 		case TYPE_TCP:
 		case TYPE_DCCP:
 		case TYPE_SCTP:
-			net.run		= server_run;
+			net.run		= srv_workers_num ? server_run_events : server_run;
 			net.cleanup	= server_cleanup;
 		break;
 		case TYPE_UDP:
 		case TYPE_UDP_LITE:
+			if (srv_workers_num) {
+				tst_res(TINFO, "UDP server is single threaded, ignoring -w");
+				srv_workers_num = 0;
+			}
 			net.run		= server_run_udp;
 			net.cleanup	= NULL;
 		break;
@@ -1019,11 +1555,13 @@ static struct tst_test test = {
 		{"N:", &Narg, "Server message size"},
 		{"m:", &Targ, "Receive timeout in milliseconds (not used by UDP/DCCP client)"},
 		{"d:", &rpath, "Path to file where result is saved"},
+		{"M:", &mpath, "Path to file where metrics are saved"},
 		{"A:", &Aarg, "Max payload length (generated randomly)"},
 
 		{"R:", &Rarg, "Server requests after which conn.closed"},
 		{"q:", &qarg, "TFO queue"},
 		{"B:", &server_bg, "Run in background, arg is the process directory"},
+		{"w:", &warg, "Event-driven server with x worker threads instead of thread per client"},
 		{}
 	},
 	.max_runtime = 300,
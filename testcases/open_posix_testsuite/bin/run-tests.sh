@@ -89,6 +89,14 @@ run_test() {
 
 }
 
+SCRIPT_DIR=$(dirname "$0")
+
+# The native runner can run the tests in parallel, see tools/run-tests.c. The
+# test_defs can be sourced only here, RUN_TESTS_SH=1 forces this script.
+if [ -x "$SCRIPT_DIR/run-tests" ] && [ ! -f test_defs ] && [ -z "$RUN_TESTS_SH" ]; then
+	exec "$SCRIPT_DIR/run-tests" "$@"
+fi
+
 # SETUP
 if [ -w "$LOGFILE" ] || echo "" > "$LOGFILE"; then
 	:
@@ -97,7 +105,6 @@ else
 	exit 1
 fi
 
-SCRIPT_DIR=$(dirname "$0")
 TEST_PATH=$1; shift
 T0=$SCRIPT_DIR/t0
 T0_VAL=$SCRIPT_DIR/t0.val
@@ -0,0 +1,465 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (c) Linux Test Project, 2026
+ *
+ * Native replacement for run-tests.sh, can run the tests in a directory on
+ * several CPUs in parallel.
+ *
+ * $ run-tests test_path test1 [test2 ...]
+ *
+ * Each test runs with the arguments from its .args file and is killed
+ * together with its process group once it exceeds TIMEOUT_VAL seconds
+ * (300 by default). The results are appended to LOGFILE ("logfile" by
+ * default) in the order of the command line and in the same format as
+ * run-tests.sh uses, the run time of each test is written into
+ * LOGFILE.durations. The tests run one by one unless the JOBS environment
+ * variable asks for more parallel jobs. Many tests change process or system
+ * wide state (scheduling policies, clocks, resource limits), so only set it
+ * for directories whose tests are known to be independent.
+ *
+ * The exit value is the number of failed tests.
+ */
+
+#define _GNU_SOURCE
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_ARGS 64
+
+struct test {
+	const char *file;
+	char *name;
+
+	pid_t pid;
+	int out_fd;
+	int missing;
+	int hung;
+	int done;
+	int status;
+
+	struct timespec start;
+	double duration;
+
+	char *output;
+	size_t output_len;
+};
+
+static struct test *tests;
+static int tests_cnt;
+static int timeout = 300;
+static FILE *logfile;
+static FILE *durations;
+
+static double timespec_diff(struct timespec *start, struct timespec *end)
+{
+	return (end->tv_sec - start->tv_sec) +
+		(end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/* Arguments are read from "$name.args" where name is the file without suffix */
+static int read_args(const char *file, char *args[], char *buf, size_t buf_len)
+{
+	char path[4096];
+	char *dot, *tok, *save;
+	ssize_t len;
+	int fd, cnt = 0;
+
+	snprintf(path, sizeof(path), "%s", file);
+	dot = strchr(path, '.');
+	if (dot)
+		*dot = 0;
+	strncat(path, ".args", sizeof(path) - strlen(path) - 1);
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return 0;
+
+	len = read(fd, buf, buf_len - 1);
+	close(fd);
+
+	if (len <= 0)
+		return 0;
+
+	buf[len] = 0;
+
+	for (tok = strtok_r(buf, " \t\n", &save); tok && cnt < MAX_ARGS;
+	     tok = strtok_r(NULL, " \t\n", &save))
+		args[cnt++] = tok;
+
+	return cnt;
+}
+
+static void start_test(struct test *t)
+{
+	char exe[4096], args_buf[4096];
+	char *argv[MAX_ARGS + 2];
+	sigset_t sigchld;
+	FILE *out;
+	int cnt;
+
+	out = tmpfile();
+	if (!out) {
+		perror("tmpfile");
+		exit(1);
+	}
+
+	/* Must not leak into the tests that run in parallel */
+	t->out_fd = fcntl(fileno(out), F_DUPFD_CLOEXEC, 0);
+	if (t->out_fd < 0) {
+		perror("fcntl");
+		exit(1);
+	}
+
+	fclose(out);
+
+	clock_gettime(CLOCK_MONOTONIC, &t->start);
+
+	fflush(stdout);
+	t->pid = fork();
+
+	switch (t->pid) {
+	case -1:
+		perror("fork");
+		exit(1);
+	case 0:
+		/* The signal mask is inherited over exec */
+		sigemptyset(&sigchld);
+		sigaddset(&sigchld, SIGCHLD);
+		sigprocmask(SIG_UNBLOCK, &sigchld, NULL);
+
+		setpgid(0, 0);
+		dup2(t->out_fd, STDOUT_FILENO);
+		dup2(t->out_fd, STDERR_FILENO);
+		close(t->out_fd);
+
+		snprintf(exe, sizeof(exe), "./%s", t->file);
+		argv[0] = exe;
+		cnt = read_args(t->file, argv + 1, args_buf, sizeof(args_buf));
+		argv[cnt + 1] = NULL;
+
+		execv(exe, argv);
+		perror("execv failed");
+		_exit(1);
+	}
+
+	/* Make sure the group exists before we may need to kill it */
+	setpgid(t->pid, t->pid);
+}
+
+static void read_output(struct test *t)
+{
+	FILE *f = fdopen(t->out_fd, "r");
+	size_t size = 0;
+
+	if (!f) {
+		close(t->out_fd);
+		return;
+	}
+
+	rewind(f);
+
+	while (!feof(f) && !ferror(f)) {
+		if (t->output_len + 4096 > size) {
+			size = size ? 2 * size : 8192;
+			t->output = realloc(t->output, size);
+
+			if (!t->output) {
+				perror("realloc");
+				exit(1);
+			}
+		}
+
+		t->output_len += fread(t->output + t->output_len, 1,
+				       size - t->output_len, f);
+	}
+
+	fclose(f);
+}
+
+static const char *result_msg(struct test *t, int ret)
+{
+	if (t->hung)
+		return "HUNG";
+
+	switch (ret) {
+	case 1:
+		return "FAILED";
+	case 2:
+		return "UNRESOLVED";
+	case 4:
+		return "UNSUPPORTED";
+	case 5:
+		return "UNTESTED";
+	}
+
+	if (ret > 128)
+		return "SIGNALED";
+
+	return "EXITED ABNORMALLY";
+}
+
+/* Same format as run-tests.sh, returns 1 on failure */
+static int report_test(struct test *t)
+{
+	int ret;
+
+	if (t->missing) {
+		printf("%s: execution: SKIPPED (test not present)\n", t->name);
+		return 1;
+	}
+
+	if (WIFEXITED(t->status))
+		ret = WEXITSTATUS(t->status);
+	else
+		ret = WTERMSIG(t->status) + 128;
+
+	if (!ret && !t->hung) {
+		fprintf(logfile, "%s: execution: PASS\n", t->name);
+		fprintf(durations, "%s %.3f PASS\n", t->name, t->duration);
+		return 0;
+	}
+
+	fprintf(logfile, "%s: execution: %s: Output: \n", t->name,
+		result_msg(t, ret));
+	fwrite(t->output, 1, t->output_len, logfile);
+	printf("%s: execution: %s \n", t->name, result_msg(t, ret));
+	fprintf(durations, "%s %.3f %s\n", t->name, t->duration,
+		result_msg(t, ret));
+
+	return 1;
+}
+
+static void reap_test(pid_t pid, int status)
+{
+	struct timespec now;
+	int i;
+
+	for (i = 0; i < tests_cnt; i++) {
+		if (tests[i].pid == pid && !tests[i].done)
+			break;
+	}
+
+	if (i >= tests_cnt)
+		return;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	tests[i].done = 1;
+	tests[i].status = status;
+	tests[i].duration = timespec_diff(&tests[i].start, &now);
+
+	/* Kill anything left behind in the test process group */
+	kill(-pid, SIGKILL);
+
+	read_output(&tests[i]);
+}
+
+/*
+ * Kills the tests over the timeout, returns time in ms until the nearest
+ * timeout of the running tests.
+ */
+static long check_timeouts(void)
+{
+	struct timespec now;
+	long min_ms = timeout * 1000L;
+	double elapsed;
+	long left;
+	int i;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	for (i = 0; i < tests_cnt; i++) {
+		struct test *t = &tests[i];
+
+		if (!t->pid || t->done || t->hung)
+			continue;
+
+		elapsed = timespec_diff(&t->start, &now);
+
+		if (elapsed >= timeout) {
+			t->hung = 1;
+			kill(-t->pid, SIGKILL);
+			continue;
+		}
+
+		left = (timeout - elapsed) * 1000 + 1;
+
+		if (left < min_ms)
+			min_ms = left;
+	}
+
+	return min_ms;
+}
+
+static void wait_for_child(sigset_t *sigchld)
+{
+	struct timespec ts;
+	long ms = check_timeouts();
+
+	ts.tv_sec = ms / 1000;
+	ts.tv_nsec = (ms % 1000) * 1000000;
+
+	sigtimedwait(sigchld, NULL, &ts);
+}
+
+static long get_env_num(const char *name, long def)
+{
+	const char *val = getenv(name);
+	char *end;
+	long ret;
+
+	if (!val || !*val)
+		return def;
+
+	ret = strtol(val, &end, 10);
+
+	if (*end || ret < 1) {
+		fprintf(stderr, "ERROR: invalid %s value '%s'\n", name, val);
+		exit(1);
+	}
+
+	return ret;
+}
+
+static FILE *open_log(const char *path)
+{
+	FILE *f = fopen(path, "ae");
+
+	if (!f) {
+		fprintf(stderr, "ERROR: %s not writable\n", path);
+		exit(1);
+	}
+
+	return f;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *log_path = getenv("LOGFILE");
+	char *dur_path, cwd[4096];
+	int running = 0, next = 0, reported = 0;
+	int num_pass = 0, num_fail = 0;
+	long jobs;
+	sigset_t sigchld;
+	pid_t pid;
+	int status, i;
+
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s test_path test1 [test2 ...]\n", argv[0]);
+		return 1;
+	}
+
+	if (!log_path || !*log_path)
+		log_path = "logfile";
+
+	timeout = get_env_num("TIMEOUT_VAL", 300);
+	jobs = get_env_num("JOBS", 1);
+
+	/* run-tests.sh starts a new logfile with an empty line */
+	i = access(log_path, W_OK);
+	logfile = open_log(log_path);
+	if (i)
+		fputc('\n', logfile);
+
+	if (asprintf(&dur_path, "%s.durations", log_path) < 0) {
+		perror("asprintf");
+		return 1;
+	}
+
+	durations = open_log(dur_path);
+	free(dur_path);
+
+	tests_cnt = argc - 2;
+	tests = calloc(tests_cnt ? tests_cnt : 1, sizeof(*tests));
+
+	if (!tests) {
+		perror("calloc");
+		return 1;
+	}
+
+	for (i = 0; i < tests_cnt; i++) {
+		char *dot, *name = strdup(argv[i + 2]);
+
+		dot = strchr(name, '.');
+		if (dot)
+			*dot = 0;
+
+		tests[i].file = argv[i + 2];
+
+		if (asprintf(&tests[i].name, "%s/%s", argv[1], name) < 0) {
+			perror("asprintf");
+			return 1;
+		}
+
+		free(name);
+	}
+
+	/* Same as trap '' INT in run-tests.sh */
+	signal(SIGINT, SIG_IGN);
+
+	sigemptyset(&sigchld);
+	sigaddset(&sigchld, SIGCHLD);
+	sigprocmask(SIG_BLOCK, &sigchld, NULL);
+
+	while (reported < tests_cnt) {
+		while (running < jobs && next < tests_cnt) {
+			struct test *t = &tests[next++];
+
+			if (access(t->file, F_OK)) {
+				t->missing = t->done = 1;
+				continue;
+			}
+
+			start_test(t);
+			running++;
+		}
+
+		while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+			reap_test(pid, status);
+			running--;
+		}
+
+		/* Results are logged in the order of the command line */
+		while (reported < tests_cnt && tests[reported].done) {
+			struct test *t = &tests[reported++];
+
+			if (report_test(t))
+				num_fail++;
+			else
+				num_pass++;
+
+			free(t->output);
+			t->output = NULL;
+			fflush(stdout);
+		}
+
+		if (running)
+			wait_for_child(&sigchld);
+	}
+
+	fclose(logfile);
+	fclose(durations);
+
+	if (!getcwd(cwd, sizeof(cwd)))
+		strcpy(cwd, ".");
+
+	printf("*******************\n");
+	printf("Testing %s\n", basename(cwd));
+	printf("*******************\n");
+	printf("PASS\t\t%3d\n", num_pass);
+	printf("FAIL\t\t%3d\n", num_fail);
+	printf("*******************\n");
+	printf("TOTAL\t\t%3d\n", num_pass + num_fail);
+	printf("*******************\n");
+
+	return num_fail;
+}
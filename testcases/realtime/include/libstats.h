@@ -45,6 +45,7 @@
 #include <errno.h>
 #include <unistd.h>
 #include <math.h>
+#include "tst_histogram.h"
 
 #define MIN(A,B) ((A)<(B)?(A):(B))
 #define MAX(A,B) ((A)>(B)?(A):(B))
@@ -136,6 +137,15 @@ int stats_quantiles_free(stats_quantiles_t *quantiles);
  */
 int stats_quantiles_calc(stats_container_t *data, stats_quantiles_t *quantiles);
 
+/* stats_quantiles_calc_hist - calculate the quantiles of a histogram, for
+ * long runs that record the values with tst_histogram_record() instead of
+ * storing each of them in a container
+ * hist: histogram with the recorded values
+ * quantiles: stats_quantiles_t structure for storing the results
+ */
+int stats_quantiles_calc_hist(struct tst_histogram *hist,
+			      stats_quantiles_t *quantiles);
+
 /* stats_quantiles_print - print the quantiles stored in quantiles
  * quantiles: stats_quantiles_t structure to print
  */
@@ -45,6 +45,7 @@
 #include <math.h>
 #include <libstats.h>
 #include <librttest.h>
+#include "tst_histogram.h"
 
 #include "../include/realtime_config.h"
 
@@ -54,6 +55,9 @@
 
 int save_stats = 0;
 
+/* relative precision of quantiles is 2^-STATS_HIST_SUB_BITS */
+#define STATS_HIST_SUB_BITS 10
+
 /* static helper functions */
 static int stats_record_compare(const void *a, const void *b)
 {
@@ -226,9 +230,9 @@ int stats_quantiles_free(stats_quantiles_t * quantiles)
 int stats_quantiles_calc(stats_container_t * data,
 			 stats_quantiles_t * quantiles)
 {
-	int i;
-	int size;
-	int index;
+	struct tst_histogram hist;
+	long i;
+	int ret;
 
 	// check for sufficient data size of accurate calculation
 	if (data->index < 0 ||
@@ -236,12 +240,31 @@ int stats_quantiles_calc(stats_container_t * data,
 		return -1;
 	}
 
-	size = data->index + 1;
-	stats_sort(data, ASCENDING_ON_Y);
+	if (tst_histogram_init(&hist, MAX(stats_max(data), 1),
+			       STATS_HIST_SUB_BITS))
+		return -1;
+
+	for (i = 0; i <= data->index; i++)
+		tst_histogram_record(&hist, data->records[i].y);
+
+	ret = stats_quantiles_calc_hist(&hist, quantiles);
+	tst_histogram_free(&hist);
+
+	return ret;
+}
+
+int stats_quantiles_calc_hist(struct tst_histogram *hist,
+			      stats_quantiles_t * quantiles)
+{
+	int i;
+
+	// check for sufficient data size of accurate calculation
+	if (hist->count < (uint64_t)exp10(quantiles->nines))
+		return -1;
 
 	for (i = 2; i <= quantiles->nines; i++) {
-		index = size - size / exp10(i);
-		quantiles->quantiles[i - 2] = data->records[index].y;
+		quantiles->quantiles[i - 2] =
+		    tst_histogram_percentile(hist, 100 - 100 / exp10(i));
 	}
 	return 0;
 }